@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/* Make certificate chains by running the openssl binary, then using the OpenSSL library
+   in one thread and then in increasing numbers of threads.
+*/
+
+#include "certificate_chain.h"
+#include "timer.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <cstdlib>
+
+using std::cout;
+using std::cerr;
+
+static void
+make_chains (int count)
+{
+	for (int i = 0; i < count; ++i) {
+		dcp::CertificateChain chain = dcp::CertificateChain::generate ();
+	}
+}
+
+int
+main (int argc, char* argv[])
+{
+	int chains = 10;
+	if (argc > 1) {
+		chains = atoi (argv[1]);
+	}
+
+	if (chains < 1) {
+		cerr << "Syntax: " << argv[0] << " [number of chains]\n";
+		exit (EXIT_FAILURE);
+	}
+
+	Timer spawn;
+	spawn.start ();
+	for (int i = 0; i < chains; ++i) {
+		dcp::CertificateChain chain (boost::filesystem::path ("openssl"));
+	}
+	spawn.stop ();
+	cout << "openssl binary: " << (chains / spawn.get()) << " chains/s\n";
+
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		Timer timer;
+		timer.start ();
+		boost::thread_group group;
+		for (int i = 0; i < threads; ++i) {
+			group.create_thread (boost::bind (&make_chains, chains));
+		}
+		group.join_all ();
+		timer.stop ();
+		cout << "OpenSSL library with " << threads << " thread(s): " << (chains * threads / timer.get()) << " chains/s\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/* Hash every file in a directory (such as a DCP), one at a time and then with make_digests
+   using increasing numbers of threads.  The files are dropped from the page cache (where
+   possible) before each run.
+*/
+
+#include "util.h"
+#include "timer.h"
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+
+static void
+drop_cache (vector<boost::filesystem::path> const & files)
+{
+	BOOST_FOREACH (boost::filesystem::path const & i, files) {
+		int const fd = open (i.string().c_str(), O_RDONLY);
+		if (fd != -1) {
+			fdatasync (fd);
+			posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+			close (fd);
+		}
+	}
+}
+
+int
+main (int argc, char* argv[])
+{
+	if (argc < 2) {
+		cerr << "Syntax: " << argv[0] << " <directory>\n";
+		exit (EXIT_FAILURE);
+	}
+
+	vector<boost::filesystem::path> files;
+	boost::uintmax_t total = 0;
+	for (boost::filesystem::directory_iterator i(argv[1]); i != boost::filesystem::directory_iterator(); ++i) {
+		if (boost::filesystem::is_regular_file (i->path())) {
+			files.push_back (i->path());
+			total += boost::filesystem::file_size (i->path());
+		}
+	}
+
+	double const megabytes = total / 1e6;
+
+	drop_cache (files);
+	Timer serial;
+	serial.start ();
+	vector<string> reference;
+	BOOST_FOREACH (boost::filesystem::path const & i, files) {
+		reference.push_back (dcp::make_digest (i, 0));
+	}
+	serial.stop ();
+	cout << "make_digest on each file: " << (megabytes / serial.get()) << " MB/s\n";
+
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		drop_cache (files);
+		Timer timer;
+		timer.start ();
+		vector<string> digests = dcp::make_digests (files, threads);
+		timer.stop ();
+		cout << "make_digests with " << threads << " thread(s): " << (megabytes / timer.get()) << " MB/s";
+		if (digests != reference) {
+			cout << " (digests differ)";
+		}
+		cout << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/* Make KDMs for many recipients (1000 by default), first by calling DecryptedKDM::encrypt
+   once per recipient and then with the batch version of DecryptedKDM::encrypt using
+   increasing numbers of threads.  Then decrypt them all, first using the DecryptedKDM
+   constructor which takes a PEM key and then with decrypt_kdms.  The KDM, key and
+   certificate chain from test/data are used, so this should be run from the top of the
+   source tree.
+*/
+
+#include "decrypted_kdm.h"
+#include "private_key.h"
+#include "encrypted_kdm.h"
+#include "certificate_chain.h"
+#include "util.h"
+#include "timer.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+using boost::optional;
+
+int
+main (int argc, char* argv[])
+{
+	int recipients_count = 1000;
+	if (argc > 1) {
+		recipients_count = atoi (argv[1]);
+	}
+
+	if (recipients_count < 1) {
+		cerr << "Syntax: " << argv[0] << " [number of recipients]\n";
+		exit (EXIT_FAILURE);
+	}
+
+	dcp::init ();
+
+	dcp::DecryptedKDM decrypted (
+		dcp::EncryptedKDM (
+			dcp::file_to_string ("test/data/kdm_TONEPLATES-SMPTE-ENC_.smpte-430-2.ROOT.NOT_FOR_PRODUCTION_20130706_20230702_CAR_OV_t1_8971c838.xml")
+			),
+		dcp::file_to_string ("test/data/private.key")
+		);
+
+	shared_ptr<dcp::CertificateChain> signer (new dcp::CertificateChain (dcp::file_to_string ("test/data/certificate_chain")));
+	signer->set_key (dcp::file_to_string ("test/data/private.key"));
+
+	vector<dcp::Certificate> recipients (recipients_count, signer->leaf ());
+
+	Timer serial;
+	serial.start ();
+	for (vector<dcp::Certificate>::const_iterator i = recipients.begin(); i != recipients.end(); ++i) {
+		decrypted.encrypt (signer, *i, vector<string>(), dcp::MODIFIED_TRANSITIONAL_1, true, optional<int>());
+	}
+	serial.stop ();
+	cout << "encrypt for each recipient: " << (recipients_count / serial.get()) << " KDMs/s\n";
+
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		Timer timer;
+		timer.start ();
+		vector<dcp::EncryptedKDM> kdms = decrypted.encrypt (
+			signer, recipients, vector<string>(), dcp::MODIFIED_TRANSITIONAL_1, true, optional<int>(), threads
+			);
+		timer.stop ();
+		cout << "encrypt for all recipients with " << threads << " thread(s): " << (recipients_count / timer.get()) << " KDMs/s\n";
+	}
+
+	vector<dcp::EncryptedKDM> kdms = decrypted.encrypt (
+		signer, recipients, vector<string>(), dcp::MODIFIED_TRANSITIONAL_1, true, optional<int>(), max_threads
+		);
+
+	string const key = dcp::file_to_string ("test/data/private.key");
+
+	Timer serial_decrypt;
+	serial_decrypt.start ();
+	for (vector<dcp::EncryptedKDM>::const_iterator i = kdms.begin(); i != kdms.end(); ++i) {
+		dcp::DecryptedKDM kdm (*i, key);
+	}
+	serial_decrypt.stop ();
+	cout << "decrypt each KDM: " << (recipients_count / serial_decrypt.get()) << " KDMs/s\n";
+
+	dcp::PrivateKey private_key (key);
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		Timer timer;
+		timer.start ();
+		dcp::decrypt_kdms (kdms, private_key, threads);
+		timer.stop ();
+		cout << "decrypt_kdms with " << threads << " thread(s): " << (recipients_count / timer.get()) << " KDMs/s\n";
+	}
+
+	return 0;
+}
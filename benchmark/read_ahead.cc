@@ -0,0 +1,158 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/* Compare reading every frame of a 2D picture MXF with AssetReader::get_frame against
+   reading through AssetReader::read_ahead with one or more threads, with and without
+   decoding each frame.  A KDM and private key may be given for an encrypted MXF, so that
+   the cost of decryption is included.
+   The file's pages are dropped from the cache before each run (this only works for
+   pages which are not dirty) so that the numbers reflect reading from the disk.
+*/
+
+#include "mono_picture_asset.h"
+#include "mono_picture_asset_reader.h"
+#include "mono_picture_frame.h"
+#include "decrypted_kdm.h"
+#include "decrypted_kdm_key.h"
+#include "encrypted_kdm.h"
+#include "util.h"
+#include "timer.h"
+#include <boost/foreach.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+using std::cout;
+using std::cerr;
+using boost::shared_ptr;
+using boost::optional;
+
+static void
+drop_cache (boost::filesystem::path file)
+{
+	int const fd = open (file.string().c_str(), O_RDONLY);
+	if (fd == -1) {
+		return;
+	}
+	fdatasync (fd);
+	posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+	close (fd);
+}
+
+static void
+consume (shared_ptr<const dcp::MonoPictureFrame> frame, bool decode)
+{
+	if (decode) {
+		frame->xyz_image (2);
+	}
+}
+
+static void
+run (boost::filesystem::path file, optional<dcp::Key> key, int frames, int depth, int threads, bool decode)
+{
+	dcp::MonoPictureAsset asset (file);
+	if (key) {
+		asset.set_key (key.get());
+	}
+	shared_ptr<dcp::MonoPictureAssetReader> reader = asset.start_read ();
+
+	drop_cache (file);
+
+	Timer timer;
+	timer.start ();
+	if (depth == 0) {
+		for (int i = 0; i < frames; ++i) {
+			consume (reader->get_frame (i), decode);
+		}
+	} else {
+		shared_ptr<dcp::FrameReadAhead<dcp::MonoPictureFrame> > read_ahead = reader->read_ahead (0, frames, depth, threads);
+		for (int i = 0; i < frames; ++i) {
+			consume (read_ahead->next (), decode);
+		}
+	}
+	timer.stop ();
+
+	if (depth == 0) {
+		cout << "get_frame loop";
+	} else {
+		cout << "read_ahead depth " << depth << ", " << threads << " thread(s)";
+	}
+	cout << (decode ? ", decoding" : "") << ": " << (frames / timer.get()) << " fps\n";
+}
+
+int
+main (int argc, char* argv[])
+{
+	if (argc < 2) {
+		cerr << "Syntax: " << argv[0] << " <2D picture MXF> [frames [<KDM> <private key>]]\n";
+		exit (EXIT_FAILURE);
+	}
+
+	boost::filesystem::path file = argv[1];
+	dcp::MonoPictureAsset asset (file);
+	int frames = asset.intrinsic_duration ();
+	if (argc > 2) {
+		frames = std::min (frames, atoi (argv[2]));
+	}
+
+	optional<dcp::Key> key;
+	if (argc > 4) {
+		dcp::DecryptedKDM kdm (dcp::EncryptedKDM (dcp::file_to_string (argv[3])), dcp::file_to_string (argv[4]));
+		BOOST_FOREACH (dcp::DecryptedKDMKey const & i, kdm.keys ()) {
+			if (asset.key_id() && i.id() == asset.key_id().get()) {
+				key = i.key ();
+			}
+		}
+		if (!key) {
+			cerr << "KDM has no key for " << file.string() << "\n";
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	int const depths[] = { 0, 2, 8, 32 };
+	int const threads[] = { 1, 2, 4, 8 };
+	for (int decode = 0; decode < 2; ++decode) {
+		for (size_t i = 0; i < sizeof (depths) / sizeof (depths[0]); ++i) {
+			run (file, key, frames, depths[i], 1, decode);
+		}
+		for (size_t i = 1; i < sizeof (threads) / sizeof (threads[0]); ++i) {
+			run (file, key, frames, 8, threads[i], decode);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,205 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/* Make a synthetic SMPTE DCP with one CPL of many reels (5000 by default), each with a
+   picture and a sound asset, so that there are twice as many MXF assets as reels, and
+   time reading it with DCP::read.  The DCP is read lazily, so the MXFs are never opened
+   and can be empty files; what is timed is reading the XML and resolving the references.
+*/
+
+#include "dcp.h"
+#include "cpl.h"
+#include "reel.h"
+#include "reel_mono_picture_asset.h"
+#include "reel_sound_asset.h"
+#include "util.h"
+#include "timer.h"
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+using std::cout;
+using std::cerr;
+using std::string;
+using std::vector;
+using std::list;
+using boost::shared_ptr;
+
+static void
+asset_map_entry (FILE* f, string id, string path, bool pkl)
+{
+	fprintf (f, "    <Asset>\n      <Id>urn:uuid:%s</Id>\n", id.c_str());
+	if (pkl) {
+		fprintf (f, "      <PackingList>true</PackingList>\n");
+	}
+	fprintf (
+		f,
+		"      <ChunkList>\n        <Chunk>\n          <Path>%s</Path>\n          <VolumeIndex>1</VolumeIndex>\n"
+		"          <Offset>0</Offset>\n          <Length>0</Length>\n        </Chunk>\n      </ChunkList>\n    </Asset>\n",
+		path.c_str()
+		);
+}
+
+static void
+pkl_entry (FILE* f, string id, string type)
+{
+	fprintf (
+		f,
+		"    <Asset>\n      <Id>urn:uuid:%s</Id>\n      <Hash>2jmj7l5rSw0yVb/vlWAYkK/YBwk=</Hash>\n      <Size>0</Size>\n      <Type>%s</Type>\n    </Asset>\n",
+		id.c_str(), type.c_str()
+		);
+}
+
+static void
+reel_asset (FILE* f, string node, string id)
+{
+	fprintf (
+		f,
+		"        <%s>\n          <Id>urn:uuid:%s</Id>\n          <EditRate>24 1</EditRate>\n          <IntrinsicDuration>24</IntrinsicDuration>\n"
+		"          <EntryPoint>0</EntryPoint>\n          <Duration>24</Duration>\n          <Hash>2jmj7l5rSw0yVb/vlWAYkK/YBwk=</Hash>\n",
+		node.c_str(), id.c_str()
+		);
+	if (node == "MainPicture") {
+		fprintf (f, "          <FrameRate>24 1</FrameRate>\n          <ScreenAspectRatio>1998 1080</ScreenAspectRatio>\n");
+	}
+	fprintf (f, "        </%s>\n", node.c_str());
+}
+
+static FILE*
+open (boost::filesystem::path path)
+{
+	FILE* f = fopen (path.string().c_str(), "w");
+	if (!f) {
+		cerr << "Could not open " << path.string() << " for writing.\n";
+		exit (EXIT_FAILURE);
+	}
+	return f;
+}
+
+static void
+make_dcp (boost::filesystem::path dir, int reels)
+{
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	string const cpl_id = dcp::make_uuid ();
+	string const pkl_id = dcp::make_uuid ();
+	vector<string> pictures;
+	vector<string> sounds;
+	for (int i = 0; i < reels; ++i) {
+		pictures.push_back (dcp::make_uuid ());
+		sounds.push_back (dcp::make_uuid ());
+		fclose (open (dir / (pictures.back() + ".mxf")));
+		fclose (open (dir / (sounds.back() + ".mxf")));
+	}
+
+	string const header = "  <IssueDate>2020-01-01T00:00:00+00:00</IssueDate>\n  <Issuer>libdcp</Issuer>\n  <Creator>libdcp</Creator>\n";
+
+	FILE* f = open (dir / "ASSETMAP.xml");
+	fprintf (f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<AssetMap xmlns=\"http://www.smpte-ra.org/schemas/429-9/2007/AM\">\n");
+	fprintf (f, "  <Id>urn:uuid:%s</Id>\n  <Creator>libdcp</Creator>\n  <VolumeCount>1</VolumeCount>\n", dcp::make_uuid().c_str());
+	fprintf (f, "  <IssueDate>2020-01-01T00:00:00+00:00</IssueDate>\n  <Issuer>libdcp</Issuer>\n  <AssetList>\n");
+	asset_map_entry (f, pkl_id, "pkl.xml", true);
+	asset_map_entry (f, cpl_id, "cpl.xml", false);
+	for (int i = 0; i < reels; ++i) {
+		asset_map_entry (f, pictures[i], pictures[i] + ".mxf", false);
+		asset_map_entry (f, sounds[i], sounds[i] + ".mxf", false);
+	}
+	fprintf (f, "  </AssetList>\n</AssetMap>\n");
+	fclose (f);
+
+	f = open (dir / "pkl.xml");
+	fprintf (f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<PackingList xmlns=\"http://www.smpte-ra.org/schemas/429-8/2007/PKL\">\n");
+	fprintf (f, "  <Id>urn:uuid:%s</Id>\n%s  <AssetList>\n", pkl_id.c_str(), header.c_str());
+	pkl_entry (f, cpl_id, "text/xml");
+	for (int i = 0; i < reels; ++i) {
+		pkl_entry (f, pictures[i], "application/mxf");
+		pkl_entry (f, sounds[i], "application/mxf");
+	}
+	fprintf (f, "  </AssetList>\n</PackingList>\n");
+	fclose (f);
+
+	f = open (dir / "cpl.xml");
+	fprintf (f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<CompositionPlaylist xmlns=\"http://www.smpte-ra.org/schemas/429-7/2006/CPL\">\n");
+	fprintf (f, "  <Id>urn:uuid:%s</Id>\n%s", cpl_id.c_str(), header.c_str());
+	fprintf (f, "  <ContentTitleText>Benchmark</ContentTitleText>\n  <ContentKind>feature</ContentKind>\n  <RatingList/>\n  <ReelList>\n");
+	for (int i = 0; i < reels; ++i) {
+		fprintf (f, "    <Reel>\n      <Id>urn:uuid:%s</Id>\n      <AssetList>\n", dcp::make_uuid().c_str());
+		reel_asset (f, "MainPicture", pictures[i]);
+		reel_asset (f, "MainSound", sounds[i]);
+		fprintf (f, "      </AssetList>\n    </Reel>\n");
+	}
+	fprintf (f, "  </ReelList>\n</CompositionPlaylist>\n");
+	fclose (f);
+}
+
+int
+main (int argc, char* argv[])
+{
+	int reels = 5000;
+	if (argc > 1) {
+		reels = atoi (argv[1]);
+	}
+
+	if (reels < 1) {
+		cerr << "Syntax: " << argv[0] << " [number of reels]\n";
+		exit (EXIT_FAILURE);
+	}
+
+	boost::filesystem::path const dir = "build/benchmark/read_dcp";
+	make_dcp (dir, reels);
+
+	Timer timer;
+	timer.start ();
+	dcp::DCP dcp (dir);
+	dcp.read (0, false, true);
+	timer.stop ();
+
+	int resolved = 0;
+	BOOST_FOREACH (shared_ptr<dcp::CPL> i, dcp.cpls()) {
+		BOOST_FOREACH (shared_ptr<dcp::Reel> j, i->reels()) {
+			if (j->main_picture()->asset_ref().resolved()) {
+				++resolved;
+			}
+			if (j->main_sound()->asset_ref().resolved()) {
+				++resolved;
+			}
+		}
+	}
+
+	cout << "read " << (reels * 2) << " assets in " << timer.get() << "s; " << resolved << " references resolved\n";
+	return 0;
+}
@@ -34,14 +34,32 @@
 #include "openjpeg_image.h"
 #include "rgb_xyz.h"
 #include "colour_conversion.h"
+#include "timer.h"
 #include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
+#include <iostream>
 #include <stdint.h>
 
+using std::cout;
 using boost::scoped_array;
 using boost::shared_ptr;
 
 int const trials = 256;
 
+static bool
+same (shared_ptr<const dcp::OpenJPEGImage> a, shared_ptr<const dcp::OpenJPEGImage> b)
+{
+	int const pixels = a->size().width * a->size().height;
+	for (int c = 0; c < 3; ++c) {
+		for (int i = 0; i < pixels; ++i) {
+			if (a->data(c)[i] != b->data(c)[i]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 int
 main ()
 {
@@ -60,10 +78,21 @@ main ()
 		}
 	}
 
-	shared_ptr<dcp::OpenJPEGImage> xyz;
-	for (int i = 0; i < trials; ++i) {
-		xyz = dcp::rgb_to_xyz (rgb.get(), size, size.width * 6, dcp::ColourConversion::srgb_to_xyz());
+	shared_ptr<dcp::OpenJPEGImage> reference = dcp::rgb_to_xyz (rgb.get(), size, size.width * 6, dcp::ColourConversion::srgb_to_xyz());
+
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		Timer timer;
+		shared_ptr<dcp::OpenJPEGImage> xyz;
+		timer.start ();
+		for (int i = 0; i < trials; ++i) {
+			xyz = dcp::rgb_to_xyz (rgb.get(), size, size.width * 6, dcp::ColourConversion::srgb_to_xyz(), threads);
+		}
+		timer.stop ();
+		cout << threads << " thread(s): " << (trials / timer.get()) << " fps";
+		if (!same (reference, xyz)) {
+			cout << " (output differs from single-threaded)";
+		}
+		cout << "\n";
 	}
 }
-
-
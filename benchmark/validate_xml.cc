@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/* Validate a CPL (by default the one from test/ref/DCP/dcp_test1) 1000 times using
+   dcp::validate_xml with increasing numbers of threads.  The first validation, which
+   also loads the schemas, is timed separately.  This should be run from the top of
+   the source tree so that the xsd directory can be found.
+*/
+
+#include "verify.h"
+#include "timer.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+using std::cout;
+using std::list;
+using std::vector;
+
+static void
+validate (boost::filesystem::path cpl, int count, list<dcp::VerificationNote>* notes)
+{
+	for (int i = 0; i < count; ++i) {
+		dcp::validate_xml (cpl, "xsd", *notes);
+	}
+}
+
+int
+main (int argc, char* argv[])
+{
+	boost::filesystem::path cpl = "test/ref/DCP/dcp_test1/cpl_81fb54df-e1bf-4647-8788-ea7ba154375b.xml";
+	if (argc > 1) {
+		cpl = argv[1];
+	}
+
+	int const count = 1000;
+
+	list<dcp::VerificationNote> notes;
+	Timer first;
+	first.start ();
+	dcp::validate_xml (cpl, "xsd", notes);
+	first.stop ();
+	cout << "first validation (loading schemas): " << (first.get() * 1000) << "ms\n";
+	if (!notes.empty()) {
+		cout << notes.size() << " validation error(s), e.g. " << dcp::note_to_string(notes.front()) << "\n";
+	}
+
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		vector<list<dcp::VerificationNote> > thread_notes (threads);
+		Timer timer;
+		timer.start ();
+		boost::thread_group group;
+		for (int i = 0; i < threads; ++i) {
+			group.create_thread (boost::bind (&validate, cpl, count / threads, &thread_notes[i]));
+		}
+		group.join_all ();
+		timer.stop ();
+		cout << "validate with " << threads << " thread(s): " << ((count / threads) * threads / timer.get()) << " files/s\n";
+	}
+
+	return 0;
+}
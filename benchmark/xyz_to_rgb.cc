@@ -0,0 +1,98 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "openjpeg_image.h"
+#include "rgb_xyz.h"
+#include "colour_conversion.h"
+#include "timer.h"
+#include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
+#include <iostream>
+#include <cstring>
+#include <stdint.h>
+
+using std::cout;
+using boost::scoped_array;
+using boost::shared_ptr;
+
+int const trials = 256;
+
+int
+main ()
+{
+	srand (1);
+
+	dcp::Size size(1998, 1080);
+
+	shared_ptr<dcp::OpenJPEGImage> xyz (new dcp::OpenJPEGImage (size));
+	for (int c = 0; c < 3; ++c) {
+		int* p = xyz->data (c);
+		for (int i = 0; i < size.width * size.height; ++i) {
+			*p++ = rand() & 0xfff;
+		}
+	}
+
+	int const rgb_stride = size.width * 6;
+	int const rgba_stride = size.width * 4;
+
+	scoped_array<uint8_t> rgb_reference (new uint8_t[rgb_stride * size.height]);
+	scoped_array<uint8_t> rgba_reference (new uint8_t[rgba_stride * size.height]);
+	dcp::xyz_to_rgb (xyz, dcp::ColourConversion::srgb_to_xyz(), rgb_reference.get(), rgb_stride);
+	dcp::xyz_to_rgba (xyz, dcp::ColourConversion::srgb_to_xyz(), rgba_reference.get(), rgba_stride);
+
+	scoped_array<uint8_t> rgb (new uint8_t[rgb_stride * size.height]);
+	scoped_array<uint8_t> rgba (new uint8_t[rgba_stride * size.height]);
+
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		Timer rgb_timer;
+		rgb_timer.start ();
+		for (int i = 0; i < trials; ++i) {
+			dcp::xyz_to_rgb (xyz, dcp::ColourConversion::srgb_to_xyz(), rgb.get(), rgb_stride, threads);
+		}
+		rgb_timer.stop ();
+
+		Timer rgba_timer;
+		rgba_timer.start ();
+		for (int i = 0; i < trials; ++i) {
+			dcp::xyz_to_rgba (xyz, dcp::ColourConversion::srgb_to_xyz(), rgba.get(), rgba_stride, threads);
+		}
+		rgba_timer.stop ();
+
+		cout << threads << " thread(s): xyz_to_rgb " << (trials / rgb_timer.get()) << " fps, xyz_to_rgba " << (trials / rgba_timer.get()) << " fps";
+		if (memcmp (rgb.get(), rgb_reference.get(), rgb_stride * size.height) || memcmp (rgba.get(), rgba_reference.get(), rgba_stride * size.height)) {
+			cout << " (output differs from single-threaded)";
+		}
+		cout << "\n";
+	}
+}
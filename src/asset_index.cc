@@ -0,0 +1,92 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/asset_index.cc
+ *  @brief AssetIndex class.
+ */
+
+#include "asset_index.h"
+#include "asset.h"
+#include "font_asset.h"
+#include "util.h"
+#include <boost/foreach.hpp>
+
+using std::list;
+using std::string;
+using std::make_pair;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using namespace dcp;
+
+AssetIndex::AssetIndex (list<shared_ptr<Asset> > const & assets)
+{
+	BOOST_FOREACH (shared_ptr<Asset> i, assets) {
+		add (i);
+	}
+}
+
+void
+AssetIndex::add (shared_ptr<Asset> asset)
+{
+	/* insert() does not replace an existing entry, so the first asset with a given key wins */
+	_assets.insert (make_pair (canonical_id (asset->id ()), asset));
+
+	shared_ptr<FontAsset> font = dynamic_pointer_cast<FontAsset> (asset);
+	if (font && font->file ()) {
+		_fonts.insert (make_pair (font->file()->leaf().string(), font));
+	}
+}
+
+/** @return Asset with the given ID, or 0 */
+shared_ptr<Asset>
+AssetIndex::find (string id) const
+{
+	boost::unordered_map<string, shared_ptr<Asset> >::const_iterator i = _assets.find (canonical_id (id));
+	if (i == _assets.end ()) {
+		return shared_ptr<Asset> ();
+	}
+
+	return i->second;
+}
+
+/** @return Font asset whose file has the given leaf name, or 0 */
+shared_ptr<FontAsset>
+AssetIndex::find_font (string leaf) const
+{
+	boost::unordered_map<string, shared_ptr<FontAsset> >::const_iterator i = _fonts.find (leaf);
+	if (i == _fonts.end ()) {
+		return shared_ptr<FontAsset> ();
+	}
+
+	return i->second;
+}
@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/asset_index.h
+ *  @brief AssetIndex class.
+ */
+
+#ifndef LIBDCP_ASSET_INDEX_H
+#define LIBDCP_ASSET_INDEX_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <list>
+#include <string>
+
+namespace dcp {
+
+class Asset;
+class FontAsset;
+
+/** @class AssetIndex
+ *  @brief Some assets, indexed so that references to them can be resolved without
+ *  searching through all of them.
+ *
+ *  IDs are matched in the same way as ids_equal.  If more than one asset has the same ID,
+ *  or more than one font has the same file name, the first one that was added is found.
+ */
+class AssetIndex
+{
+public:
+	AssetIndex () {}
+	explicit AssetIndex (std::list<boost::shared_ptr<Asset> > const & assets);
+
+	void add (boost::shared_ptr<Asset> asset);
+
+	boost::shared_ptr<Asset> find (std::string id) const;
+	boost::shared_ptr<FontAsset> find_font (std::string leaf) const;
+
+private:
+	/** assets keyed on their ID, in lower case and with surrounding white space removed */
+	boost::unordered_map<std::string, boost::shared_ptr<Asset> > _assets;
+	/** font assets keyed on the leaf name of their file */
+	boost::unordered_map<std::string, boost::shared_ptr<FontAsset> > _fonts;
+};
+
+}
+
+#endif
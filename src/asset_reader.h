@@ -37,9 +37,14 @@
 #include "dcp_assert.h"
 #include "asset.h"
 #include "crypto_context.h"
+#include "frame_buffer_pool.h"
+#include "frame_read_ahead.h"
 #include <asdcp/AS_DCP.h>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <vector>
 
 namespace dcp {
 
@@ -49,14 +54,13 @@ class AssetReader : public boost::noncopyable
 public:
 	explicit AssetReader (Asset const * asset, boost::optional<Key> key, Standard standard)
 		: _crypto_context (new DecryptionContext (key, standard))
+		, _key (key)
+		, _standard (standard)
 	{
-		_reader = new R ();
 		DCP_ASSERT (asset->file ());
-		Kumu::Result_t const r = _reader->OpenRead (asset->file()->string().c_str());
-		if (ASDCP_FAILURE (r)) {
-			delete _reader;
-			boost::throw_exception (FileError ("could not open MXF file for reading", asset->file().get(), r));
-		}
+		_file = asset->file().get();
+		_reader = open (_file);
+		_pool.reset (new FrameBufferPool<typename F::Buffer> (F::buffer_size (_reader)));
 	}
 
 	~AssetReader ()
@@ -64,14 +68,109 @@ public:
 		delete _reader;
 	}
 
+	/** @param n Frame index.
+	 *  @return Frame, whose data buffer will go back to this reader's pool
+	 *  to be re-used once the frame is destroyed.
+	 */
 	boost::shared_ptr<const F> get_frame (int n) const
 	{
-		return boost::shared_ptr<const F> (new F (_reader, n, _crypto_context));
+		return read_frame (n);
+	}
+
+	/** Read a frame into a buffer owned by the caller; this avoids any allocation
+	 *  if the same buffer is passed in for successive frames.
+	 *  @param n Frame index.
+	 *  @param buffer Buffer to read into, which must be big enough for the frame.
+	 */
+	void get_frame (int n, typename F::Buffer& buffer) const
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (ASDCP_FAILURE (_reader->ReadFrame (n, buffer, _crypto_context->context(), _crypto_context->hmac()))) {
+			boost::throw_exception (ReadError ("could not read frame"));
+		}
+	}
+
+	/** @return A new buffer of the right size to pass to get_frame (int, F::Buffer &) */
+	boost::shared_ptr<typename F::Buffer> make_buffer () const
+	{
+		return boost::shared_ptr<typename F::Buffer> (new typename F::Buffer (_pool->capacity ()));
+	}
+
+	/** Start reading frames in background threads, for callers which want frames in order.
+	 *  @param first First frame index to read.
+	 *  @param end One past the last frame index to read.
+	 *  @param depth Maximum number of frames to read ahead of those asked for.
+	 *  @param threads Number of threads to read with.  Each thread after the first opens the
+	 *  file again and has its own decryption context, so several frames can be decrypted at once.
+	 *  @return Object whose FrameReadAhead::next () returns each frame in turn; it
+	 *  must be destroyed before this reader is.
+	 */
+	boost::shared_ptr<FrameReadAhead<F> > read_ahead (int first, int end, int depth = 8, int threads = 1) const
+	{
+		std::vector<typename FrameReadAhead<F>::ReadFunction> reads;
+		reads.push_back (boost::bind (&AssetReader::read_frame, this, _1));
+		for (int i = 1; i < threads; ++i) {
+			boost::shared_ptr<Channel> channel (new Channel (open (_file), _key, _standard));
+			reads.push_back (boost::bind (&AssetReader::read_channel_frame, channel, _pool, _1));
+		}
+
+		return boost::shared_ptr<FrameReadAhead<F> > (new FrameReadAhead<F> (reads, first, end, std::max (depth, threads)));
 	}
 
 protected:
 	R* _reader;
 	boost::shared_ptr<DecryptionContext> _crypto_context;
+	boost::shared_ptr<FrameBufferPool<typename F::Buffer> > _pool;
+
+private:
+	/** An extra ASDCP reader and decryption context for a read-ahead thread */
+	class Channel : public boost::noncopyable
+	{
+	public:
+		Channel (R* reader, boost::optional<Key> key, Standard standard)
+			: reader (reader)
+			, crypto_context (new DecryptionContext (key, standard))
+		{}
+
+		~Channel ()
+		{
+			delete reader;
+		}
+
+		R* reader;
+		boost::shared_ptr<DecryptionContext> crypto_context;
+	};
+
+	static R* open (boost::filesystem::path file)
+	{
+		R* reader = new R ();
+		Kumu::Result_t const r = reader->OpenRead (file.string().c_str());
+		if (ASDCP_FAILURE (r)) {
+			delete reader;
+			boost::throw_exception (FileError ("could not open MXF file for reading", file, r));
+		}
+		return reader;
+	}
+
+	boost::shared_ptr<const F> read_frame (int n) const
+	{
+		boost::shared_ptr<typename F::Buffer> buffer = _pool->get ();
+		boost::mutex::scoped_lock lm (_mutex);
+		return boost::shared_ptr<const F> (new F (_reader, n, _crypto_context, buffer));
+	}
+
+	static boost::shared_ptr<const F> read_channel_frame (
+		boost::shared_ptr<Channel> channel, boost::shared_ptr<FrameBufferPool<typename F::Buffer> > pool, int n
+		)
+	{
+		return boost::shared_ptr<const F> (new F (channel->reader, n, channel->crypto_context, pool->get ()));
+	}
+
+	/** mutex to serialise reads, as the ASDCP reader may be used from a FrameReadAhead thread */
+	mutable boost::mutex _mutex;
+	boost::filesystem::path _file;
+	boost::optional<Key> _key;
+	Standard _standard;
 };
 
 }
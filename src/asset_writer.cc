@@ -37,6 +37,8 @@
 
 #include "asset_writer.h"
 #include "mxf.h"
+#include "asset.h"
+#include "util.h"
 #include "dcp_assert.h"
 #include "crypto_context.h"
 #include <asdcp/AS_DCP.h>
@@ -54,6 +56,7 @@ AssetWriter::AssetWriter (MXF* mxf, boost::filesystem::path file)
 	, _frames_written (0)
 	, _finalized (false)
 	, _started (false)
+	, _hash_on_finalize (true)
 	, _crypto_context (new EncryptionContext (mxf->key(), mxf->standard()))
 {
 
@@ -67,3 +70,15 @@ AssetWriter::finalize ()
 	_finalized = true;
 	return _started;
 }
+
+/** Unless set_hash_on_finalize (false) has been called, give an asset the digest of the file
+ *  that we have just finalized.  The file has only just been written so it is likely still
+ *  to be cached, and the asset will not need to read it back when it is added to a PKL or CPL.
+ */
+void
+AssetWriter::finalize_hash (Asset* asset) const
+{
+	if (_hash_on_finalize) {
+		asset->set_hash (make_digest (_file, 0));
+	}
+}
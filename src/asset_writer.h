@@ -46,6 +46,7 @@
 namespace dcp {
 
 class MXF;
+class Asset;
 
 /** @class AssetWriter
  *  @brief Parent class for classes which can write MXF-based assets.
@@ -63,9 +64,19 @@ public:
 		return _frames_written;
 	}
 
+	/** @param h true to take the digest of the file in finalize() and give it to the asset
+	 *  (the default), false to leave it to be taken when it is first needed.  Pass false if the
+	 *  asset will never go into a PKL or CPL, so that finalize() need not read the file back.
+	 */
+	void set_hash_on_finalize (bool h) {
+		_hash_on_finalize = h;
+	}
+
 protected:
 	AssetWriter (MXF* mxf, boost::filesystem::path file);
 
+	void finalize_hash (Asset* asset) const;
+
 	/** MXF that we are writing */
 	MXF* _mxf;
 	/** File that we are writing to */
@@ -78,6 +89,8 @@ protected:
 	bool _finalized;
 	/** true if something has been written to this asset */
 	bool _started;
+	/** true to take the file's digest in finalize() */
+	bool _hash_on_finalize;
 	boost::shared_ptr<EncryptionContext> _crypto_context;
 };
 
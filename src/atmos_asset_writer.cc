@@ -109,8 +109,11 @@ AtmosAssetWriter::write (uint8_t const * data, int size)
 bool
 AtmosAssetWriter::finalize ()
 {
-	if (_started && ASDCP_FAILURE (_state->mxf_writer.Finalize())) {
-		boost::throw_exception (MiscError ("could not finalise atmos MXF"));
+	if (_started) {
+		if (ASDCP_FAILURE (_state->mxf_writer.Finalize())) {
+			boost::throw_exception (MiscError ("could not finalise atmos MXF"));
+		}
+		finalize_hash (_asset);
 	}
 
 	_asset->_intrinsic_duration = _frames_written;
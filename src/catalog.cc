@@ -0,0 +1,441 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/catalog.cc
+ *  @brief Catalog class.
+ */
+
+#include "catalog.h"
+#include "dcp.h"
+#include "cpl.h"
+#include "pkl.h"
+#include "reel.h"
+#include "reel_mxf.h"
+#include "reel_picture_asset.h"
+#include "reel_sound_asset.h"
+#include "raw_convert.h"
+#include "util.h"
+#include "dcp_assert.h"
+#include <libcxml/cxml.h>
+#include <libxml++/libxml++.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <set>
+
+using std::map;
+using std::set;
+using std::list;
+using std::string;
+using boost::shared_ptr;
+using boost::optional;
+using namespace dcp;
+
+Catalog::Catalog (boost::filesystem::path file)
+	: _file (file)
+{
+	if (!boost::filesystem::exists (file)) {
+		return;
+	}
+
+	cxml::Document f ("Catalog");
+	f.read_file (file);
+
+	BOOST_FOREACH (cxml::ConstNodePtr i, f.node_children ("Package")) {
+		CatalogPackage package;
+		package.directory = i->string_child ("Directory");
+		package.error = i->optional_string_child ("Error");
+
+		BOOST_FOREACH (cxml::ConstNodePtr j, i->node_children ("XMLFile")) {
+			DigestCache::Key key;
+			key.id = j->optional_string_child("Id").get_value_or ("");
+			key.size = j->optional_number_child<int64_t>("Size").get_value_or (0);
+			key.mtime = j->number_child<int64_t> ("Modified");
+			package.xml_files[j->string_child ("Name")] = key;
+		}
+
+		BOOST_FOREACH (cxml::ConstNodePtr j, i->node_children ("CPL")) {
+			CatalogCPL cpl;
+			cpl.id = j->string_child ("Id");
+			cpl.content_title_text = j->string_child ("ContentTitleText");
+			cpl.content_kind = j->string_child ("ContentKind");
+			cpl.duration = j->number_child<int64_t> ("Duration");
+			optional<string> edit_rate = j->optional_string_child ("EditRate");
+			if (edit_rate) {
+				cpl.edit_rate = Fraction (*edit_rate);
+			}
+			cpl.encrypted = j->string_child ("Encrypted") == "1";
+			BOOST_FOREACH (cxml::ConstNodePtr k, j->node_children ("AssetId")) {
+				cpl.asset_ids.push_back (k->content ());
+			}
+			BOOST_FOREACH (cxml::ConstNodePtr k, j->node_children ("KeyId")) {
+				cpl.key_ids.push_back (k->content ());
+			}
+			package.cpls.push_back (cpl);
+		}
+
+		BOOST_FOREACH (cxml::ConstNodePtr j, i->node_children ("Asset")) {
+			CatalogAsset asset;
+			asset.id = j->string_child ("Id");
+			asset.type = j->string_child ("Type");
+			asset.hash = j->string_child ("Hash");
+			asset.size = j->number_child<int64_t> ("Size");
+			asset.key_id = j->optional_string_child ("KeyId");
+			package.assets.push_back (asset);
+		}
+
+		_packages[package.directory] = package;
+	}
+
+	index ();
+}
+
+/** Write the catalog to its file */
+void
+Catalog::write () const
+{
+	xmlpp::Document doc;
+	xmlpp::Element* root = doc.create_root_node ("Catalog");
+
+	for (map<boost::filesystem::path, CatalogPackage>::const_iterator i = _packages.begin(); i != _packages.end(); ++i) {
+		CatalogPackage const & package = i->second;
+		xmlpp::Element* p = root->add_child ("Package");
+		p->add_child("Directory")->add_child_text (package.directory.string ());
+		if (package.error) {
+			p->add_child("Error")->add_child_text (*package.error);
+		}
+
+		for (map<string, DigestCache::Key>::const_iterator j = package.xml_files.begin(); j != package.xml_files.end(); ++j) {
+			xmlpp::Element* x = p->add_child ("XMLFile");
+			x->add_child("Name")->add_child_text (j->first);
+			x->add_child("Id")->add_child_text (j->second.id);
+			x->add_child("Size")->add_child_text (raw_convert<string> (j->second.size));
+			x->add_child("Modified")->add_child_text (raw_convert<string> (j->second.mtime));
+		}
+
+		BOOST_FOREACH (CatalogCPL const & j, package.cpls) {
+			xmlpp::Element* c = p->add_child ("CPL");
+			c->add_child("Id")->add_child_text (j.id);
+			c->add_child("ContentTitleText")->add_child_text (j.content_title_text);
+			c->add_child("ContentKind")->add_child_text (j.content_kind);
+			c->add_child("Duration")->add_child_text (raw_convert<string> (j.duration));
+			if (j.edit_rate) {
+				c->add_child("EditRate")->add_child_text (j.edit_rate->as_string ());
+			}
+			c->add_child("Encrypted")->add_child_text (j.encrypted ? "1" : "0");
+			BOOST_FOREACH (string const & k, j.asset_ids) {
+				c->add_child("AssetId")->add_child_text (k);
+			}
+			BOOST_FOREACH (string const & k, j.key_ids) {
+				c->add_child("KeyId")->add_child_text (k);
+			}
+		}
+
+		BOOST_FOREACH (CatalogAsset const & j, package.assets) {
+			xmlpp::Element* a = p->add_child ("Asset");
+			a->add_child("Id")->add_child_text (j.id);
+			a->add_child("Type")->add_child_text (j.type);
+			a->add_child("Hash")->add_child_text (j.hash);
+			a->add_child("Size")->add_child_text (raw_convert<string> (j.size));
+			if (j.key_id) {
+				a->add_child("KeyId")->add_child_text (*j.key_id);
+			}
+		}
+	}
+
+	/* Write to a temporary file and rename it so that the catalog is never left half-written */
+	boost::filesystem::path tmp = _file;
+	tmp += ".tmp";
+	doc.write_to_file (tmp.string (), "UTF-8");
+	boost::filesystem::rename (tmp, _file);
+}
+
+/** Look for packages in a directory tree, reading any which are new or whose XML files
+ *  have changed since they were last read, and forgetting any which are no longer there.
+ *  Packages outside root are left alone.
+ *  @param root Directory to look in.
+ *  @return Number of packages that were read.
+ */
+int
+Catalog::scan (boost::filesystem::path root)
+{
+	root = boost::filesystem::canonical (root);
+
+	list<boost::filesystem::path> found;
+	find_packages (root, found);
+	set<boost::filesystem::path> found_set (found.begin(), found.end());
+
+	map<boost::filesystem::path, CatalogPackage>::iterator i = _packages.begin ();
+	while (i != _packages.end ()) {
+		if (relative_to_root (root, i->first) && found_set.find (i->first) == found_set.end ()) {
+			_packages.erase (i++);
+		} else {
+			++i;
+		}
+	}
+
+	int read = 0;
+	BOOST_FOREACH (boost::filesystem::path const & j, found) {
+		map<string, DigestCache::Key> xml = xml_files (j);
+		map<boost::filesystem::path, CatalogPackage>::const_iterator k = _packages.find (j);
+		if (k != _packages.end () && k->second.xml_files == xml) {
+			/* Nothing has changed since we last read this package */
+			continue;
+		}
+
+		_packages[j] = read_package (j, xml);
+		++read;
+	}
+
+	index ();
+	return read;
+}
+
+/** Add directory to packages if it contains an ASSETMAP; otherwise look in its subdirectories */
+void
+Catalog::find_packages (boost::filesystem::path directory, list<boost::filesystem::path>& packages)
+{
+	if (boost::filesystem::exists (directory / "ASSETMAP") || boost::filesystem::exists (directory / "ASSETMAP.xml")) {
+		packages.push_back (directory);
+		return;
+	}
+
+	boost::system::error_code ec;
+	for (boost::filesystem::directory_iterator i (directory, ec); !ec && i != boost::filesystem::directory_iterator(); i.increment (ec)) {
+		if (boost::filesystem::is_directory (i->path ()) && !boost::filesystem::is_symlink (i->path ())) {
+			find_packages (i->path (), packages);
+		}
+	}
+}
+
+/** @return Identity, size and modification time (as used by DigestCache, so that a file which
+ *  is rewritten within the same second is still seen to have changed) of the XML files at the
+ *  top level of a package directory, keyed on leaf name.
+ */
+map<string, DigestCache::Key>
+Catalog::xml_files (boost::filesystem::path directory)
+{
+	map<string, DigestCache::Key> files;
+
+	for (boost::filesystem::directory_iterator i (directory); i != boost::filesystem::directory_iterator(); ++i) {
+		string const leaf = i->path().leaf().string ();
+		if (!boost::filesystem::is_regular_file (i->path ())) {
+			continue;
+		}
+		if (leaf == "ASSETMAP" || boost::algorithm::to_lower_copy (i->path().extension().string ()) == ".xml") {
+			optional<DigestCache::Key> key = DigestCache::key (i->path ());
+			if (key) {
+				files[leaf] = *key;
+			}
+		}
+	}
+
+	return files;
+}
+
+CatalogPackage
+Catalog::read_package (boost::filesystem::path directory, map<string, DigestCache::Key> xml_files)
+{
+	CatalogPackage package;
+	package.directory = directory;
+	package.xml_files = xml_files;
+
+	try {
+		/* Read lazily so that no MXF is opened */
+		DCP dcp (directory);
+		list<VerificationNote> notes;
+		dcp.read (&notes, false, true);
+
+		/* Key IDs of encrypted assets, keyed on asset ID */
+		map<string, string> keys;
+
+		BOOST_FOREACH (shared_ptr<CPL> i, dcp.cpls ()) {
+			CatalogCPL cpl;
+			cpl.id = i->id ();
+			cpl.content_title_text = i->content_title_text ();
+			cpl.content_kind = content_kind_to_string (i->content_kind ());
+			cpl.duration = i->duration ();
+			cpl.encrypted = i->encrypted ();
+
+			if (!i->reels().empty()) {
+				shared_ptr<Reel> first = i->reels().front ();
+				if (first->main_picture ()) {
+					cpl.edit_rate = first->main_picture()->edit_rate ();
+				} else if (first->main_sound ()) {
+					cpl.edit_rate = first->main_sound()->edit_rate ();
+				}
+			}
+
+			BOOST_FOREACH (shared_ptr<const ReelMXF> j, i->reel_mxfs ()) {
+				cpl.asset_ids.push_back (j->asset_ref().id ());
+				if (j->key_id ()) {
+					cpl.key_ids.push_back (*j->key_id ());
+					keys[j->asset_ref().id()] = *j->key_id ();
+				}
+			}
+
+			package.cpls.push_back (cpl);
+		}
+
+		BOOST_FOREACH (shared_ptr<PKL> i, dcp.pkls ()) {
+			BOOST_FOREACH (string const & j, i->asset_ids ()) {
+				CatalogAsset asset;
+				asset.id = j;
+				asset.type = i->type(j).get_value_or ("");
+				asset.hash = i->hash(j).get_value_or ("");
+				asset.size = i->size(j).get_value_or (0);
+				map<string, string>::const_iterator k = keys.find (j);
+				if (k != keys.end ()) {
+					asset.key_id = k->second;
+				}
+				package.assets.push_back (asset);
+			}
+		}
+	} catch (std::exception& e) {
+		/* Remember the error so that we don't try again until the package changes */
+		package.error = e.what ();
+		package.cpls.clear ();
+		package.assets.clear ();
+	}
+
+	return package;
+}
+
+/** Rebuild the indices of CPL, asset and key IDs from _packages */
+void
+Catalog::index ()
+{
+	_cpls.clear ();
+	_assets.clear ();
+	_keys.clear ();
+
+	for (map<boost::filesystem::path, CatalogPackage>::const_iterator i = _packages.begin(); i != _packages.end(); ++i) {
+		/* Use sets so that each package is listed only once for each ID */
+		set<string> cpls;
+		set<string> assets;
+		set<string> keys;
+
+		BOOST_FOREACH (CatalogCPL const & j, i->second.cpls) {
+			cpls.insert (canonical_id (j.id));
+			BOOST_FOREACH (string const & k, j.key_ids) {
+				keys.insert (canonical_id (k));
+			}
+		}
+
+		BOOST_FOREACH (CatalogAsset const & j, i->second.assets) {
+			assets.insert (canonical_id (j.id));
+		}
+
+		BOOST_FOREACH (string const & j, cpls) {
+			_cpls[j].push_back (i->first);
+		}
+		BOOST_FOREACH (string const & j, assets) {
+			_assets[j].push_back (i->first);
+		}
+		BOOST_FOREACH (string const & j, keys) {
+			_keys[j].push_back (i->first);
+		}
+	}
+}
+
+list<boost::filesystem::path>
+Catalog::lookup (Index const & index, string id)
+{
+	Index::const_iterator i = index.find (canonical_id (id));
+	if (i == index.end ()) {
+		return list<boost::filesystem::path> ();
+	}
+
+	return i->second;
+}
+
+list<CatalogPackage>
+Catalog::packages () const
+{
+	list<CatalogPackage> p;
+	for (map<boost::filesystem::path, CatalogPackage>::const_iterator i = _packages.begin(); i != _packages.end(); ++i) {
+		p.push_back (i->second);
+	}
+	return p;
+}
+
+/** @return Details of the package in directory, if it is in the catalog */
+optional<CatalogPackage>
+Catalog::package (boost::filesystem::path directory) const
+{
+	boost::system::error_code ec;
+	boost::filesystem::path const canonical = boost::filesystem::canonical (directory, ec);
+	map<boost::filesystem::path, CatalogPackage>::const_iterator i = _packages.find (ec ? directory : canonical);
+	if (i == _packages.end ()) {
+		return optional<CatalogPackage> ();
+	}
+
+	return i->second;
+}
+
+/** @return Directories of the packages which contain a CPL */
+list<boost::filesystem::path>
+Catalog::packages_with_cpl (string id) const
+{
+	return lookup (_cpls, id);
+}
+
+/** @return Directories of the packages whose PKLs list an asset */
+list<boost::filesystem::path>
+Catalog::packages_with_asset (string id) const
+{
+	return lookup (_assets, id);
+}
+
+/** @return Directories of the packages with CPLs that need a key */
+list<boost::filesystem::path>
+Catalog::packages_with_key (string key_id) const
+{
+	return lookup (_keys, key_id);
+}
+
+/** @return Details of a CPL, if it is in any package in the catalog */
+optional<CatalogCPL>
+Catalog::cpl (string id) const
+{
+	BOOST_FOREACH (boost::filesystem::path const & i, lookup (_cpls, id)) {
+		map<boost::filesystem::path, CatalogPackage>::const_iterator j = _packages.find (i);
+		DCP_ASSERT (j != _packages.end ());
+		BOOST_FOREACH (CatalogCPL const & k, j->second.cpls) {
+			if (ids_equal (k.id, id)) {
+				return k;
+			}
+		}
+	}
+
+	return optional<CatalogCPL> ();
+}
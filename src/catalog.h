@@ -0,0 +1,167 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/catalog.h
+ *  @brief Catalog class.
+ */
+
+#ifndef LIBDCP_CATALOG_H
+#define LIBDCP_CATALOG_H
+
+#include "types.h"
+#include "digest_cache.h"
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/unordered_map.hpp>
+#include <list>
+#include <map>
+#include <string>
+
+namespace dcp {
+
+/** @class CatalogAsset
+ *  @brief Details of an asset in a package, as recorded by a Catalog.
+ */
+class CatalogAsset
+{
+public:
+	CatalogAsset ()
+		: size (0)
+	{}
+
+	std::string id;
+	/** type from the PKL */
+	std::string type;
+	/** hash from the PKL */
+	std::string hash;
+	/** size from the PKL */
+	int64_t size;
+	/** ID of the key that the asset is encrypted with, if a CPL in the package says that it is encrypted */
+	boost::optional<std::string> key_id;
+};
+
+/** @class CatalogCPL
+ *  @brief Details of a CPL in a package, as recorded by a Catalog.
+ */
+class CatalogCPL
+{
+public:
+	CatalogCPL ()
+		: duration (0)
+		, encrypted (false)
+	{}
+
+	std::string id;
+	std::string content_title_text;
+	std::string content_kind;
+	/** length in frames of edit_rate */
+	int64_t duration;
+	/** edit rate of the first reel's picture (or, failing that, sound) */
+	boost::optional<Fraction> edit_rate;
+	bool encrypted;
+	/** IDs of the assets that the CPL's reels refer to, some of which may be in other packages */
+	std::list<std::string> asset_ids;
+	/** IDs of the keys needed to play the CPL */
+	std::list<std::string> key_ids;
+};
+
+/** @class CatalogPackage
+ *  @brief Details of a package (a directory containing an ASSETMAP), as recorded by a Catalog.
+ */
+class CatalogPackage
+{
+public:
+	boost::filesystem::path directory;
+	/** identity, size and modification time of the package's XML files (ASSETMAP, PKLs, CPLs and so on),
+	 *  keyed on leaf name
+	 */
+	std::map<std::string, DigestCache::Key> xml_files;
+	/** the error from reading the package, if it could not be read */
+	boost::optional<std::string> error;
+	std::list<CatalogCPL> cpls;
+	std::list<CatalogAsset> assets;
+};
+
+/** @class Catalog
+ *  @brief An on-disk index of the packages in a library of DCPs.
+ *
+ *  scan() finds packages in a directory tree and reads them with DCP::read (lazily, so that
+ *  MXFs are not opened).  The CPL, asset and key IDs and other details of each package
+ *  are then recorded so that questions such as which packages contain a given CPL can be
+ *  answered without reading the packages again.  A package is only read again by a later
+ *  scan() if its XML files have been changed, added or removed.
+ *
+ *  A Catalog must not be used by more than one thread at a time.
+ */
+class Catalog : public boost::noncopyable
+{
+public:
+	/** @param file File to keep the catalog in; if it exists it will be read */
+	explicit Catalog (boost::filesystem::path file);
+
+	int scan (boost::filesystem::path root);
+	void write () const;
+
+	std::list<CatalogPackage> packages () const;
+	boost::optional<CatalogPackage> package (boost::filesystem::path directory) const;
+
+	std::list<boost::filesystem::path> packages_with_cpl (std::string id) const;
+	std::list<boost::filesystem::path> packages_with_asset (std::string id) const;
+	std::list<boost::filesystem::path> packages_with_key (std::string key_id) const;
+
+	boost::optional<CatalogCPL> cpl (std::string id) const;
+
+private:
+	typedef boost::unordered_map<std::string, std::list<boost::filesystem::path> > Index;
+
+	static void find_packages (boost::filesystem::path directory, std::list<boost::filesystem::path>& packages);
+	static std::map<std::string, DigestCache::Key> xml_files (boost::filesystem::path directory);
+	static CatalogPackage read_package (boost::filesystem::path directory, std::map<std::string, DigestCache::Key> xml_files);
+	void index ();
+	static std::list<boost::filesystem::path> lookup (Index const & index, std::string id);
+
+	boost::filesystem::path _file;
+	/** packages keyed on their (canonical) directory */
+	std::map<boost::filesystem::path, CatalogPackage> _packages;
+	/** directories of packages, keyed on the IDs of the CPLs in them */
+	Index _cpls;
+	/** directories of packages, keyed on the IDs of the assets in them */
+	Index _assets;
+	/** directories of packages, keyed on the IDs of the keys that their CPLs use */
+	Index _keys;
+};
+
+}
+
+#endif
@@ -52,6 +52,7 @@
 #include <openssl/evp.h>
 #include <openssl/pem.h>
 #include <openssl/rsa.h>
+#include <openssl/x509v3.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
@@ -62,6 +63,7 @@ using std::string;
 using std::ofstream;
 using std::ifstream;
 using std::runtime_error;
+using boost::shared_ptr;
 using namespace dcp;
 
 /** Run a shell command.
@@ -112,69 +114,211 @@ command (string cmd)
 	}
 }
 
+/** Create a SHA1 digest of a key's public part.
+ *  @param key Key to use.
+ *  @return Base64-encoded SHA1 digest of the DER-encoded (PKCS#1) RSA public key.
+ */
+static string
+public_key_digest (EVP_PKEY* key)
+{
+	/* This is the same as the part of the base64-decoded `openssl rsa -pubout' output
+	   after its first 24 bytes (for a 2048-bit key), which is what we used to hash.
+	*/
+	unsigned char* der = 0;
+	int const N = i2d_PublicKey (key, &der);
+	if (N <= 0) {
+		throw dcp::MiscError ("could not encode public key");
+	}
+
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	SHA1 (der, N, digest);
+	OPENSSL_free (der);
+
+	char digest_base64[64];
+	return Kumu::base64encode (digest, SHA_DIGEST_LENGTH, digest_base64, 64);
+}
+
 /** Extract a public key from a private key and create a SHA1 digest of it.
- *  @param private_key Private key
- *  @param openssl openssl binary name (or full path if openssl is not on the system path).
- *  @return SHA1 digest of corresponding public key, with escaped / characters.
+ *  @param private_key Private key file.
+ *  @return SHA1 digest of corresponding public key, with / characters escaped for the shell.
  */
 static string
-public_key_digest (boost::filesystem::path private_key, boost::filesystem::path openssl)
+public_key_digest (boost::filesystem::path private_key)
 {
-	boost::filesystem::path public_name = private_key.string() + ".public";
+	string const pem = dcp::file_to_string (private_key);
+	BIO* bio = BIO_new_mem_buf (const_cast<char *> (pem.c_str ()), -1);
+	if (!bio) {
+		throw dcp::MiscError ("could not create memory BIO");
+	}
 
-	/* Create the public key from the private key */
-	command (String::compose("\"%1\" rsa -outform PEM -pubout -in %2 -out %3", openssl.string(), private_key.string(), public_name.string ()));
+	EVP_PKEY* key = PEM_read_bio_PrivateKey (bio, 0, 0, 0);
+	BIO_free (bio);
+	if (!key) {
+		throw dcp::MiscError ("could not read private key");
+	}
 
-	/* Read in the public key from the file */
+	string dig;
+	try {
+		dig = public_key_digest (key);
+	} catch (...) {
+		EVP_PKEY_free (key);
+		throw;
+	}
 
-	string pub;
-	ifstream f (public_name.string().c_str ());
-	if (!f.good ()) {
-		throw dcp::MiscError ("public key not found");
+	EVP_PKEY_free (key);
+
+#ifdef LIBDCP_WINDOWS
+	boost::replace_all (dig, "/", "\\/");
+#else
+	boost::replace_all (dig, "/", "\\\\/");
+#endif
+	return dig;
+}
+
+/** @return A new 2048-bit RSA key */
+static EVP_PKEY*
+make_key ()
+{
+	EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id (EVP_PKEY_RSA, 0);
+	if (!ctx) {
+		throw dcp::MiscError ("could not create key generation context");
 	}
 
-	bool read = false;
-	while (f.good ()) {
-		string line;
-		getline (f, line);
-		if (line.length() >= 10 && line.substr(0, 10) == "-----BEGIN") {
-			read = true;
-		} else if (line.length() >= 8 && line.substr(0, 8) == "-----END") {
-			break;
-		} else if (read) {
-			pub += line;
-		}
+	EVP_PKEY* key = 0;
+	if (EVP_PKEY_keygen_init (ctx) <= 0 || EVP_PKEY_CTX_set_rsa_keygen_bits (ctx, 2048) <= 0 || EVP_PKEY_keygen (ctx, &key) <= 0) {
+		EVP_PKEY_CTX_free (ctx);
+		throw dcp::MiscError ("could not generate RSA key");
+	}
+
+	EVP_PKEY_CTX_free (ctx);
+	return key;
+}
+
+/** Add an entry to an X509 name in the way that `openssl req' does with string_mask = nombstr,
+ *  i.e. as a PrintableString if possible and otherwise as a T61String (never UTF8).
+ */
+static void
+add_name_entry (X509_NAME* name, string field, string value)
+{
+	unsigned char const * v = reinterpret_cast<unsigned char const *> (value.c_str ());
+	int const type = ASN1_PRINTABLE_type (v, value.length()) == V_ASN1_PRINTABLESTRING ? V_ASN1_PRINTABLESTRING : V_ASN1_T61STRING;
+	if (!X509_NAME_add_entry_by_txt (name, field.c_str(), type, v, value.length(), -1, 0)) {
+		throw dcp::MiscError (String::compose ("could not add %1 to certificate name", field));
+	}
+}
+
+static void
+add_extension (X509* certificate, X509* issuer, int nid, string value)
+{
+	X509V3_CTX ctx;
+	X509V3_set_ctx (&ctx, issuer, certificate, 0, 0, 0);
+	X509_EXTENSION* ext = X509V3_EXT_conf_nid (0, &ctx, nid, const_cast<char *> (value.c_str ()));
+	if (!ext) {
+		throw dcp::MiscError (String::compose ("could not create certificate extension %1", value));
 	}
 
-	/* Decode the base64 of the public key */
+	int const r = X509_add_ext (certificate, ext, -1);
+	X509_EXTENSION_free (ext);
+	if (!r) {
+		throw dcp::MiscError (String::compose ("could not add certificate extension %1", value));
+	}
+}
 
-	unsigned char buffer[512];
-	int const N = dcp::base64_decode (pub, buffer, 1024);
+/** Make a certificate in the same form as the `openssl req' / `openssl x509' commands used by
+ *  CertificateChain's constructor.
+ *  @param key Key for the new certificate.
+ *  @param issuer Issuer's certificate, or 0 to make a self-signed certificate.
+ *  @param issuer_key Issuer's key (or key, if issuer is 0).
+ *  @param basic_constraints Value for the basicConstraints extension.
+ *  @param key_usage Value for the keyUsage extension.
+ *  @param authority_key_identifier Value for the authorityKeyIdentifier extension.
+ */
+static X509*
+make_certificate (
+	EVP_PKEY* key,
+	X509* issuer,
+	EVP_PKEY* issuer_key,
+	long serial,
+	int days,
+	string organisation,
+	string organisational_unit,
+	string common_name,
+	string basic_constraints,
+	string key_usage,
+	string authority_key_identifier
+	)
+{
+	X509* certificate = X509_new ();
+	if (!certificate) {
+		throw dcp::MiscError ("could not create certificate");
+	}
+
+	try {
+		X509_NAME* name = X509_NAME_new ();
+		if (!name) {
+			throw dcp::MiscError ("could not create certificate name");
+		}
 
-	/* Hash it with SHA1 (without the first 24 bytes, for reasons that are not entirely clear) */
+		try {
+			add_name_entry (name, "O", organisation);
+			add_name_entry (name, "OU", organisational_unit);
+			add_name_entry (name, "CN", common_name);
+			add_name_entry (name, "dnQualifier", public_key_digest (key));
+		} catch (...) {
+			X509_NAME_free (name);
+			throw;
+		}
+
+		int const r = X509_set_subject_name (certificate, name);
+		X509_NAME_free (name);
+
+		if (
+			!r ||
+			!X509_set_version (certificate, 2) ||
+			!ASN1_INTEGER_set (X509_get_serialNumber (certificate), serial) ||
+			!X509_set_issuer_name (certificate, X509_get_subject_name (issuer ? issuer : certificate)) ||
+			!X509_gmtime_adj (X509_get_notBefore (certificate), 0) ||
+			!X509_gmtime_adj (X509_get_notAfter (certificate), long (days) * 24 * 60 * 60) ||
+			!X509_set_pubkey (certificate, key)
+			) {
+			throw dcp::MiscError ("could not set up certificate");
+		}
 
-	SHA_CTX context;
-	if (!SHA1_Init (&context)) {
-		throw dcp::MiscError ("could not init SHA1 context");
+		X509* const authority = issuer ? issuer : certificate;
+		add_extension (certificate, authority, NID_basic_constraints, basic_constraints);
+		add_extension (certificate, authority, NID_key_usage, key_usage);
+		add_extension (certificate, authority, NID_subject_key_identifier, "hash");
+		add_extension (certificate, authority, NID_authority_key_identifier, authority_key_identifier);
+
+		if (!X509_sign (certificate, issuer_key, EVP_sha256 ())) {
+			throw dcp::MiscError ("could not sign certificate");
+		}
+	} catch (...) {
+		X509_free (certificate);
+		throw;
 	}
 
-	if (!SHA1_Update (&context, buffer + 24, N - 24)) {
-		throw dcp::MiscError ("could not update SHA1 digest");
+	return certificate;
+}
+
+static string
+private_key_to_string (EVP_PKEY* key)
+{
+	BIO* bio = BIO_new (BIO_s_mem ());
+	if (!bio) {
+		throw dcp::MiscError ("could not create memory BIO");
 	}
 
-	unsigned char digest[SHA_DIGEST_LENGTH];
-	if (!SHA1_Final (digest, &context)) {
-		throw dcp::MiscError ("could not finish SHA1 digest");
+	if (!PEM_write_bio_PrivateKey (bio, key, 0, 0, 0, 0, 0)) {
+		BIO_free (bio);
+		throw dcp::MiscError ("could not write private key");
 	}
 
-	char digest_base64[64];
-	string dig = Kumu::base64encode (digest, SHA_DIGEST_LENGTH, digest_base64, 64);
-#ifdef LIBDCP_WINDOWS
-	boost::replace_all (dig, "/", "\\/");
-#else
-	boost::replace_all (dig, "/", "\\\\/");
-#endif
-	return dig;
+	char* data;
+	long const size = BIO_get_mem_data (bio, &data);
+	string const s (data, size);
+	BIO_free (bio);
+	return s;
 }
 
 CertificateChain::CertificateChain (
@@ -219,7 +363,7 @@ CertificateChain::CertificateChain (
 	string const ca_subject = "/O=" + organisation +
 		"/OU=" + organisational_unit +
 		"/CN=" + root_common_name +
-		"/dnQualifier=" + public_key_digest ("ca.key", openssl);
+		"/dnQualifier=" + public_key_digest ("ca.key");
 
 	{
 		command (
@@ -253,7 +397,7 @@ CertificateChain::CertificateChain (
 	string const inter_subject = "/O=" + organisation +
 		"/OU=" + organisational_unit +
 		"/CN=" + intermediate_common_name +
-		"/dnQualifier="	+ public_key_digest ("intermediate.key", openssl);
+		"/dnQualifier="	+ public_key_digest ("intermediate.key");
 
 	{
 		command (
@@ -294,7 +438,7 @@ CertificateChain::CertificateChain (
 	string const leaf_subject = "/O=" + organisation +
 		"/OU=" + organisational_unit +
 		"/CN=" + leaf_common_name +
-		"/dnQualifier="	+ public_key_digest ("leaf.key", openssl);
+		"/dnQualifier="	+ public_key_digest ("leaf.key");
 
 	{
 		command (
@@ -324,6 +468,73 @@ CertificateChain::CertificateChain (
 	boost::filesystem::remove_all (directory);
 }
 
+/** Make a chain in the same form as the openssl commands in our constructor would,
+ *  but using the OpenSSL library directly.  This is much quicker, needs no temporary
+ *  files or openssl binary and is safe to do in several threads at once.
+ */
+CertificateChain
+CertificateChain::generate (
+	string organisation,
+	string organisational_unit,
+	string root_common_name,
+	string intermediate_common_name,
+	string leaf_common_name
+	)
+{
+	/* Valid for 40 years */
+	int const days = 365 * 40;
+
+	CertificateChain chain;
+
+	EVP_PKEY* ca_key = 0;
+	EVP_PKEY* intermediate_key = 0;
+	EVP_PKEY* leaf_key = 0;
+	X509* ca = 0;
+	X509* intermediate = 0;
+	X509* leaf = 0;
+
+	try {
+		ca_key = make_key ();
+		ca = make_certificate (
+			ca_key, 0, ca_key, 5, days, organisation, organisational_unit, root_common_name,
+			"critical,CA:true,pathlen:3", "keyCertSign,cRLSign", "keyid:always,issuer:always"
+			);
+
+		intermediate_key = make_key ();
+		intermediate = make_certificate (
+			intermediate_key, ca, ca_key, 6, days - 1, organisation, organisational_unit, intermediate_common_name,
+			"critical,CA:true,pathlen:2", "keyCertSign,cRLSign", "keyid:always,issuer:always"
+			);
+
+		leaf_key = make_key ();
+		leaf = make_certificate (
+			leaf_key, intermediate, intermediate_key, 7, days - 2, organisation, organisational_unit, leaf_common_name,
+			"critical,CA:false", "digitalSignature,keyEncipherment", "keyid,issuer:always"
+			);
+
+		chain._key = private_key_to_string (leaf_key);
+	} catch (...) {
+		X509_free (ca);
+		X509_free (intermediate);
+		X509_free (leaf);
+		EVP_PKEY_free (ca_key);
+		EVP_PKEY_free (intermediate_key);
+		EVP_PKEY_free (leaf_key);
+		throw;
+	}
+
+	/* Certificate takes ownership of the X509s */
+	chain._certificates.push_back (Certificate (ca));
+	chain._certificates.push_back (Certificate (intermediate));
+	chain._certificates.push_back (Certificate (leaf));
+
+	EVP_PKEY_free (ca_key);
+	EVP_PKEY_free (intermediate_key);
+	EVP_PKEY_free (leaf_key);
+
+	return chain;
+}
+
 CertificateChain::CertificateChain (string s)
 {
 	while (true) {
@@ -629,6 +840,18 @@ CertificateChain::sign (xmlpp::Element* parent, Standard standard) const
  */
 void
 CertificateChain::add_signature_value (xmlpp::Element* parent, string ns, bool add_indentation) const
+{
+	add_signature_value (parent, ns, add_indentation, signing_key ());
+}
+
+/** Sign an XML node using a key which has already been parsed.
+ *
+ *  @param parent Node to sign.
+ *  @param ns Namespace to use for the signature XML nodes.
+ *  @param signing_key Key to sign with, from signing_key(); it must not be in use by any other thread.
+ */
+void
+CertificateChain::add_signature_value (xmlpp::Element* parent, string ns, bool add_indentation, shared_ptr<SigningKey> signing_key) const
 {
 	cxml::Node cp (parent);
 	xmlpp::Node* key_info = cp.node_child("KeyInfo")->node ();
@@ -646,28 +869,24 @@ CertificateChain::add_signature_value (xmlpp::Element* parent, string ns, bool a
 		data->add_child("X509Certificate", ns)->add_child_text (i.certificate());
 	}
 
-	xmlSecDSigCtxPtr signature_context = xmlSecDSigCtxCreate (0);
-	if (signature_context == 0) {
-		throw MiscError ("could not create signature context");
-	}
-
-	signature_context->signKey = xmlSecCryptoAppKeyLoadMemory (
-		reinterpret_cast<const unsigned char *> (_key->c_str()), _key->size(), xmlSecKeyDataFormatPem, 0, 0, 0
-		);
-
-	if (signature_context->signKey == 0) {
-		throw runtime_error ("could not read private key");
-	}
-
 	if (add_indentation) {
 		indent (parent, 2);
 	}
-	int const r = xmlSecDSigCtxSign (signature_context, parent->cobj ());
-	if (r < 0) {
-		throw MiscError (String::compose ("could not sign (%1)", r));
+
+	signing_key->sign (parent);
+}
+
+/** @return A new SigningKey made from our private key, which can then be passed to
+ *  add_signature_value to sign many nodes without parsing the key each time.
+ */
+shared_ptr<SigningKey>
+CertificateChain::signing_key () const
+{
+	if (!_key) {
+		throw MiscError ("no private key available for signing");
 	}
 
-	xmlSecDSigCtxDestroy (signature_context);
+	return shared_ptr<SigningKey> (new SigningKey (_key.get ()));
 }
 
 string
@@ -680,3 +899,54 @@ CertificateChain::chain () const
 
 	return o;
 }
+
+/** @param pem Private key in PEM format */
+SigningKey::SigningKey (string pem)
+	: _key (0)
+	, _context (0)
+{
+	_key = xmlSecCryptoAppKeyLoadMemory (
+		reinterpret_cast<const unsigned char *> (pem.c_str()), pem.size(), xmlSecKeyDataFormatPem, 0, 0, 0
+		);
+
+	if (_key == 0) {
+		throw runtime_error ("could not read private key");
+	}
+
+	_context = xmlSecDSigCtxCreate (0);
+	if (_context == 0) {
+		xmlSecKeyDestroy (_key);
+		throw MiscError ("could not create signature context");
+	}
+}
+
+SigningKey::~SigningKey ()
+{
+	xmlSecDSigCtxDestroy (_context);
+	xmlSecKeyDestroy (_key);
+}
+
+/** Fill in the digest and signature values of a Signature node.
+ *  @param node Signature node.
+ */
+void
+SigningKey::sign (xmlpp::Element* node)
+{
+	/* The context takes ownership of its signKey, so give it a copy of ours;
+	   duplicating a parsed key is much cheaper than parsing the PEM again.
+	*/
+	_context->signKey = xmlSecKeyDuplicate (_key);
+	if (_context->signKey == 0) {
+		throw MiscError ("could not copy private key");
+	}
+
+	int const r = xmlSecDSigCtxSign (_context, node->cobj ());
+
+	/* Reset the context (which frees the copy of the key) ready for next time */
+	xmlSecDSigCtxFinalize (_context);
+	xmlSecDSigCtxInitialize (_context, 0);
+
+	if (r < 0) {
+		throw MiscError (String::compose ("could not sign (%1)", r));
+	}
+}
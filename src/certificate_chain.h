@@ -42,11 +42,17 @@
 #include "types.h"
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace xmlpp {
 	class Node;
+	class Element;
 }
 
+struct _xmlSecKey;
+struct _xmlSecDSigCtx;
+
 struct certificates_validation1;
 struct certificates_validation2;
 struct certificates_validation3;
@@ -58,6 +64,27 @@ struct certificates_validation8;
 
 namespace dcp {
 
+/** @class SigningKey
+ *  @brief A private key which has been parsed once, ready to sign any number of XML documents.
+ *
+ *  Each SigningKey also holds an xmlsec signature context which is re-used for each
+ *  signature, so a SigningKey must not be used by more than one thread at once.
+ *  Threads which sign in parallel should each get their own from
+ *  CertificateChain::signing_key().
+ */
+class SigningKey : public boost::noncopyable
+{
+public:
+	explicit SigningKey (std::string pem);
+	~SigningKey ();
+
+	void sign (xmlpp::Element* node);
+
+private:
+	_xmlSecKey* _key;
+	_xmlSecDSigCtx* _context;
+};
+
 /** @class CertificateChain
  *  @brief A chain of any number of certificates, from root to leaf.
  */
@@ -85,6 +112,14 @@ public:
 
 	explicit CertificateChain (std::string);
 
+	static CertificateChain generate (
+		std::string organisation = "example.org",
+		std::string organisational_unit = "example.org",
+		std::string root_common_name = ".smpte-430-2.ROOT.NOT_FOR_PRODUCTION",
+		std::string intermediate_common_name = ".smpte-430-2.INTERMEDIATE.NOT_FOR_PRODUCTION",
+		std::string leaf_common_name = "CS.smpte-430-2.LEAF.NOT_FOR_PRODUCTION"
+		);
+
 	void add (Certificate c);
 	void remove (Certificate c);
 	void remove (int);
@@ -104,6 +139,11 @@ public:
 
 	void sign (xmlpp::Element* parent, Standard standard) const;
 	void add_signature_value (xmlpp::Element* parent, std::string ns, bool add_indentation) const;
+	void add_signature_value (
+		xmlpp::Element* parent, std::string ns, bool add_indentation, boost::shared_ptr<SigningKey> signing_key
+		) const;
+
+	boost::shared_ptr<SigningKey> signing_key () const;
 
 	boost::optional<std::string> key () const {
 		return _key;
@@ -57,6 +57,7 @@ class XMLMetadata;
 class MXFMetadata;
 class CertificateChain;
 class DecryptedKDM;
+class AssetIndex;
 
 /** @class CPL
  *  @brief A Composition Playlist.
@@ -133,7 +134,8 @@ public:
 		boost::shared_ptr<const CertificateChain>
 		) const;
 
-	void resolve_refs (std::list<boost::shared_ptr<Asset> >);
+	void resolve_refs (std::list<boost::shared_ptr<Asset> > const &);
+	void resolve_refs (AssetIndex const &);
 
 	int64_t duration () const;
 
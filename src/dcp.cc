@@ -58,14 +58,18 @@
 #include "font_asset.h"
 #include "pkl.h"
 #include "asset_factory.h"
+#include "lazy_asset.h"
+#include "asset_index.h"
 #include "verify.h"
 #include <asdcp/AS_DCP.h>
 #include <xmlsec/xmldsig.h>
 #include <xmlsec/app.h>
 #include <libxml++/libxml++.h>
+#include <libxml/xmlreader.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
 
 using std::string;
 using std::list;
@@ -96,6 +100,36 @@ DCP::DCP (boost::filesystem::path directory)
 	_directory = boost::filesystem::canonical (_directory);
 }
 
+/** Find the name of an XML file's root node without parsing the rest of it.
+ *  @param path XML file.
+ *  @return Local name of the root node.
+ */
+static string
+root_node_name (boost::filesystem::path path)
+{
+	xmlTextReaderPtr reader = xmlReaderForFile (path.string().c_str(), 0, XML_PARSE_NONET);
+	if (!reader) {
+		throw ReadError (String::compose("XML error in %1", path.string()), "could not open file");
+	}
+
+	optional<string> name;
+	int r;
+	while ((r = xmlTextReaderRead (reader)) == 1) {
+		if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT) {
+			name = reinterpret_cast<char const *> (xmlTextReaderConstLocalName (reader));
+			break;
+		}
+	}
+
+	xmlFreeTextReader (reader);
+
+	if (!name) {
+		throw ReadError (String::compose("XML error in %1", path.string()), r == -1 ? "could not parse file" : "no root node");
+	}
+
+	return *name;
+}
+
 /** Read a DCP.  This method does not do any deep checking of the DCP's validity, but
  *  if it comes across any bad things it will do one of two things.
  *
@@ -108,7 +142,7 @@ DCP::DCP (boost::filesystem::path directory)
  *  in a note being added to the list.
  */
 void
-DCP::read (list<dcp::VerificationNote>* notes, bool ignore_incorrect_picture_mxf_type)
+DCP::read (list<dcp::VerificationNote>* notes, bool ignore_incorrect_picture_mxf_type, bool lazy)
 {
 	/* Read the ASSETMAP and PKL */
 
@@ -183,6 +217,17 @@ DCP::read (list<dcp::VerificationNote>* notes, bool ignore_incorrect_picture_mxf
 	*/
 	list<shared_ptr<Asset> > other_assets;
 
+	/* The <Type> of each asset, from the first PKL which contains it */
+	boost::unordered_map<string, string> pkl_types;
+	BOOST_FOREACH (shared_ptr<PKL> i, _pkls) {
+		BOOST_FOREACH (string const & j, i->asset_ids ()) {
+			optional<string> type = i->type (j);
+			if (type) {
+				pkl_types.insert (make_pair (j, *type));
+			}
+		}
+	}
+
 	for (map<string, boost::filesystem::path>::const_iterator i = paths.begin(); i != paths.end(); ++i) {
 		boost::filesystem::path path = _directory / i->second;
 
@@ -204,55 +249,48 @@ DCP::read (list<dcp::VerificationNote>* notes, bool ignore_incorrect_picture_mxf
 			continue;
 		}
 
-		/* Find the <Type> for this asset from the PKL that contains the asset */
-		optional<string> pkl_type;
-		BOOST_FOREACH (shared_ptr<PKL> j, _pkls) {
-			pkl_type = j->type(i->first);
-			if (pkl_type) {
-				break;
-			}
-		}
+		boost::unordered_map<string, string>::const_iterator type = pkl_types.find (i->first);
+		DCP_ASSERT (type != pkl_types.end ());
+		string const & pkl_type = type->second;
 
-		DCP_ASSERT (pkl_type);
+		if (pkl_type == CPL::static_pkl_type(*_standard) || pkl_type == InteropSubtitleAsset::static_pkl_type(*_standard)) {
+			string const root = root_node_name (path);
 
-		if (*pkl_type == CPL::static_pkl_type(*_standard) || *pkl_type == InteropSubtitleAsset::static_pkl_type(*_standard)) {
-			xmlpp::DomParser* p = new xmlpp::DomParser;
 			try {
-				p->parse_file (path.string());
-			} catch (std::exception& e) {
-				delete p;
-				throw ReadError(String::compose("XML error in %1", path.string()), e.what());
-			}
-
-			string const root = p->get_document()->get_root_node()->get_name ();
-			delete p;
-
-			if (root == "CompositionPlaylist") {
-				shared_ptr<CPL> cpl (new CPL (path));
-				if (_standard && cpl->standard() && cpl->standard().get() != _standard.get() && notes) {
-					notes->push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::MISMATCHED_STANDARD));
-				}
-				_cpls.push_back (cpl);
-			} else if (root == "DCSubtitle") {
-				if (_standard && _standard.get() == SMPTE) {
-					notes->push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::MISMATCHED_STANDARD));
+				if (root == "CompositionPlaylist") {
+					shared_ptr<CPL> cpl (new CPL (path));
+					if (_standard && cpl->standard() && cpl->standard().get() != _standard.get() && notes) {
+						notes->push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::MISMATCHED_STANDARD));
+					}
+					_cpls.push_back (cpl);
+				} else if (root == "DCSubtitle") {
+					if (_standard && _standard.get() == SMPTE && notes) {
+						notes->push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::MISMATCHED_STANDARD));
+					}
+					other_assets.push_back (shared_ptr<InteropSubtitleAsset> (new InteropSubtitleAsset (path)));
 				}
-				other_assets.push_back (shared_ptr<InteropSubtitleAsset> (new InteropSubtitleAsset (path)));
+			} catch (xmlpp::parse_error& e) {
+				/* root_node_name only reads as far as the root node, so errors further on turn up here */
+				throw ReadError(String::compose("XML error in %1", path.string()), e.what());
 			}
 		} else if (
-			*pkl_type == PictureAsset::static_pkl_type(*_standard) ||
-			*pkl_type == SoundAsset::static_pkl_type(*_standard) ||
-			*pkl_type == AtmosAsset::static_pkl_type(*_standard) ||
-			*pkl_type == SMPTESubtitleAsset::static_pkl_type(*_standard)
+			pkl_type == PictureAsset::static_pkl_type(*_standard) ||
+			pkl_type == SoundAsset::static_pkl_type(*_standard) ||
+			pkl_type == AtmosAsset::static_pkl_type(*_standard) ||
+			pkl_type == SMPTESubtitleAsset::static_pkl_type(*_standard)
 			) {
 
-			other_assets.push_back (asset_factory(path, ignore_incorrect_picture_mxf_type));
-		} else if (*pkl_type == FontAsset::static_pkl_type(*_standard)) {
+			if (lazy) {
+				other_assets.push_back (shared_ptr<LazyAsset> (new LazyAsset (i->first, path, ignore_incorrect_picture_mxf_type)));
+			} else {
+				other_assets.push_back (asset_factory(path, ignore_incorrect_picture_mxf_type));
+			}
+		} else if (pkl_type == FontAsset::static_pkl_type(*_standard)) {
 			other_assets.push_back (shared_ptr<FontAsset> (new FontAsset (i->first, path)));
-		} else if (*pkl_type == "image/png") {
+		} else if (pkl_type == "image/png") {
 			/* It's an Interop PNG subtitle; let it go */
 		} else {
-			throw ReadError (String::compose("Unknown asset type %1 in PKL", *pkl_type));
+			throw ReadError (String::compose("Unknown asset type %1 in PKL", pkl_type));
 		}
 	}
 
@@ -271,7 +309,13 @@ DCP::read (list<dcp::VerificationNote>* notes, bool ignore_incorrect_picture_mxf
 }
 
 void
-DCP::resolve_refs (list<shared_ptr<Asset> > assets)
+DCP::resolve_refs (list<shared_ptr<Asset> > const & assets)
+{
+	resolve_refs (AssetIndex (assets));
+}
+
+void
+DCP::resolve_refs (AssetIndex const & assets)
 {
 	BOOST_FOREACH (shared_ptr<CPL> i, cpls ()) {
 		i->resolve_refs (assets);
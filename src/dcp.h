@@ -67,6 +67,7 @@ class CertificateChain;
 class DecryptedKDM;
 class Asset;
 class ReadError;
+class AssetIndex;
 
 /** @class DCP
  *  @brief A class to create or read a DCP.
@@ -89,8 +90,11 @@ public:
 	 *  @param ignore_incorrect_picture_mxf_type true to try loading MXF files marked as monoscopic
 	 *  as stereoscopic if the monoscopic load fails; fixes problems some 3D DCPs that (I think)
 	 *  have an incorrect descriptor in their MXF.
+	 *  @param lazy true to open no MXF files here; each one is opened when its asset is first
+	 *  asked for, so any error in reading it will also come then.  This makes it much quicker to
+	 *  find out about a DCP's CPLs when its assets are not needed.
 	 */
-	void read (std::list<VerificationNote>* notes = 0, bool ignore_incorrect_picture_mxf_type = false);
+	void read (std::list<VerificationNote>* notes = 0, bool ignore_incorrect_picture_mxf_type = false, bool lazy = false);
 
 	/** Compare this DCP with another, according to various options.
 	 *  @param other DCP to compare this one to.
@@ -116,7 +120,8 @@ public:
 		NameFormat name_format = NameFormat("%t")
 	);
 
-	void resolve_refs (std::list<boost::shared_ptr<Asset> > assets);
+	void resolve_refs (std::list<boost::shared_ptr<Asset> > const & assets);
+	void resolve_refs (AssetIndex const & assets);
 
 	/** @return Standard of a DCP that was read in */
 	boost::optional<Standard> standard () const {
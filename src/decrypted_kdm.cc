@@ -41,6 +41,7 @@
 #include "cpl.h"
 #include "certificate_chain.h"
 #include "dcp_assert.h"
+#include "private_key.h"
 #include "compose.hpp"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_util.h>
@@ -48,6 +49,10 @@
 #include <openssl/pem.h>
 #include <openssl/err.h>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 using std::list;
 using std::vector;
@@ -57,8 +62,10 @@ using std::setfill;
 using std::hex;
 using std::pair;
 using std::map;
+using std::min;
 using boost::shared_ptr;
 using boost::optional;
+using boost::function;
 using namespace dcp;
 
 /* Magic value specified by SMPTE S430-1-2006 */
@@ -129,19 +136,19 @@ get (uint8_t ** p, int N)
 
 DecryptedKDM::DecryptedKDM (EncryptedKDM const & kdm, string private_key)
 {
-	/* Read the private key */
-
-	BIO* bio = BIO_new_mem_buf (const_cast<char *> (private_key.c_str ()), -1);
-	if (!bio) {
-		throw MiscError ("could not create memory BIO");
-	}
+	decrypt (kdm, PrivateKey (private_key));
+}
 
-	RSA* rsa = PEM_read_bio_RSAPrivateKey (bio, 0, 0, 0);
-	if (!rsa) {
-		throw FileError ("could not read RSA private key file", private_key, errno);
-	}
+DecryptedKDM::DecryptedKDM (EncryptedKDM const & kdm, PrivateKey const & private_key)
+{
+	decrypt (kdm, private_key);
+}
 
-	/* Use the private key to decrypt the keys */
+/** Use a private key to decrypt a KDM's keys and add them to this object */
+void
+DecryptedKDM::decrypt (EncryptedKDM const & kdm, PrivateKey const & private_key)
+{
+	vector<unsigned char> decrypted (private_key.size ());
 
 	BOOST_FOREACH (string const & i, kdm.keys ()) {
 		/* Decode the base-64-encoded cipher value from the KDM */
@@ -149,18 +156,12 @@ DecryptedKDM::DecryptedKDM (EncryptedKDM const & kdm, string private_key)
 		int const cipher_value_len = base64_decode (i, cipher_value, sizeof (cipher_value));
 
 		/* Decrypt it */
-		unsigned char * decrypted = new unsigned char[RSA_size(rsa)];
-		int const decrypted_len = RSA_private_decrypt (cipher_value_len, cipher_value, decrypted, rsa, RSA_PKCS1_OAEP_PADDING);
+		int const decrypted_len = private_key.decrypt (cipher_value, cipher_value_len, &decrypted[0]);
 		if (decrypted_len == -1) {
-			delete[] decrypted;
-#if OPENSSL_VERSION_NUMBER > 0x10100000L
-			throw KDMDecryptionError (ERR_error_string (ERR_get_error(), 0), cipher_value_len, RSA_bits(rsa));
-#else
-			throw KDMDecryptionError (ERR_error_string (ERR_get_error(), 0), cipher_value_len, rsa->n->dmax);
-#endif
+			throw KDMDecryptionError (ERR_error_string (ERR_get_error(), 0), cipher_value_len, private_key.bits ());
 		}
 
-		unsigned char* p = decrypted;
+		unsigned char* p = &decrypted[0];
 		switch (decrypted_len) {
 		case 134:
 		{
@@ -206,13 +207,8 @@ DecryptedKDM::DecryptedKDM (EncryptedKDM const & kdm, string private_key)
 		default:
 			DCP_ASSERT (false);
 		}
-
-		delete[] decrypted;
 	}
 
-	RSA_free (rsa);
-	BIO_free (bio);
-
 	_annotation_text = kdm.annotation_text ();
 	_content_title_text = kdm.content_title_text ();
 	_issue_date = kdm.issue_date ();
@@ -300,6 +296,18 @@ DecryptedKDM::add_key (DecryptedKDMKey key)
 	_keys.push_back (key);
 }
 
+void
+DecryptedKDM::check_signer_dates (shared_ptr<const CertificateChain> signer) const
+{
+	BOOST_FOREACH (dcp::Certificate i, signer->leaf_to_root()) {
+		if (day_greater_than_or_equal(dcp::LocalTime(i.not_before()), _not_valid_before)) {
+			throw BadKDMDateError (true);
+		} else if (day_less_than_or_equal(dcp::LocalTime(i.not_after()), _not_valid_after)) {
+			throw BadKDMDateError (false);
+		}
+	}
+}
+
 EncryptedKDM
 DecryptedKDM::encrypt (
 	shared_ptr<const CertificateChain> signer,
@@ -312,14 +320,165 @@ DecryptedKDM::encrypt (
 {
 	DCP_ASSERT (!_keys.empty ());
 
-	BOOST_FOREACH (dcp::Certificate i, signer->leaf_to_root()) {
-		if (day_greater_than_or_equal(dcp::LocalTime(i.not_before()), _not_valid_before)) {
-			throw BadKDMDateError (true);
-		} else if (day_less_than_or_equal(dcp::LocalTime(i.not_after()), _not_valid_after)) {
-			throw BadKDMDateError (false);
+	check_signer_dates (signer);
+
+	return encrypt (
+		signer,
+		signer->signing_key (),
+		signer->leaf().thumbprint (),
+		recipient,
+		trusted_devices,
+		formulation,
+		disable_forensic_marking_picture,
+		disable_forensic_marking_audio
+		);
+}
+
+namespace {
+
+/** @class KDMPool
+ *  @brief Worker threads for DecryptedKDM::encrypt with many recipients.
+ */
+class KDMPool : public boost::noncopyable
+{
+public:
+	typedef function<EncryptedKDM (shared_ptr<SigningKey>, Certificate)> Encrypter;
+
+	KDMPool (shared_ptr<const CertificateChain> signer, vector<Certificate> const & recipients, Encrypter encrypter)
+		: _signer (signer)
+		, _recipients (recipients)
+		, _kdms (recipients.size ())
+		, _next (0)
+		, _encrypter (encrypter)
+	{
+
+	}
+
+	vector<EncryptedKDM> run (int threads)
+	{
+		boost::thread_group group;
+		for (int i = 0; i < min (threads, static_cast<int> (_recipients.size ())); ++i) {
+			group.create_thread (boost::bind (&KDMPool::thread, this));
+		}
+		group.join_all ();
+
+		if (_exception) {
+			boost::rethrow_exception (_exception);
+		}
+
+		vector<EncryptedKDM> kdms;
+		BOOST_FOREACH (shared_ptr<EncryptedKDM> i, _kdms) {
+			kdms.push_back (*i);
+		}
+		return kdms;
+	}
+
+private:
+	void thread ()
+	{
+		try {
+			/* Each thread parses the key once and then keeps its own signature context */
+			shared_ptr<SigningKey> signing_key = _signer->signing_key ();
+
+			while (true) {
+				size_t n;
+				{
+					boost::mutex::scoped_lock lm (_mutex);
+					if (_next >= _recipients.size () || _exception) {
+						return;
+					}
+					n = _next++;
+				}
+
+				shared_ptr<EncryptedKDM> kdm (new EncryptedKDM (_encrypter (signing_key, _recipients[n])));
+				boost::mutex::scoped_lock lm (_mutex);
+				_kdms[n] = kdm;
+			}
+		} catch (...) {
+			boost::mutex::scoped_lock lm (_mutex);
+			if (!_exception) {
+				_exception = boost::current_exception ();
+			}
+		}
+	}
+
+	shared_ptr<const CertificateChain> _signer;
+	vector<Certificate> const & _recipients;
+	vector<shared_ptr<EncryptedKDM> > _kdms;
+	size_t _next;
+	Encrypter _encrypter;
+	boost::exception_ptr _exception;
+	boost::mutex _mutex;
+};
+
+}
+
+vector<EncryptedKDM>
+DecryptedKDM::encrypt (
+	shared_ptr<const CertificateChain> signer,
+	vector<Certificate> recipients,
+	vector<string> trusted_devices,
+	Formulation formulation,
+	bool disable_forensic_marking_picture,
+	optional<int> disable_forensic_marking_audio,
+	int threads
+	) const
+{
+	DCP_ASSERT (!_keys.empty ());
+
+	check_signer_dates (signer);
+
+	/* These are the same for every KDM, so only work them out once */
+	string const thumbprint = signer->leaf().thumbprint ();
+
+	if (threads <= 1 || recipients.size() < 2) {
+		shared_ptr<SigningKey> signing_key = signer->signing_key ();
+		vector<EncryptedKDM> kdms;
+		BOOST_FOREACH (Certificate const & i, recipients) {
+			kdms.push_back (
+				encrypt (
+					signer, signing_key, thumbprint, i, trusted_devices, formulation,
+					disable_forensic_marking_picture, disable_forensic_marking_audio
+					)
+				);
 		}
+		return kdms;
 	}
 
+	/* The encrypt overload we want is private, so bind it here rather than in KDMPool */
+	EncryptedKDM (DecryptedKDM::*encrypter) (
+		shared_ptr<const CertificateChain>, shared_ptr<SigningKey>, string, Certificate,
+		vector<string>, Formulation, bool, optional<int>
+		) const = &DecryptedKDM::encrypt;
+
+	KDMPool pool (
+		signer,
+		recipients,
+		boost::bind (
+			encrypter, this, signer, _1, thumbprint, _2, trusted_devices, formulation,
+			disable_forensic_marking_picture, disable_forensic_marking_audio
+			)
+		);
+
+	return pool.run (threads);
+}
+
+/** Encrypt our keys for one recipient and make a signed KDM.
+ *  @param signing_key Key from signer->signing_key() which is not being used by any other thread.
+ *  @param signer_thumbprint Thumbprint of signer's leaf certificate.
+ */
+EncryptedKDM
+DecryptedKDM::encrypt (
+	shared_ptr<const CertificateChain> signer,
+	shared_ptr<SigningKey> signing_key,
+	string signer_thumbprint,
+	Certificate recipient,
+	vector<string> trusted_devices,
+	Formulation formulation,
+	bool disable_forensic_marking_picture,
+	optional<int> disable_forensic_marking_audio
+	) const
+{
 	list<pair<string, string> > key_ids;
 	list<string> keys;
 	BOOST_FOREACH (DecryptedKDMKey const & i, _keys) {
@@ -333,7 +492,7 @@ DecryptedKDM::encrypt (
 
 		put (&p, smpte_structure_id, 16);
 
-		base64_decode (signer->leaf().thumbprint (), p, 20);
+		base64_decode (signer_thumbprint, p, 20);
 		p += 20;
 
 		put_uuid (&p, i.cpl_id ());
@@ -366,13 +525,9 @@ DecryptedKDM::encrypt (
 		keys.push_back (lines);
 	}
 
-	string device_list_description = recipient.subject_common_name ();
-	if (device_list_description.find (".") != string::npos) {
-		device_list_description = device_list_description.substr (device_list_description.find (".") + 1);
-	}
-
 	return EncryptedKDM (
 		signer,
+		signing_key,
 		recipient,
 		trusted_devices,
 		_keys.front().cpl_id (),
@@ -387,3 +542,96 @@ DecryptedKDM::encrypt (
 		keys
 		);
 }
+
+namespace {
+
+/** @class DecryptPool
+ *  @brief Worker threads for decrypt_kdms.
+ */
+class DecryptPool : public boost::noncopyable
+{
+public:
+	DecryptPool (vector<EncryptedKDM> const & kdms, PrivateKey const & private_key)
+		: _kdms (kdms)
+		, _private_key (private_key)
+		, _decrypted (kdms.size ())
+		, _next (0)
+	{
+
+	}
+
+	vector<DecryptedKDM> run (int threads)
+	{
+		boost::thread_group group;
+		for (int i = 0; i < min (threads, static_cast<int> (_kdms.size ())); ++i) {
+			group.create_thread (boost::bind (&DecryptPool::thread, this));
+		}
+		group.join_all ();
+
+		if (_exception) {
+			boost::rethrow_exception (_exception);
+		}
+
+		vector<DecryptedKDM> decrypted;
+		BOOST_FOREACH (shared_ptr<DecryptedKDM> i, _decrypted) {
+			decrypted.push_back (*i);
+		}
+		return decrypted;
+	}
+
+private:
+	void thread ()
+	{
+		while (true) {
+			size_t n;
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				if (_next >= _kdms.size () || _exception) {
+					return;
+				}
+				n = _next++;
+			}
+
+			try {
+				shared_ptr<DecryptedKDM> kdm (new DecryptedKDM (_kdms[n], _private_key));
+				boost::mutex::scoped_lock lm (_mutex);
+				_decrypted[n] = kdm;
+			} catch (...) {
+				boost::mutex::scoped_lock lm (_mutex);
+				if (!_exception) {
+					_exception = boost::current_exception ();
+				}
+			}
+		}
+	}
+
+	vector<EncryptedKDM> const & _kdms;
+	PrivateKey const & _private_key;
+	vector<shared_ptr<DecryptedKDM> > _decrypted;
+	size_t _next;
+	boost::exception_ptr _exception;
+	boost::mutex _mutex;
+};
+
+}
+
+/** Decrypt a set of KDMs which were all made for the same private key.
+ *  @param kdms KDMs to decrypt.
+ *  @param private_key Private key to decrypt with.
+ *  @param threads Number of threads to use.
+ *  @return Decrypted KDMs, in the same order as kdms.
+ */
+vector<DecryptedKDM>
+dcp::decrypt_kdms (vector<EncryptedKDM> const & kdms, PrivateKey const & private_key, int threads)
+{
+	if (threads <= 1 || kdms.size() < 2) {
+		vector<DecryptedKDM> decrypted;
+		BOOST_FOREACH (EncryptedKDM const & i, kdms) {
+			decrypted.push_back (DecryptedKDM (i, private_key));
+		}
+		return decrypted;
+	}
+
+	DecryptPool pool (kdms, private_key);
+	return pool.run (threads);
+}
@@ -53,6 +53,8 @@ namespace dcp {
 class DecryptedKDMKey;
 class EncryptedKDM;
 class CertificateChain;
+class SigningKey;
+class PrivateKey;
 class CPL;
 class ReelMXF;
 
@@ -73,6 +75,11 @@ public:
 	 */
 	DecryptedKDM (EncryptedKDM const & kdm, std::string private_key);
 
+	/** @param kdm Encrypted KDM.
+	 *  @param private_key Private key, which can be re-used for other KDMs.
+	 */
+	DecryptedKDM (EncryptedKDM const & kdm, PrivateKey const & private_key);
+
 	/** Create an empty DecryptedKDM.  After creation you must call
 	 *  add_key() to add each key that you want in the KDM.
 	 *
@@ -138,6 +145,28 @@ public:
 		boost::optional<int> disable_forensic_marking_audio
 		) const;
 
+	/** Encrypt this KDM's keys and sign a KDM for each of a list of recipients.  This is
+	 *  equivalent to calling encrypt() for each recipient, but the signer's private key is only
+	 *  parsed once per thread and the KDMs are made in parallel.
+	 *  @param signer Chain to sign with.
+	 *  @param recipients Certificates of the projectors/servers which should receive KDMs.
+	 *  @param trusted_devices Thumbprints of extra trusted devices which should be written to each KDM.
+	 *  @param formulation Formulation to use for the encrypted KDMs.
+	 *  @param disable_forensic_marking_picture true to disable forensic marking of picture.
+	 *  @param disable_forensic_marking_audio as for encrypt().
+	 *  @param threads Number of threads to use.
+	 *  @return Encrypted KDMs, in the same order as recipients.
+	 */
+	std::vector<EncryptedKDM> encrypt (
+		boost::shared_ptr<const CertificateChain> signer,
+		std::vector<Certificate> recipients,
+		std::vector<std::string> trusted_devices,
+		Formulation formulation,
+		bool disable_forensic_marking_picture,
+		boost::optional<int> disable_forensic_marking_audio,
+		int threads
+		) const;
+
 	void add_key (boost::optional<std::string> type, std::string key_id, Key key, std::string cpl_id, Standard standard);
 	void add_key (DecryptedKDMKey key);
 
@@ -162,6 +191,20 @@ private:
 
 	friend class ::decrypted_kdm_test;
 
+	void decrypt (EncryptedKDM const & kdm, PrivateKey const & private_key);
+	void check_signer_dates (boost::shared_ptr<const CertificateChain> signer) const;
+
+	EncryptedKDM encrypt (
+		boost::shared_ptr<const CertificateChain> signer,
+		boost::shared_ptr<SigningKey> signing_key,
+		std::string signer_thumbprint,
+		Certificate recipient,
+		std::vector<std::string> trusted_devices,
+		Formulation formulation,
+		bool disable_forensic_marking_picture,
+		boost::optional<int> disable_forensic_marking_audio
+		) const;
+
 	static void put_uuid (uint8_t ** d, std::string id);
 	static std::string get_uuid (unsigned char ** p);
 
@@ -173,6 +216,8 @@ private:
 	std::list<DecryptedKDMKey> _keys;
 };
 
+extern std::vector<DecryptedKDM> decrypt_kdms (std::vector<EncryptedKDM> const & kdms, PrivateKey const & private_key, int threads);
+
 }
 
 #endif
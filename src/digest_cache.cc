@@ -0,0 +1,303 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/digest_cache.cc
+ *  @brief DigestCache class.
+ */
+
+#include "digest_cache.h"
+#include "exceptions.h"
+#include "compose.hpp"
+#include "util.h"
+#include "raw_convert.h"
+#include <boost/algorithm/string.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <limits>
+#ifndef LIBDCP_WINDOWS
+#include <sys/stat.h>
+#endif
+
+using std::map;
+using std::string;
+using boost::optional;
+using boost::shared_ptr;
+using namespace dcp;
+
+/** The cache that make_digest uses, if any */
+static shared_ptr<DigestCache> global_cache;
+static boost::mutex global_cache_mutex;
+
+bool
+DigestCache::Key::operator< (Key const & other) const
+{
+	if (id != other.id) {
+		return id < other.id;
+	}
+
+	if (size != other.size) {
+		return size < other.size;
+	}
+
+	return mtime < other.mtime;
+}
+
+bool
+DigestCache::Key::operator== (Key const & other) const
+{
+	return id == other.id && size == other.size && mtime == other.mtime;
+}
+
+DigestCache::DigestCache (boost::filesystem::path file)
+	: _file (file)
+	, _dirty (false)
+{
+	FILE* f = fopen_boost (file, "r");
+	if (!f) {
+		/* There is no cache yet */
+		return;
+	}
+
+	/* Each line is <digest> <size> <mtime> <biggest-picture-frame> <id>, with - for an unknown
+	   frame size.  The id comes last as it may contain spaces.
+	*/
+	char buffer[4096];
+	while (fgets (buffer, sizeof (buffer), f)) {
+		string line (buffer);
+		boost::algorithm::trim_right_if (line, boost::algorithm::is_any_of ("\r\n"));
+
+		size_t const a = line.find (' ');
+		size_t const b = a == string::npos ? string::npos : line.find (' ', a + 1);
+		size_t const c = b == string::npos ? string::npos : line.find (' ', b + 1);
+		size_t const d = c == string::npos ? string::npos : line.find (' ', c + 1);
+		if (d == string::npos || d + 1 == line.length ()) {
+			continue;
+		}
+
+		Key k;
+		k.size = strtoull (line.substr (a + 1, b - a - 1).c_str (), 0, 10);
+		k.mtime = strtoll (line.substr (b + 1, c - b - 1).c_str (), 0, 10);
+		k.id = line.substr (d + 1);
+
+		Entry e;
+		e.digest = line.substr (0, a);
+		string const frame = line.substr (c + 1, d - c - 1);
+		if (frame != "-") {
+			e.biggest_picture_frame = strtoll (frame.c_str (), 0, 10);
+		}
+
+		set (k, e);
+	}
+
+	fclose (f);
+}
+
+optional<DigestCache::Key>
+DigestCache::key (boost::filesystem::path file)
+{
+	Key k;
+
+#ifdef LIBDCP_WINDOWS
+	/* There are no useful inode numbers, so identify the file by its path */
+	boost::system::error_code ec;
+	k.size = boost::filesystem::file_size (file, ec);
+	if (ec) {
+		return optional<Key> ();
+	}
+	k.mtime = int64_t (boost::filesystem::last_write_time (file, ec)) * 1000000000;
+	if (ec) {
+		return optional<Key> ();
+	}
+	k.id = boost::filesystem::absolute (file).string ();
+#else
+	struct stat st;
+	if (stat (file.string().c_str(), &st) != 0 || !S_ISREG (st.st_mode)) {
+		return optional<Key> ();
+	}
+	k.id = String::compose ("%1:%2", static_cast<uint64_t> (st.st_dev), static_cast<uint64_t> (st.st_ino));
+	k.size = st.st_size;
+	/* Use the full resolution of the modification time, so that a file which is changed
+	   within a second of its digest being taken is not mistaken for the old one.
+	*/
+#ifdef __APPLE__
+	k.mtime = int64_t (st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	k.mtime = int64_t (st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+
+	return k;
+}
+
+/** @return Digest of file from the cache, if there is one for the file as it is now */
+optional<string>
+DigestCache::get (boost::filesystem::path file) const
+{
+	optional<Key> k = key (file);
+	if (!k) {
+		return optional<string> ();
+	}
+
+	optional<Entry> e = get (*k);
+	if (!e) {
+		return optional<string> ();
+	}
+
+	return e->digest;
+}
+
+/** @return What is known about the file with the given key, if anything */
+optional<DigestCache::Entry>
+DigestCache::get (Key const & key) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	map<Key, Entry>::const_iterator i = _entries.find (key);
+	if (i == _entries.end ()) {
+		return optional<Entry> ();
+	}
+
+	return i->second;
+}
+
+/** Add or replace the digest of a file, as it is now */
+void
+DigestCache::add (boost::filesystem::path file, string digest)
+{
+	optional<Key> k = key (file);
+	if (k) {
+		add (*k, digest);
+	}
+}
+
+/** Add or replace the digest of a file.  To avoid caching a digest of data that changed
+ *  while it was being read, callers should take the key before reading the file, and
+ *  only call this if the key is the same afterwards.
+ *  @param key Key of the file when its digest was taken.
+ *  @param biggest_picture_frame Size of the biggest picture frame in the file, or none to
+ *  keep any size that is already known for this key.
+ */
+void
+DigestCache::add (Key const & key, string digest, optional<int64_t> biggest_picture_frame)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	map<Key, Entry>::const_iterator i = _entries.find (key);
+	if (!biggest_picture_frame && i != _entries.end() && i->second.digest == digest) {
+		biggest_picture_frame = i->second.biggest_picture_frame;
+	}
+
+	set (key, Entry (digest, biggest_picture_frame));
+	_dirty = true;
+}
+
+/** Set the entry for a key, removing any entries for other versions of the same file.
+ *  Must be called with _mutex held, or from the constructor.
+ */
+void
+DigestCache::set (Key const & key, Entry const & entry)
+{
+	/* Entries are sorted by id first, so all those for this file are together */
+	Key first;
+	first.id = key.id;
+	first.size = 0;
+	first.mtime = std::numeric_limits<int64_t>::min ();
+
+	map<Key, Entry>::iterator i = _entries.lower_bound (first);
+	while (i != _entries.end() && i->first.id == key.id) {
+		if (i->first == key) {
+			++i;
+		} else {
+			_entries.erase (i++);
+		}
+	}
+
+	_entries[key] = entry;
+}
+
+/** Write the cache to its file, if anything has been added since it was last written */
+void
+DigestCache::write () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (!_dirty) {
+		return;
+	}
+
+	/* Write to a temporary file and rename it so that a cache is never left half-written */
+	boost::filesystem::path tmp = _file;
+	tmp += ".tmp";
+
+	FILE* f = fopen_boost (tmp, "w");
+	if (!f) {
+		boost::throw_exception (FileError ("could not open digest cache for writing", tmp, errno));
+	}
+
+	for (map<Key, Entry>::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+		string const frame = i->second.biggest_picture_frame ? raw_convert<string> (*i->second.biggest_picture_frame) : "-";
+		string const line = String::compose (
+			"%1 %2 %3 %4 %5\n", i->second.digest, static_cast<uint64_t> (i->first.size), i->first.mtime, frame, i->first.id
+			);
+		if (fwrite (line.c_str(), line.length(), 1, f) != 1) {
+			fclose (f);
+			boost::throw_exception (FileError ("could not write digest cache", tmp, errno));
+		}
+	}
+
+	if (fclose (f) != 0) {
+		boost::throw_exception (FileError ("could not write digest cache", tmp, errno));
+	}
+
+	boost::filesystem::rename (tmp, _file);
+	_dirty = false;
+}
+
+/** Set a cache for make_digest to look in before reading a file, and to add the digests
+ *  that it calculates to.
+ *  @param cache Cache to use, or 0 to use none.
+ */
+void
+dcp::set_digest_cache (shared_ptr<DigestCache> cache)
+{
+	boost::mutex::scoped_lock lm (global_cache_mutex);
+	global_cache = cache;
+}
+
+/** @return The cache that was given to set_digest_cache, or 0 */
+shared_ptr<DigestCache>
+dcp::digest_cache ()
+{
+	boost::mutex::scoped_lock lm (global_cache_mutex);
+	return global_cache;
+}
@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/digest_cache.h
+ *  @brief DigestCache class.
+ */
+
+#ifndef LIBDCP_DIGEST_CACHE_H
+#define LIBDCP_DIGEST_CACHE_H
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace dcp {
+
+/** @class DigestCache
+ *  @brief A store of file digests which can be kept on disk between runs.
+ *
+ *  Digests are keyed on the identity of a file (its device and inode), its size and its
+ *  modification time, so a file which has been renamed will still be found and one which
+ *  has been changed will not.  Only the latest digest for each file is kept.  The size of
+ *  the biggest picture frame in an MXF can be stored alongside its digest, so that verify
+ *  need not read the file again to check it.  A DigestCache may be used by several threads
+ *  at once.
+ */
+class DigestCache : public boost::noncopyable
+{
+public:
+	/** @param file File to keep the cache in; any digests already in it will be read */
+	explicit DigestCache (boost::filesystem::path file);
+
+	/** The state of a file when its digest was taken */
+	struct Key
+	{
+		/** device and inode, or the absolute path on systems which have no inodes */
+		std::string id;
+		uintmax_t size;
+		/** modification time in nanoseconds */
+		int64_t mtime;
+
+		bool operator< (Key const & other) const;
+		bool operator== (Key const & other) const;
+	};
+
+	/** Things that are known about a file with a given Key */
+	struct Entry
+	{
+		Entry () {}
+
+		Entry (std::string digest_, boost::optional<int64_t> biggest_picture_frame_)
+			: digest (digest_)
+			, biggest_picture_frame (biggest_picture_frame_)
+		{}
+
+		std::string digest;
+		/** size of the biggest picture essence element in the file, if it is known */
+		boost::optional<int64_t> biggest_picture_frame;
+	};
+
+	static boost::optional<Key> key (boost::filesystem::path file);
+
+	boost::optional<std::string> get (boost::filesystem::path file) const;
+	boost::optional<Entry> get (Key const & key) const;
+	void add (boost::filesystem::path file, std::string digest);
+	void add (Key const & key, std::string digest, boost::optional<int64_t> biggest_picture_frame = boost::optional<int64_t> ());
+	void write () const;
+
+private:
+	void set (Key const & key, Entry const & entry);
+
+	boost::filesystem::path _file;
+	/** mutex to protect _entries and _dirty */
+	mutable boost::mutex _mutex;
+	std::map<Key, Entry> _entries;
+	mutable bool _dirty;
+};
+
+void set_digest_cache (boost::shared_ptr<DigestCache> cache);
+boost::shared_ptr<DigestCache> digest_cache ();
+
+}
+
+#endif
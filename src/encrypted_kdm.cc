@@ -577,9 +577,12 @@ EncryptedKDM::EncryptedKDM (string s)
 	}
 }
 
-/** @param trusted_devices Trusted device thumbprints */
+/** @param signing_key Key from signer->signing_key() to sign with.
+ *  @param trusted_devices Trusted device thumbprints.
+ */
 EncryptedKDM::EncryptedKDM (
 	shared_ptr<const CertificateChain> signer,
+	shared_ptr<SigningKey> signing_key,
 	Certificate recipient,
 	vector<string> trusted_devices,
 	string cpl_id,
@@ -606,9 +609,11 @@ EncryptedKDM::EncryptedKDM (
 	 * DCI_SPECIFIC                       as specified          Yes
 	 */
 
+	Certificate const leaf = signer->leaf ();
+
 	data::AuthenticatedPublic& aup = _data->authenticated_public;
-	aup.signer.x509_issuer_name = signer->leaf().issuer ();
-	aup.signer.x509_serial_number = signer->leaf().serial ();
+	aup.signer.x509_issuer_name = leaf.issuer ();
+	aup.signer.x509_serial_number = leaf.serial ();
 	aup.annotation_text = annotation_text;
 
 	data::KDMRequiredExtensions& kre = _data->authenticated_public.required_extensions.kdm_required_extensions;
@@ -617,7 +622,7 @@ EncryptedKDM::EncryptedKDM (
 	kre.recipient.x509_subject_name = recipient.subject ();
 	kre.composition_playlist_id = cpl_id;
 	if (formulation == DCI_ANY || formulation == DCI_SPECIFIC) {
-		kre.content_authenticator = signer->leaf().thumbprint ();
+		kre.content_authenticator = leaf.thumbprint ();
 	}
 	kre.content_title_text = content_title_text;
 	kre.not_valid_before = not_valid_before;
@@ -671,7 +676,7 @@ EncryptedKDM::EncryptedKDM (
 	xmlpp::Node::NodeList children = doc->get_root_node()->get_children ();
 	for (xmlpp::Node::NodeList::const_iterator i = children.begin(); i != children.end(); ++i) {
 		if ((*i)->get_name() == "Signature") {
-			signer->add_signature_value (dynamic_cast<xmlpp::Element*>(*i), "ds", false);
+			signer->add_signature_value (dynamic_cast<xmlpp::Element*>(*i), "ds", false, signing_key);
 		}
 	}
 
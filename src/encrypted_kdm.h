@@ -55,6 +55,7 @@ namespace data {
 }
 
 class CertificateChain;
+class SigningKey;
 class Certificate;
 
 /** @class EncryptedKDM
@@ -103,6 +104,7 @@ private:
 	/** Construct an EncryptedKDM from a set of details */
 	EncryptedKDM (
 		boost::shared_ptr<const CertificateChain> signer,
+		boost::shared_ptr<SigningKey> signing_key,
 		Certificate recipient,
 		std::vector<std::string> trusted_devices,
 		std::string cpl_id,
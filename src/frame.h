@@ -39,6 +39,7 @@
 #include <asdcp/KM_fileio.h>
 #include <asdcp/AS_DCP.h>
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace dcp {
 
@@ -46,19 +47,22 @@ template <class R, class B>
 class Frame : public boost::noncopyable
 {
 public:
-	Frame (R* reader, int n, boost::shared_ptr<const DecryptionContext> c)
-	{
-		/* XXX: unfortunate guesswork on this buffer size */
-		_buffer = new B (Kumu::Megabyte);
+	typedef B Buffer;
 
+	/** Read a frame into a buffer, which will usually have come from the reader's FrameBufferPool */
+	Frame (R* reader, int n, boost::shared_ptr<const DecryptionContext> c, boost::shared_ptr<B> buffer)
+		: _buffer (buffer)
+	{
 		if (ASDCP_FAILURE (reader->ReadFrame (n, *_buffer, c->context(), c->hmac()))) {
 			boost::throw_exception (ReadError ("could not read frame"));
 		}
 	}
 
-	~Frame ()
+	/** @return Capacity that buffers for frames from this reader should have */
+	static int buffer_size (R *)
 	{
-		delete _buffer;
+		/* XXX: unfortunate guesswork on this buffer size */
+		return Kumu::Megabyte;
 	}
 
 	uint8_t const * data () const
@@ -72,7 +76,7 @@ public:
 	}
 
 private:
-	B* _buffer;
+	boost::shared_ptr<B> _buffer;
 };
 
 }
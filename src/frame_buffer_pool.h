@@ -0,0 +1,139 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/frame_buffer_pool.h
+ *  @brief FrameBufferPool class.
+ */
+
+#ifndef LIBDCP_FRAME_BUFFER_POOL_H
+#define LIBDCP_FRAME_BUFFER_POOL_H
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+
+namespace dcp {
+
+/** @class FrameBufferPool
+ *  @brief A set of ASDCP frame buffers which can be re-used for successive frames.
+ *
+ *  Buffers handed out by get() are returned to the pool when the last shared_ptr
+ *  to them goes away, so a reader which is asked for one frame after another
+ *  does not have to allocate (and page in) a new multi-megabyte buffer each time.
+ *  get() may be called from any thread.
+ */
+template <class B>
+class FrameBufferPool : public boost::enable_shared_from_this<FrameBufferPool<B> >, public boost::noncopyable
+{
+public:
+	/** @param capacity Capacity in bytes of each buffer that the pool allocates */
+	explicit FrameBufferPool (int capacity)
+		: _capacity (capacity)
+	{}
+
+	~FrameBufferPool ()
+	{
+		BOOST_FOREACH (B* i, _free) {
+			delete i;
+		}
+	}
+
+	/** @return A buffer, either recycled or newly allocated */
+	boost::shared_ptr<B> get ()
+	{
+		B* buffer = 0;
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			if (!_free.empty ()) {
+				buffer = _free.back ();
+				_free.pop_back ();
+			}
+		}
+
+		if (!buffer) {
+			buffer = new B (_capacity);
+		}
+
+		return boost::shared_ptr<B> (buffer, Returner (this->shared_from_this ()));
+	}
+
+	int capacity () const {
+		return _capacity;
+	}
+
+private:
+	/** shared_ptr deleter which puts a buffer back into its pool; it holds
+	 *  a reference to the pool so that frames may outlive their reader.
+	 */
+	class Returner
+	{
+	public:
+		explicit Returner (boost::shared_ptr<FrameBufferPool> pool)
+			: _pool (pool)
+		{}
+
+		void operator() (B* buffer)
+		{
+			_pool->put (buffer);
+		}
+
+	private:
+		boost::shared_ptr<FrameBufferPool> _pool;
+	};
+
+	void put (B* buffer)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (static_cast<int> (_free.size ()) < max_free) {
+			_free.push_back (buffer);
+		} else {
+			lm.unlock ();
+			delete buffer;
+		}
+	}
+
+	/** Maximum number of unused buffers to keep */
+	enum { max_free = 16 };
+
+	int const _capacity;
+	boost::mutex _mutex;
+	std::list<B*> _free;
+};
+
+}
+
+#endif
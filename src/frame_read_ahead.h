@@ -0,0 +1,221 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/frame_read_ahead.h
+ *  @brief FrameReadAhead class.
+ */
+
+#ifndef LIBDCP_FRAME_READ_AHEAD_H
+#define LIBDCP_FRAME_READ_AHEAD_H
+
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <vector>
+
+namespace dcp {
+
+/** @class FrameReadAhead
+ *  @brief Sequential access to a range of frames which are read (and decrypted, if required)
+ *  by one or more background threads, so that reading overlaps with whatever the caller
+ *  does with each frame.
+ *
+ *  Get one of these from AssetReader::read_ahead ().
+ */
+template <class F>
+class FrameReadAhead : public boost::noncopyable
+{
+public:
+	typedef boost::function<boost::shared_ptr<const F> (int)> ReadFunction;
+
+	/** @param read Function to read a frame given its index.
+	 *  @param first First frame index to read.
+	 *  @param end One past the last frame index to read.
+	 *  @param depth Maximum number of frames to read before they are asked for.
+	 */
+	FrameReadAhead (ReadFunction read, int first, int end, int depth)
+		: _next_read (first)
+		, _next_get (first)
+		, _end (end)
+		, _depth (depth > 0 ? depth : 1)
+		, _stop (false)
+		, _exception_frame (0)
+	{
+		std::vector<ReadFunction> reads;
+		reads.push_back (read);
+		start (reads);
+	}
+
+	/** @param reads Functions to read a frame given its index; one thread is started for each,
+	 *  so each must be safe to call at the same time as the others.
+	 *  @param first First frame index to read.
+	 *  @param end One past the last frame index to read.
+	 *  @param depth Maximum number of frames to read before they are asked for.
+	 */
+	FrameReadAhead (std::vector<ReadFunction> reads, int first, int end, int depth)
+		: _next_read (first)
+		, _next_get (first)
+		, _end (end)
+		, _depth (depth > 0 ? depth : 1)
+		, _stop (false)
+		, _exception_frame (0)
+	{
+		start (reads);
+	}
+
+	~FrameReadAhead ()
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			_stop = true;
+		}
+		_space.notify_all ();
+		_threads.join_all ();
+	}
+
+	/** @return Next frame, or an empty pointer if all frames have been returned.
+	 *  Any exception thrown when reading the frame will be re-thrown here.
+	 */
+	boost::shared_ptr<const F> next ()
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+
+		if (_next_get >= _end) {
+			return boost::shared_ptr<const F> ();
+		}
+
+		typename std::map<int, boost::shared_ptr<const F> >::iterator i = _frames.find (_next_get);
+		while (i == _frames.end() && !(_exception && _exception_frame == _next_get)) {
+			_ready.wait (lm);
+			i = _frames.find (_next_get);
+		}
+
+		if (i == _frames.end()) {
+			boost::rethrow_exception (_exception);
+		}
+
+		boost::shared_ptr<const F> frame = i->second;
+		_frames.erase (i);
+		++_next_get;
+		lm.unlock ();
+
+		_space.notify_all ();
+		return frame;
+	}
+
+	/** @return Index of the frame that the next call to next () will return */
+	int position () const {
+		boost::mutex::scoped_lock lm (_mutex);
+		return _next_get;
+	}
+
+private:
+	void start (std::vector<ReadFunction> const & reads)
+	{
+		for (typename std::vector<ReadFunction>::const_iterator i = reads.begin(); i != reads.end(); ++i) {
+			_threads.create_thread (boost::bind (&FrameReadAhead::thread, this, *i));
+		}
+	}
+
+	void thread (ReadFunction read)
+	{
+		while (true) {
+			int n;
+
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				while (!_stop && !_exception && _next_read < _end && (_next_read - _next_get) >= _depth) {
+					_space.wait (lm);
+				}
+				/* After an error we don't start any more frames; all the ones before it
+				   have been started already, so they can still be returned.
+				*/
+				if (_stop || _exception || _next_read >= _end) {
+					return;
+				}
+				n = _next_read++;
+			}
+
+			/* Read without holding the lock so that the caller can take frames,
+			   and other threads can read, meanwhile.
+			*/
+			try {
+				boost::shared_ptr<const F> frame = read (n);
+				boost::mutex::scoped_lock lm (_mutex);
+				_frames[n] = frame;
+			} catch (...) {
+				boost::mutex::scoped_lock lm (_mutex);
+				if (!_exception || n < _exception_frame) {
+					_exception = boost::current_exception ();
+					_exception_frame = n;
+				}
+			}
+
+			_ready.notify_all ();
+			/* Another thread may be waiting to start a frame now that there is an error */
+			_space.notify_all ();
+		}
+	}
+
+	/** mutex to protect everything below */
+	mutable boost::mutex _mutex;
+	/** signalled when a frame has been added to _frames, or an error has occurred */
+	boost::condition _ready;
+	/** signalled when a frame has been removed from _frames, or when we should stop */
+	boost::condition _space;
+	/** frames that have been read but not yet taken by the caller, indexed by frame index */
+	std::map<int, boost::shared_ptr<const F> > _frames;
+	/** index of the next frame for a thread to read */
+	int _next_read;
+	/** index of the next frame to return from next () */
+	int _next_get;
+	int _end;
+	int _depth;
+	bool _stop;
+	/** first exception thrown by a thread, if any */
+	boost::exception_ptr _exception;
+	/** index of the frame whose reading threw _exception */
+	int _exception_frame;
+
+	boost::thread_group _threads;
+};
+
+}
+
+#endif
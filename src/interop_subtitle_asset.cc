@@ -41,6 +41,7 @@
 #include "dcp_assert.h"
 #include "compose.hpp"
 #include "subtitle_image.h"
+#include "asset_index.h"
 #include <libxml++/libxml++.h>
 #include <boost/foreach.hpp>
 #include <boost/weak_ptr.hpp>
@@ -219,26 +220,31 @@ InteropSubtitleAsset::write (boost::filesystem::path p) const
  *  a list of font ID, load ID and data.
  */
 void
-InteropSubtitleAsset::resolve_fonts (list<shared_ptr<Asset> > assets)
+InteropSubtitleAsset::resolve_fonts (list<shared_ptr<Asset> > const & assets)
 {
-	BOOST_FOREACH (shared_ptr<Asset> i, assets) {
-		shared_ptr<FontAsset> font = dynamic_pointer_cast<FontAsset> (i);
-		if (!font) {
-			continue;
-		}
+	resolve_fonts (AssetIndex (assets));
+}
 
-		BOOST_FOREACH (shared_ptr<InteropLoadFontNode> j, _load_font_nodes) {
-			bool got = false;
-			BOOST_FOREACH (Font const & k, _fonts) {
-				if (k.load_id == j->id) {
-					got = true;
-					break;
-				}
+/** Find the font file for each of our LoadFont nodes which does not yet have one */
+void
+InteropSubtitleAsset::resolve_fonts (AssetIndex const & assets)
+{
+	BOOST_FOREACH (shared_ptr<InteropLoadFontNode> j, _load_font_nodes) {
+		bool got = false;
+		BOOST_FOREACH (Font const & k, _fonts) {
+			if (k.load_id == j->id) {
+				got = true;
+				break;
 			}
+		}
 
-			if (!got && font->file() && j->uri == font->file()->leaf().string()) {
-				_fonts.push_back (Font (j->id, i->id(), font->file().get()));
-			}
+		if (got) {
+			continue;
+		}
+
+		shared_ptr<FontAsset> font = assets.find_font (j->uri);
+		if (font) {
+			_fonts.push_back (Font (j->id, font->id(), font->file().get()));
 		}
 	}
 }
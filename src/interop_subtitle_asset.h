@@ -41,6 +41,7 @@
 namespace dcp {
 
 class InteropLoadFontNode;
+class AssetIndex;
 
 /** @class InteropSubtitleAsset
  *  @brief A set of subtitles to be read and/or written in the Inter-Op format.
@@ -68,7 +69,8 @@ public:
 
 	std::string xml_as_string () const;
 	void write (boost::filesystem::path path) const;
-	void resolve_fonts (std::list<boost::shared_ptr<Asset> > assets);
+	void resolve_fonts (std::list<boost::shared_ptr<Asset> > const & assets);
+	void resolve_fonts (AssetIndex const & assets);
 	void add_font_assets (std::list<boost::shared_ptr<Asset> >& assets);
 
 	/** Set the reel number or sub-element identifier
@@ -38,12 +38,23 @@
 #include "dcp_assert.h"
 #include "compose.hpp"
 #include <openjpeg.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
 #include <cmath>
 #include <iostream>
 
+#if defined(LIBDCP_OPENJPEG2) && (OPJ_VERSION_MAJOR > 2 || (OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 3))
+/* opj_codec_set_threads is available */
+#define LIBDCP_OPENJPEG_THREADS
+#endif
+
 using std::min;
+using std::max;
 using std::pow;
 using std::string;
+using std::list;
+using std::pair;
+using std::make_pair;
 using boost::shared_ptr;
 using boost::shared_array;
 using namespace dcp;
@@ -54,43 +65,159 @@ dcp::decompress_j2k (Data data, int reduce)
 	return dcp::decompress_j2k (data.data().get(), data.size(), reduce);
 }
 
+shared_ptr<dcp::OpenJPEGImage>
+dcp::decompress_j2k (Data data, J2KOptions const & options)
+{
+	return dcp::decompress_j2k (data.data().get(), data.size(), options);
+}
+
+/** Decompress a JPEG2000 image to a bitmap.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data in bytes.
+ *  @param reduce A power of 2 by which to reduce the size of the decoded image;
+ *  e.g. 0 reduces by (2^0 == 1), ie keeping the same size.
+ *       1 reduces by (2^1 == 2), ie halving the size of the image.
+ *  This is useful for scaling 4K DCP images down to 2K.
+ *  @return OpenJPEGImage.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
+{
+	J2KOptions options;
+	options.reduce = reduce;
+	return decompress_j2k (data, size, options);
+}
+
+/** Decompress a JPEG2000 image to a bitmap.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data in bytes.
+ *  @param options Options for the decoder.
+ *  @return OpenJPEGImage.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+dcp::decompress_j2k (uint8_t* data, int64_t size, J2KOptions const & options)
+{
+	J2KDecoder decoder;
+	return decoder.decompress (data, size, options);
+}
+
+/** Decompress a JPEG2000 image to a bitmap.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data in bytes.
+ *  @param reduce A power of 2 by which to reduce the size of the decoded image (see decompress_j2k).
+ *  @return OpenJPEGImage.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+J2KDecoder::decompress (uint8_t const * data, int64_t size, int reduce)
+{
+	J2KOptions options;
+	options.reduce = reduce;
+	return decompress (data, size, options);
+}
+
+/** Decompress a JPEG2000 image to a bitmap.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data in bytes.
+ *  @param options Options for the decoder.
+ *  @return OpenJPEGImage.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+J2KDecoder::decompress (uint8_t const * data, int64_t size, J2KOptions const & options)
+{
+	return shared_ptr<OpenJPEGImage> (new OpenJPEGImage (decompress_to_opj_image (data, size, options)));
+}
+
+/** Decompress a JPEG2000 image to a bitmap, replacing the contents of an existing OpenJPEGImage.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data in bytes.
+ *  @param reduce A power of 2 by which to reduce the size of the decoded image (see decompress_j2k).
+ *  @param image Image to put the result in.
+ */
+void
+J2KDecoder::decompress (uint8_t const * data, int64_t size, int reduce, OpenJPEGImage& image)
+{
+	J2KOptions options;
+	options.reduce = reduce;
+	decompress (data, size, options, image);
+}
+
+/** Decompress a JPEG2000 image to a bitmap, replacing the contents of an existing OpenJPEGImage.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data in bytes.
+ *  @param options Options for the decoder.
+ *  @param image Image to put the result in.
+ */
+void
+J2KDecoder::decompress (uint8_t const * data, int64_t size, J2KOptions const & options, OpenJPEGImage& image)
+{
+	image.reset (decompress_to_opj_image (data, size, options));
+}
+
 #ifdef LIBDCP_OPENJPEG2
 
-class ReadBuffer
+/** Size of the buffer that OpenJPEG uses for reads from our data.  OpenJPEG
+ *  reads anything at least this big (which includes the bulk of the tile data)
+ *  straight into its own buffers, so keeping this small avoids copying most
+ *  of each frame twice.
+ */
+static OPJ_SIZE_T const decoder_stream_buffer_size = 16384;
+
+namespace {
+
+/** The JPEG2000 data that OpenJPEG is reading from, and how far it has got */
+struct DecoderStream
 {
-public:
-	ReadBuffer (uint8_t* data, int64_t size)
-		: _data (data)
-		, _size (size)
-		, _offset (0)
+	DecoderStream (uint8_t const * data_, int64_t size_)
+		: data (data_)
+		, size (size_)
+		, offset (0)
 	{}
 
-	OPJ_SIZE_T read (void* buffer, OPJ_SIZE_T nb_bytes)
-	{
-		int64_t N = min (nb_bytes, _size - _offset);
-		memcpy (buffer, _data + _offset, N);
-		_offset += N;
-		return N;
-	}
-
-private:
-	uint8_t* _data;
-	OPJ_SIZE_T _size;
-	OPJ_SIZE_T _offset;
+	uint8_t const * data;
+	int64_t size;
+	/** offset within data of the next byte that OpenJPEG will read */
+	int64_t offset;
 };
 
+}
+
+/* These are called by OpenJPEG when it wants more data */
+
 static OPJ_SIZE_T
 read_function (void* buffer, OPJ_SIZE_T nb_bytes, void* data)
 {
-	return reinterpret_cast<ReadBuffer*>(data)->read (buffer, nb_bytes);
+	DecoderStream* stream = reinterpret_cast<DecoderStream*> (data);
+	if (stream->offset >= stream->size) {
+		/* This is how OpenJPEG expects to be told that we have run out of data */
+		return static_cast<OPJ_SIZE_T> (-1);
+	}
+
+	int64_t const N = min (static_cast<int64_t> (nb_bytes), stream->size - stream->offset);
+	memcpy (buffer, stream->data + stream->offset, N);
+	stream->offset += N;
+	return N;
 }
 
-static void
-read_free_function (void* data)
+static OPJ_OFF_T
+skip_function (OPJ_OFF_T nb_bytes, void* data)
 {
-	delete reinterpret_cast<ReadBuffer*>(data);
+	DecoderStream* stream = reinterpret_cast<DecoderStream*> (data);
+	int64_t const N = max (-stream->offset, min (static_cast<int64_t> (nb_bytes), stream->size - stream->offset));
+	stream->offset += N;
+	return N;
 }
 
+static OPJ_BOOL
+decoder_seek_function (OPJ_OFF_T nb_bytes, void* data)
+{
+	DecoderStream* stream = reinterpret_cast<DecoderStream*> (data);
+	if (nb_bytes < 0 || nb_bytes > stream->size) {
+		return OPJ_FALSE;
+	}
+
+	stream->offset = nb_bytes;
+	return OPJ_TRUE;
+}
 
 static void
 decompress_error_callback (char const * msg, void *)
@@ -105,19 +232,12 @@ compress_error_callback (char const * msg, void *)
 	throw MiscError (msg);
 }
 
-/** Decompress a JPEG2000 image to a bitmap.
- *  @param data JPEG2000 data.
- *  @param size Size of data in bytes.
- *  @param reduce A power of 2 by which to reduce the size of the decoded image;
- *  e.g. 0 reduces by (2^0 == 1), ie keeping the same size.
- *       1 reduces by (2^1 == 2), ie halving the size of the image.
- *  This is useful for scaling 4K DCP images down to 2K.
- *  @return OpenJPEGImage.
- */
-shared_ptr<dcp::OpenJPEGImage>
-dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
+/** @return A new opj_image_t which the caller must destroy */
+opj_image_t*
+J2KDecoder::decompress_to_opj_image (uint8_t const * data, int64_t size, J2KOptions const & options)
 {
-	DCP_ASSERT (reduce >= 0);
+	DCP_ASSERT (options.reduce >= 0);
+	DCP_ASSERT (options.layers >= 0);
 
 	uint8_t const jp2_magic[] = {
 		0x00,
@@ -135,25 +255,37 @@ dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
 		format = OPJ_CODEC_JP2;
 	}
 
+	/* OpenJPEG cannot reset a codec to decode another codestream, so we need a new one each time */
 	opj_codec_t* decoder = opj_create_decompress (format);
 	if (!decoder) {
 		boost::throw_exception (ReadError ("could not create JPEG2000 decompresser"));
 	}
 	opj_dparameters_t parameters;
 	opj_set_default_decoder_parameters (&parameters);
-	parameters.cp_reduce = reduce;
+	parameters.cp_reduce = options.reduce;
+	parameters.cp_layer = options.layers;
 	opj_setup_decoder (decoder, &parameters);
 
-	opj_stream_t* stream = opj_stream_default_create (OPJ_TRUE);
+#ifdef LIBDCP_OPENJPEG_THREADS
+	if (options.threads > 1) {
+		opj_codec_set_threads (decoder, options.threads);
+	}
+#endif
+
+	opj_stream_t* stream = opj_stream_create (decoder_stream_buffer_size, OPJ_TRUE);
 	if (!stream) {
+		opj_destroy_codec (decoder);
 		throw MiscError ("could not create JPEG2000 stream");
 	}
 
 	opj_set_error_handler(decoder, decompress_error_callback, 00);
 
+	DecoderStream source (data, size);
+
 	opj_stream_set_read_function (stream, read_function);
-	ReadBuffer* buffer = new ReadBuffer (data, size);
-	opj_stream_set_user_data (stream, buffer, read_free_function);
+	opj_stream_set_skip_function (stream, skip_function);
+	opj_stream_set_seek_function (stream, decoder_seek_function);
+	opj_stream_set_user_data (stream, &source, 0);
 	opj_stream_set_user_data_length (stream, size);
 
 	opj_image_t* image = 0;
@@ -161,6 +293,7 @@ dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
 	if (opj_decode (decoder, stream, image) == OPJ_FALSE) {
 		opj_destroy_codec (decoder);
 		opj_stream_destroy (stream);
+		opj_image_destroy (image);
 		if (format == OPJ_CODEC_J2K) {
 			boost::throw_exception (ReadError (String::compose ("could not decode JPEG2000 codestream of %1 bytes.", size)));
 		} else {
@@ -171,31 +304,24 @@ dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
 	opj_destroy_codec (decoder);
 	opj_stream_destroy (stream);
 
-	image->x1 = rint (float(image->x1) / pow (2.0f, reduce));
-	image->y1 = rint (float(image->y1) / pow (2.0f, reduce));
-	return shared_ptr<OpenJPEGImage> (new OpenJPEGImage (image));
+	image->x1 = rint (float(image->x1) / pow (2.0f, options.reduce));
+	image->y1 = rint (float(image->y1) / pow (2.0f, options.reduce));
+	return image;
 }
 #endif
 
 #ifdef LIBDCP_OPENJPEG1
-/** Decompress a JPEG2000 image to a bitmap.
- *  @param data JPEG2000 data.
- *  @param size Size of data in bytes.
- *  @param reduce A power of 2 by which to reduce the size of the decoded image;
- *  e.g. 0 reduces by (2^0 == 1), ie keeping the same size.
- *       1 reduces by (2^1 == 2), ie halving the size of the image.
- *  This is useful for scaling 4K DCP images down to 2K.
- *  @return XYZ image.
- */
-shared_ptr<dcp::OpenJPEGImage>
-dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
+/** @return A new opj_image_t which the caller must destroy */
+opj_image_t*
+J2KDecoder::decompress_to_opj_image (uint8_t const * data, int64_t size, J2KOptions const & options)
 {
 	opj_dinfo_t* decoder = opj_create_decompress (CODEC_J2K);
 	opj_dparameters_t parameters;
 	opj_set_default_decoder_parameters (&parameters);
-	parameters.cp_reduce = reduce;
+	parameters.cp_reduce = options.reduce;
+	parameters.cp_layer = options.layers;
 	opj_setup_decoder (decoder, &parameters);
-	opj_cio_t* cio = opj_cio_open ((opj_common_ptr) decoder, data, size);
+	opj_cio_t* cio = opj_cio_open ((opj_common_ptr) decoder, const_cast<uint8_t*> (data), size);
 	opj_image_t* image = opj_decode (decoder, cio);
 	if (!image) {
 		opj_destroy_decompress (decoder);
@@ -206,33 +332,121 @@ dcp::decompress_j2k (uint8_t* data, int64_t size, int reduce)
 	opj_destroy_decompress (decoder);
 	opj_cio_close (cio);
 
-	image->x1 = rint (float(image->x1) / pow (2, reduce));
-	image->y1 = rint (float(image->y1) / pow (2, reduce));
-	return shared_ptr<OpenJPEGImage> (new OpenJPEGImage (image));
+	image->x1 = rint (float(image->x1) / pow (2, options.reduce));
+	image->y1 = rint (float(image->y1) / pow (2, options.reduce));
+	return image;
 }
 #endif
 
 #ifdef LIBDCP_OPENJPEG2
+
+namespace {
+
+/** @class WriteBufferPool
+ *  @brief A pool of buffers for compressed JPEG2000 data.
+ *
+ *  The Data returned by compress_j2k hands its buffer back here when the last copy
+ *  of it is destroyed, so that a long encode re-uses a few buffers rather than
+ *  allocating (and faulting in) a new one for every frame.
+ */
+class WriteBufferPool : public boost::noncopyable
+{
+public:
+	~WriteBufferPool ()
+	{
+		for (list<pair<uint8_t*, OPJ_SIZE_T> >::iterator i = _free.begin(); i != _free.end(); ++i) {
+			delete[] i->first;
+		}
+	}
+
+	/** @param min_capacity Minimum size of buffer that is required.
+	 *  @param capacity Filled in with the actual size of the buffer.
+	 *  @return Buffer, which should be passed back to put() when it is no longer required.
+	 */
+	uint8_t* get (OPJ_SIZE_T min_capacity, OPJ_SIZE_T& capacity)
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			for (list<pair<uint8_t*, OPJ_SIZE_T> >::iterator i = _free.begin(); i != _free.end(); ++i) {
+				if (i->second >= min_capacity) {
+					uint8_t* buffer = i->first;
+					capacity = i->second;
+					_free.erase (i);
+					return buffer;
+				}
+			}
+		}
+
+		capacity = min_capacity;
+		return new uint8_t[capacity];
+	}
+
+	void put (uint8_t* buffer, OPJ_SIZE_T capacity)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_free.push_front (make_pair (buffer, capacity));
+		if (_free.size() > max_free) {
+			/* The least recently used buffer is at the back */
+			delete[] _free.back().first;
+			_free.pop_back ();
+		}
+	}
+
+private:
+	/** Maximum number of unused buffers to keep */
+	static size_t const max_free = 32;
+
+	boost::mutex _mutex;
+	list<pair<uint8_t*, OPJ_SIZE_T> > _free;
+};
+
+/** Deleter for shared_arrays of pooled buffers which gives them back to their pool */
+class WriteBufferReturner
+{
+public:
+	WriteBufferReturner (shared_ptr<WriteBufferPool> pool, OPJ_SIZE_T capacity)
+		: _pool (pool)
+		, _capacity (capacity)
+	{}
+
+	void operator() (uint8_t* buffer)
+	{
+		_pool->put (buffer, _capacity);
+	}
+
+private:
+	/** The pool, held here so that it outlives every buffer taken from it */
+	shared_ptr<WriteBufferPool> _pool;
+	OPJ_SIZE_T _capacity;
+};
+
+}
+
+static shared_ptr<WriteBufferPool> write_buffer_pool (new WriteBufferPool ());
+
+/** @class WriteBuffer
+ *  @brief Buffer that OpenJPEG writes a compressed codestream into; it grows if
+ *  the codestream turns out to be bigger than expected.
+ */
 class WriteBuffer
 {
 public:
-/* XXX: is there a better strategy for this? */
-#define MAX_J2K_SIZE (1024 * 1024 * 2)
-	WriteBuffer ()
-		: _data (shared_array<uint8_t> (new uint8_t[MAX_J2K_SIZE]), MAX_J2K_SIZE)
+	/** @param expected_size Expected size of the codestream in bytes */
+	explicit WriteBuffer (OPJ_SIZE_T expected_size)
+		: _size (0)
 		, _offset (0)
 	{
-		_data.set_size (0);
+		allocate (expected_size);
 	}
 
 	OPJ_SIZE_T write (void* buffer, OPJ_SIZE_T nb_bytes)
 	{
-		DCP_ASSERT ((_offset + nb_bytes) < MAX_J2K_SIZE);
-		memcpy (_data.data().get() + _offset, buffer, nb_bytes);
-		_offset += nb_bytes;
-		if (_offset > OPJ_SIZE_T (_data.size())) {
-			_data.set_size (_offset);
+		if ((_offset + nb_bytes) > _capacity) {
+			grow (max (_offset + nb_bytes, _capacity * 2));
 		}
+		memcpy (_data.get() + _offset, buffer, nb_bytes);
+		_offset += nb_bytes;
+		_size = max (_size, _offset);
 		return nb_bytes;
 	}
 
@@ -244,12 +458,27 @@ public:
 
 	Data data () const
 	{
-		return _data;
+		return Data (_data, _size);
 	}
 
 private:
-	Data _data;
-	OPJ_SIZE_T _offset;
+	void allocate (OPJ_SIZE_T min_capacity)
+	{
+		uint8_t* buffer = write_buffer_pool->get (min_capacity, _capacity);
+		_data.reset (buffer, WriteBufferReturner (write_buffer_pool, _capacity));
+	}
+
+	void grow (OPJ_SIZE_T min_capacity)
+	{
+		shared_array<uint8_t> old = _data;
+		allocate (min_capacity);
+		memcpy (_data.get(), old.get(), _size);
+	}
+
+	shared_array<uint8_t> _data;
+	OPJ_SIZE_T _capacity; ///< size of _data
+	OPJ_SIZE_T _size;     ///< amount of valid data in _data
+	OPJ_SIZE_T _offset;   ///< offset to write the next data to
 };
 
 static OPJ_SIZE_T
@@ -275,6 +504,18 @@ seek_function (OPJ_OFF_T nb_bytes, void* data)
  */
 Data
 dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frames_per_second, bool threed, bool fourk, string comment)
+{
+	return compress_j2k (xyz, bandwidth, frames_per_second, threed, fourk, J2KOptions(), comment);
+}
+
+/** @xyz Picture to compress.  Parts of xyz's data WILL BE OVERWRITTEN by libopenjpeg so xyz cannot be re-used
+ *  after this call; see opj_j2k_encode where if l_reuse_data is false it will set l_tilec->data = l_img_comp->data.
+ *  @param options Options for the encoder; only threads is used.
+ */
+Data
+dcp::compress_j2k (
+	shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frames_per_second, bool threed, bool fourk, J2KOptions const & options, string comment
+	)
 {
 	/* get a J2K compressor handle */
 	opj_codec_t* encoder = opj_create_compress (OPJ_CODEC_J2K);
@@ -306,6 +547,13 @@ dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frame
 	/* Setup the encoder parameters using the current image and user parameters */
 	opj_setup_encoder (encoder, &parameters, xyz->opj_image());
 
+#ifdef LIBDCP_OPENJPEG_THREADS
+	if (options.threads > 1) {
+		/* This fails harmlessly with OpenJPEG versions that cannot encode using threads */
+		opj_codec_set_threads (encoder, options.threads);
+	}
+#endif
+
 	opj_stream_t* stream = opj_stream_default_create (OPJ_FALSE);
 	if (!stream) {
 		opj_destroy_codec (encoder);
@@ -315,7 +563,8 @@ dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frame
 
 	opj_stream_set_write_function (stream, write_function);
 	opj_stream_set_seek_function (stream, seek_function);
-	WriteBuffer* buffer = new WriteBuffer ();
+	/* The rate control should keep us close to max_cs_size, but leave some room for markers */
+	WriteBuffer* buffer = new WriteBuffer (parameters.max_cs_size + parameters.max_cs_size / 8);
 	opj_stream_set_user_data (stream, buffer, write_free_function);
 
 	if (!opj_start_compress (encoder, xyz->opj_image(), stream)) {
@@ -356,7 +605,7 @@ dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frame
 
 #ifdef LIBDCP_OPENJPEG1
 Data
-dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frames_per_second, bool threed, bool fourk)
+dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frames_per_second, bool threed, bool fourk, string comment)
 {
 	/* Set the max image and component sizes based on frame_rate */
 	int max_cs_len = ((float) bandwidth) / 8 / frames_per_second;
@@ -433,7 +682,7 @@ dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frame
 		parameters.POC[1].prg1 = CPRL;
 	}
 
-	parameters.cp_comment = strdup ("libdcp");
+	parameters.cp_comment = strdup (comment.c_str());
 	parameters.cp_cinema = fourk ? CINEMA4K_24 : CINEMA2K_24;
 
 	/* 3 components, so use MCT */
@@ -471,4 +720,13 @@ dcp::compress_j2k (shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frame
 	return enc;
 }
 
+/** OpenJPEG 1 cannot use threads, so the options are ignored */
+Data
+dcp::compress_j2k (
+	shared_ptr<const OpenJPEGImage> xyz, int bandwidth, int frames_per_second, bool threed, bool fourk, J2KOptions const &, string comment
+	)
+{
+	return compress_j2k (xyz, bandwidth, frames_per_second, threed, fourk, comment);
+}
+
 #endif
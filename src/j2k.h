@@ -33,14 +33,70 @@
 
 #include "data.h"
 #include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 #include <stdint.h>
 
+struct opj_image;
+typedef struct opj_image opj_image_t;
+
 namespace dcp {
 
 class OpenJPEGImage;
 
+/** @struct J2KOptions
+ *  @brief Options to control JPEG2000 encoding and decoding.
+ */
+struct J2KOptions
+{
+	/** Construct a J2KOptions which decodes everything at full resolution using one thread */
+	J2KOptions ()
+		: threads (1)
+		, reduce (0)
+		, layers (0)
+	{}
+
+	/** Number of threads that OpenJPEG should use to encode or decode tiles and code-blocks.
+	 *  This has no effect with OpenJPEG versions before 2.3 (2.5 for encoding).
+	 */
+	int threads;
+	/** When decoding, a power of 2 by which to reduce the size of the decoded image;
+	 *  e.g. 0 reduces by (2^0 == 1), ie keeping the same size.
+	 *       1 reduces by (2^1 == 2), ie halving the size of the image.
+	 */
+	int reduce;
+	/** When decoding, the maximum number of quality layers to decode, or 0 for all of them.
+	 *  Encoding always writes a single layer, as the DCI profiles require.
+	 */
+	int layers;
+};
+
+/** @class J2KDecoder
+ *  @brief A JPEG2000 decoder which reads directly from the caller's buffer, so that the
+ *  JPEG2000 data is never copied into an intermediate buffer.
+ *
+ *  OpenJPEG's codec and the decoded image's buffers are still created for each frame, as
+ *  OpenJPEG cannot reset a codec for a new codestream and replaces any component buffers
+ *  that it is given.
+ */
+class J2KDecoder : public boost::noncopyable
+{
+public:
+	boost::shared_ptr<OpenJPEGImage> decompress (uint8_t const * data, int64_t size, int reduce);
+	boost::shared_ptr<OpenJPEGImage> decompress (uint8_t const * data, int64_t size, J2KOptions const & options);
+	void decompress (uint8_t const * data, int64_t size, int reduce, OpenJPEGImage& image);
+	void decompress (uint8_t const * data, int64_t size, J2KOptions const & options, OpenJPEGImage& image);
+
+private:
+	opj_image_t* decompress_to_opj_image (uint8_t const * data, int64_t size, J2KOptions const & options);
+};
+
 extern boost::shared_ptr<OpenJPEGImage> decompress_j2k (uint8_t* data, int64_t size, int reduce);
 extern boost::shared_ptr<OpenJPEGImage> decompress_j2k (Data data, int reduce);
+extern boost::shared_ptr<OpenJPEGImage> decompress_j2k (uint8_t* data, int64_t size, J2KOptions const & options);
+extern boost::shared_ptr<OpenJPEGImage> decompress_j2k (Data data, J2KOptions const & options);
 extern Data compress_j2k (boost::shared_ptr<const OpenJPEGImage>, int bandwith, int frames_per_second, bool threed, bool fourk, std::string comment = "libdcp");
+extern Data compress_j2k (
+	boost::shared_ptr<const OpenJPEGImage>, int bandwith, int frames_per_second, bool threed, bool fourk, J2KOptions const & options, std::string comment = "libdcp"
+	);
 
 }
@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/lazy_asset.cc
+ *  @brief LazyAsset class.
+ */
+
+#include "lazy_asset.h"
+#include "asset_factory.h"
+#include "dcp_assert.h"
+
+using std::string;
+using boost::shared_ptr;
+using namespace dcp;
+
+/** @param id ID of the asset, from the ASSETMAP.
+ *  @param file MXF file which will be opened when the asset is needed.
+ *  @param ignore_incorrect_picture_mxf_type Passed to asset_factory.
+ */
+LazyAsset::LazyAsset (string id, boost::filesystem::path file, bool ignore_incorrect_picture_mxf_type)
+	: Asset (id, file)
+	, _ignore_incorrect_picture_mxf_type (ignore_incorrect_picture_mxf_type)
+{
+
+}
+
+/** @return The real asset, opening it if this has not already been done.
+ *  Any exception from asset_factory is passed on, and the next call will try again.
+ */
+shared_ptr<Asset>
+LazyAsset::asset () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	if (!_asset) {
+		_asset = asset_factory (_file.get(), _ignore_incorrect_picture_mxf_type);
+	}
+	return _asset;
+}
+
+string
+LazyAsset::pkl_type (Standard) const
+{
+	/* A LazyAsset is never given out by Ref, so nothing should want to write it to a PKL */
+	DCP_ASSERT (false);
+	return "";
+}
@@ -0,0 +1,72 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/lazy_asset.h
+ *  @brief LazyAsset class.
+ */
+
+#ifndef LIBDCP_LAZY_ASSET_H
+#define LIBDCP_LAZY_ASSET_H
+
+#include "asset.h"
+#include <boost/thread/mutex.hpp>
+
+namespace dcp {
+
+/** @class LazyAsset
+ *  @brief A placeholder for an MXF asset in a DCP which has not yet been opened.
+ *
+ *  DCP::read makes these instead of opening every MXF when it is asked to be lazy.
+ *  A Ref which is resolved to a LazyAsset gives out the real asset, which is
+ *  opened (using asset_factory) the first time that any copy of the Ref is asked for it.
+ */
+class LazyAsset : public Asset
+{
+public:
+	LazyAsset (std::string id, boost::filesystem::path file, bool ignore_incorrect_picture_mxf_type);
+
+	boost::shared_ptr<Asset> asset () const;
+
+private:
+	std::string pkl_type (Standard standard) const;
+
+	bool _ignore_incorrect_picture_mxf_type;
+	/** mutex for _asset */
+	mutable boost::mutex _mutex;
+	/** the real asset, once it has been opened */
+	mutable boost::shared_ptr<Asset> _asset;
+};
+
+}
+
+#endif
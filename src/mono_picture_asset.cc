@@ -40,6 +40,7 @@
 #include "compose.hpp"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_fileio.h>
+#include <boost/bind.hpp>
 
 using std::string;
 using std::vector;
@@ -79,12 +80,6 @@ MonoPictureAsset::MonoPictureAsset (Fraction edit_rate, Standard standard)
 
 }
 
-static void
-storing_note_handler (list<pair<NoteType, string> >& notes, NoteType t, string s)
-{
-	notes.push_back (make_pair (t, s));
-}
-
 bool
 MonoPictureAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt, NoteHandler note) const
 {
@@ -122,48 +117,38 @@ MonoPictureAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt, No
 	shared_ptr<const MonoPictureAsset> other_picture = dynamic_pointer_cast<const MonoPictureAsset> (other);
 	DCP_ASSERT (other_picture);
 
-	bool result = true;
-
-	shared_ptr<MonoPictureAssetReader> reader = start_read ();
-	shared_ptr<MonoPictureAssetReader> other_reader = other_picture->start_read ();
-
-#ifdef LIBDCP_OPENMP
-#pragma omp parallel for
-#endif
-
-	for (int i = 0; i < _intrinsic_duration; ++i) {
-		if (i >= other_picture->intrinsic_duration()) {
-			result = false;
-		}
-
-		if (result || opt.keep_going) {
-
-			shared_ptr<const MonoPictureFrame> frame_A = reader->get_frame (i);
-			shared_ptr<const MonoPictureFrame> frame_B = other_reader->get_frame (i);
-
-			list<pair<NoteType, string> > notes;
-
-			if (!frame_buffer_equals (
-				    i, opt, bind (&storing_note_handler, boost::ref(notes), _1, _2),
-				    frame_A->j2k_data(), frame_A->j2k_size(),
-				    frame_B->j2k_data(), frame_B->j2k_size()
-				    )) {
-				result = false;
-			}
-
-#ifdef LIBDCP_OPENMP
-#pragma omp critical
-#endif
-			{
-				note (DCP_PROGRESS, String::compose ("Compared video frame %1 of %2", i, _intrinsic_duration));
-				for (list<pair<NoteType, string> >::const_iterator i = notes.begin(); i != notes.end(); ++i) {
-					note (i->first, i->second);
-				}
-			}
-		}
-	}
+	return frames_equal (
+		other_picture->intrinsic_duration(), opt, note,
+		boost::bind (&MonoPictureAsset::make_comparer, this, other_picture, opt)
+		);
+}
+
+/** @return a FrameComparer with its own readers for this asset and another */
+PictureAsset::FrameComparer
+MonoPictureAsset::make_comparer (shared_ptr<const MonoPictureAsset> other, EqualityOptions opt) const
+{
+	return boost::bind (&MonoPictureAsset::frame_equals, this, start_read(), other->start_read(), _1, opt, _2);
+}
+
+bool
+MonoPictureAsset::frame_equals (
+	shared_ptr<MonoPictureAssetReader> reader,
+	shared_ptr<MonoPictureAssetReader> other_reader,
+	int frame,
+	EqualityOptions opt,
+	NoteHandler note
+	) const
+{
+	shared_ptr<const MonoPictureFrame> frame_A = reader->get_frame (frame);
+	shared_ptr<const MonoPictureFrame> frame_B = other_reader->get_frame (frame);
+
+	note (DCP_PROGRESS, String::compose ("Compared video frame %1 of %2", frame, _intrinsic_duration));
 
-	return result;
+	return frame_buffer_equals (
+		frame, opt, note,
+		frame_A->j2k_data(), frame_A->j2k_size(),
+		frame_B->j2k_data(), frame_B->j2k_size()
+		);
 }
 
 shared_ptr<PictureAssetWriter>
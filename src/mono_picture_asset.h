@@ -70,6 +70,16 @@ public:
 
 private:
 	std::string cpl_node_name () const;
+
+	FrameComparer make_comparer (boost::shared_ptr<const MonoPictureAsset> other, EqualityOptions opt) const;
+
+	bool frame_equals (
+		boost::shared_ptr<MonoPictureAssetReader> reader,
+		boost::shared_ptr<MonoPictureAssetReader> other_reader,
+		int frame,
+		EqualityOptions opt,
+		NoteHandler note
+		) const;
 };
 
 }
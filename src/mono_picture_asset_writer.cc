@@ -64,6 +64,12 @@ MonoPictureAssetWriter::MonoPictureAssetWriter (PictureAsset* asset, boost::file
 
 }
 
+MonoPictureAssetWriter::~MonoPictureAssetWriter ()
+{
+	/* The writer thread uses _state, so it must finish before _state is destroyed */
+	stop_thread ();
+}
+
 void
 MonoPictureAssetWriter::start (uint8_t const * data, int size)
 {
@@ -72,7 +78,7 @@ MonoPictureAssetWriter::start (uint8_t const * data, int size)
 }
 
 FrameInfo
-MonoPictureAssetWriter::write (uint8_t const * data, int size)
+MonoPictureAssetWriter::do_write (uint8_t const * data, int size)
 {
 	DCP_ASSERT (!_finalized);
 
@@ -80,14 +86,12 @@ MonoPictureAssetWriter::write (uint8_t const * data, int size)
 		start (data, size);
 	}
 
- 	if (ASDCP_FAILURE (_state->j2k_parser.OpenReadFrame (data, size, _state->frame_buffer))) {
- 		boost::throw_exception (MiscError ("could not parse J2K frame"));
- 	}
+	ASDCP::JP2K::FrameBuffer const & frame = prepare_frame (_state, data, size, _crypto_context->context());
 
 	uint64_t const before_offset = _state->mxf_writer.Tell ();
 
 	string hash;
-	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (_state->frame_buffer, _crypto_context->context(), _crypto_context->hmac(), &hash);
+	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (frame, _crypto_context->context(), _crypto_context->hmac(), &hash);
 	if (ASDCP_FAILURE (r)) {
 		boost::throw_exception (MXFFileError ("error in writing video MXF", _file.string(), r));
 	}
@@ -97,7 +101,7 @@ MonoPictureAssetWriter::write (uint8_t const * data, int size)
 }
 
 void
-MonoPictureAssetWriter::fake_write (int size)
+MonoPictureAssetWriter::do_fake_write (int size)
 {
 	DCP_ASSERT (_started);
 	DCP_ASSERT (!_finalized);
@@ -113,11 +117,15 @@ MonoPictureAssetWriter::fake_write (int size)
 bool
 MonoPictureAssetWriter::finalize ()
 {
+	flush ();
+	stop_thread ();
+
 	if (_started) {
 		Kumu::Result_t r = _state->mxf_writer.Finalize();
 		if (ASDCP_FAILURE (r)) {
 			boost::throw_exception (MXFFileError ("error in finalizing video MXF", _file.string(), r));
 		}
+		finalize_hash (_picture_asset);
 	}
 
 	_picture_asset->_intrinsic_duration = _frames_written;
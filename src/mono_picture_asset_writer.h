@@ -51,16 +51,16 @@ namespace dcp {
  *
  *  Objects of this class can only be created with MonoPictureAsset::start_write().
  *
- *  Frames can be written to the MonoPictureAsset by calling write() with a JPEG2000 image
- *  (a verbatim .j2c file).  finalize() must be called after the last frame has been written.
+ *  Frames can be written to the MonoPictureAsset by calling write() or write_async() with a
+ *  JPEG2000 image (a verbatim .j2c file).  finalize() must be called after the last frame has been written.
  *  The action of finalize() can't be done in MonoPictureAssetWriter's destructor as it may
  *  throw an exception.
  */
 class MonoPictureAssetWriter : public PictureAssetWriter
 {
 public:
-	FrameInfo write (uint8_t const *, int);
-	void fake_write (int size);
+	~MonoPictureAssetWriter ();
+
 	bool finalize ();
 
 private:
@@ -69,6 +69,9 @@ private:
 	MonoPictureAssetWriter (PictureAsset *, boost::filesystem::path file, bool);
 	void start (uint8_t const *, int);
 
+	FrameInfo do_write (uint8_t const *, int);
+	void do_fake_write (int size);
+
 	/* do this with an opaque pointer so we don't have to include
 	   ASDCP headers
 	*/
@@ -57,7 +57,7 @@ using namespace dcp;
 MonoPictureFrame::MonoPictureFrame (boost::filesystem::path path)
 {
 	boost::uintmax_t const size = boost::filesystem::file_size (path);
-	_buffer = new ASDCP::JP2K::FrameBuffer (size);
+	_buffer.reset (new ASDCP::JP2K::FrameBuffer (size));
 	FILE* f = fopen_boost (path, "rb");
 	if (!f) {
 		boost::throw_exception (FileError ("could not open JPEG2000 file", path, errno));
@@ -77,12 +77,13 @@ MonoPictureFrame::MonoPictureFrame (boost::filesystem::path path)
  *  @param reader Reader for the asset's MXF file.
  *  @param n Frame within the asset, not taking EntryPoint into account.
  *  @param c Context for decryption, or 0.
+ *  @param buffer Buffer to read into.
  */
-MonoPictureFrame::MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, shared_ptr<DecryptionContext> c)
+MonoPictureFrame::MonoPictureFrame (
+	ASDCP::JP2K::MXFReader* reader, int n, shared_ptr<DecryptionContext> c, shared_ptr<ASDCP::JP2K::FrameBuffer> buffer
+	)
+	: _buffer (buffer)
 {
-	/* XXX: unfortunate guesswork on this buffer size */
-	_buffer = new ASDCP::JP2K::FrameBuffer (4 * Kumu::Megabyte);
-
 	ASDCP::Result_t const r = reader->ReadFrame (n, *_buffer, c->context(), c->hmac());
 
 	if (ASDCP_FAILURE (r)) {
@@ -92,15 +93,17 @@ MonoPictureFrame::MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, share
 
 MonoPictureFrame::MonoPictureFrame (uint8_t const * data, int size)
 {
-	_buffer = new ASDCP::JP2K::FrameBuffer (size);
+	_buffer.reset (new ASDCP::JP2K::FrameBuffer (size));
 	_buffer->Size (size);
 	memcpy (_buffer->Data(), data, size);
 }
 
-/** MonoPictureFrame destructor */
-MonoPictureFrame::~MonoPictureFrame ()
+/** @return Capacity that buffers for frames read from an asset need */
+int
+MonoPictureFrame::buffer_size (ASDCP::JP2K::MXFReader *)
 {
-	delete _buffer;
+	/* XXX: unfortunate guesswork on this buffer size */
+	return 4 * Kumu::Megabyte;
 }
 
 /** @return Pointer to JPEG2000 data */
@@ -67,7 +67,8 @@ class MonoPictureFrame : public boost::noncopyable
 public:
 	explicit MonoPictureFrame (boost::filesystem::path path);
 	MonoPictureFrame (uint8_t const * data, int size);
-	~MonoPictureFrame ();
+
+	typedef ASDCP::JP2K::FrameBuffer Buffer;
 
 	boost::shared_ptr<OpenJPEGImage> xyz_image (int reduce = 0) const;
 
@@ -81,9 +82,13 @@ private:
 	*/
 	friend class AssetReader<ASDCP::JP2K::MXFReader, MonoPictureFrame>;
 
-	MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, boost::shared_ptr<DecryptionContext>);
+	MonoPictureFrame (
+		ASDCP::JP2K::MXFReader* reader, int n, boost::shared_ptr<DecryptionContext>, boost::shared_ptr<ASDCP::JP2K::FrameBuffer> buffer
+		);
+
+	static int buffer_size (ASDCP::JP2K::MXFReader* reader);
 
-	ASDCP::JP2K::FrameBuffer* _buffer;
+	boost::shared_ptr<ASDCP::JP2K::FrameBuffer> _buffer;
 };
 
 }
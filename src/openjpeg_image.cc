@@ -143,6 +143,15 @@ OpenJPEGImage::~OpenJPEGImage ()
 	opj_image_destroy (_opj_image);
 }
 
+/** Replace the image that we are managing with another, taking ownership of it */
+void
+OpenJPEGImage::reset (opj_image_t* image)
+{
+	DCP_ASSERT (image->numcomps == 3);
+	opj_image_destroy (_opj_image);
+	_opj_image = image;
+}
+
 /** @param c Component index (0, 1 or 2)
  *  @return Pointer to the data for component c.
  */
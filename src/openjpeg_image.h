@@ -68,7 +68,10 @@ public:
 	}
 
 private:
+	friend class J2KDecoder;
+
 	void create (Size size);
+	void reset (opj_image_t* image);
 
 	opj_image_t* _opj_image; ///< opj_image_t that we are managing
 };
@@ -0,0 +1,444 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/pcm_kernels.cc
+ *  @brief Internal kernels for working with packed 24-bit PCM samples.
+ */
+
+#include "pcm_kernels.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#ifdef LIBDCP_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using std::min;
+using std::max;
+
+/** Most channels that the SIMD kernels will handle; with more they hand over to the scalar code */
+static int const max_simd_channels = 32;
+
+/** @return the signed value of a packed little-endian 24-bit sample */
+static inline int32_t
+decode_24 (uint8_t const * p)
+{
+	return int32_t ((uint32_t (p[0]) << 8) | (uint32_t (p[1]) << 16) | (uint32_t (p[2]) << 24)) >> 8;
+}
+
+/** Add the differences between some interleaved samples to max and sum_of_squares.
+ *  @param from Index of the first sample to look at, counting across all channels.
+ *  @param to One past the index of the last sample to look at, counting across all channels.
+ */
+static void
+compare_pcm_24_range (uint8_t const * a, uint8_t const * b, int from, int to, int channels, int32_t* max, int64_t* sum_of_squares)
+{
+	a += from * 3;
+	b += from * 3;
+	int c = from % channels;
+	for (int i = from; i < to; ++i) {
+		int32_t const d = abs (decode_24 (a) - decode_24 (b));
+		max[c] = std::max (max[c], d);
+		sum_of_squares[c] += int64_t (d) * d;
+		a += 3;
+		b += 3;
+		if (++c == channels) {
+			c = 0;
+		}
+	}
+}
+
+static void
+zero_results (int channels, int32_t* max, int64_t* sum_of_squares)
+{
+	for (int c = 0; c < channels; ++c) {
+		max[c] = 0;
+		sum_of_squares[c] = 0;
+	}
+}
+
+void
+dcp::compare_pcm_24_scalar (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares)
+{
+	zero_results (channels, max, sum_of_squares);
+	compare_pcm_24_range (a, b, 0, samples * channels, channels, max, sum_of_squares);
+}
+
+
+/** Convert a float sample to 24 bits, clipping if necessary, and write it to out */
+static inline void
+pack_one_float_24 (float in, uint8_t* out)
+{
+	float const clip = 1.0f - (1.0f / (1 << 23));
+
+	/* The clip is written this way (rather than with ifs) so that it has no branches */
+	float const x = max (-clip, min (clip, in));
+	int32_t const s = x * (1 << 23);
+	out[0] = s & 0xff;
+	out[1] = (s >> 8) & 0xff;
+	out[2] = (s >> 16) & 0xff;
+}
+
+/** Pack some of the samples in some of the channels.
+ *  @param from_channel First channel to pack.
+ *  @param to_channel One past the last channel to pack.
+ *  @param from First sample to pack.
+ *  @param to One past the last sample to pack.
+ */
+static void
+pack_float_24_range (float const * const * in, int channels, int from_channel, int to_channel, int from, int to, uint8_t* out)
+{
+	for (int i = from; i < to; ++i) {
+		uint8_t* o = out + (i * channels + from_channel) * 3;
+		for (int c = from_channel; c < to_channel; ++c) {
+			pack_one_float_24 (in[c] ? in[c][i] : 0, o);
+			o += 3;
+		}
+	}
+}
+
+void
+dcp::pack_float_24_scalar (float const * const * in, int channels, int samples, uint8_t* out)
+{
+	pack_float_24_range (in, channels, 0, channels, 0, samples, out);
+}
+
+#ifdef LIBDCP_X86_SIMD
+
+static int
+gcd (int a, int b)
+{
+	while (b) {
+		int const t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* The SIMD kernels work on a run of consecutive samples at a time, regardless of which channel
+ * they are in.  Going round a period of lcm(lanes, channels) samples, each lane always sees the
+ * same channel, so we keep one accumulator per vector in the period and fold the lanes into their
+ * channels at the end.  All the arithmetic is on integers, so the results are exactly those of
+ * the scalar kernel.
+ */
+
+/** Decode 4 packed 24-bit samples, reading 16 bytes from p */
+__attribute__((target("sse4.1")))
+static inline __m128i
+decode_24_sse41 (uint8_t const * p, __m128i unpack)
+{
+	return _mm_srai_epi32 (_mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast<__m128i const *> (p)), unpack), 8);
+}
+
+__attribute__((target("sse4.1")))
+void
+dcp::compare_pcm_24_sse41 (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares)
+{
+	if (channels > max_simd_channels) {
+		compare_pcm_24_scalar (a, b, samples, channels, max, sum_of_squares);
+		return;
+	}
+
+	zero_results (channels, max, sum_of_squares);
+
+	int const steps = channels / gcd (4, channels);
+	__m128i max_acc[max_simd_channels];
+	__m128i even_acc[max_simd_channels];
+	__m128i odd_acc[max_simd_channels];
+	for (int j = 0; j < steps; ++j) {
+		max_acc[j] = even_acc[j] = odd_acc[j] = _mm_setzero_si128 ();
+	}
+
+	/* Move the 3 bytes of each sample to the top of a 32-bit lane, ready to be sign-extended */
+	__m128i const unpack = _mm_setr_epi8 (-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+	int const n = samples * channels;
+	int i = 0;
+	int j = 0;
+	/* Each load reads 16 bytes of which 12 are used, so stop before it could go off the end */
+	for (; i + 6 <= n; i += 4) {
+		__m128i const d = _mm_abs_epi32 (_mm_sub_epi32 (decode_24_sse41 (a + i * 3, unpack), decode_24_sse41 (b + i * 3, unpack)));
+		max_acc[j] = _mm_max_epi32 (max_acc[j], d);
+		/* _mm_mul_epi32 gives 64-bit products of lanes 0 and 2, so shift 1 and 3 down to get those */
+		__m128i const odd = _mm_srli_epi64 (d, 32);
+		even_acc[j] = _mm_add_epi64 (even_acc[j], _mm_mul_epi32 (d, d));
+		odd_acc[j] = _mm_add_epi64 (odd_acc[j], _mm_mul_epi32 (odd, odd));
+		if (++j == steps) {
+			j = 0;
+		}
+	}
+
+	for (int k = 0; k < steps; ++k) {
+		int32_t m[4];
+		int64_t even[2];
+		int64_t odd[2];
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (m), max_acc[k]);
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (even), even_acc[k]);
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (odd), odd_acc[k]);
+		for (int l = 0; l < 4; ++l) {
+			int const c = (k * 4 + l) % channels;
+			max[c] = std::max (max[c], m[l]);
+			sum_of_squares[c] += (l % 2) ? odd[l / 2] : even[l / 2];
+		}
+	}
+
+	compare_pcm_24_range (a, b, i, n, channels, max, sum_of_squares);
+}
+
+/** Decode 8 packed 24-bit samples, reading 28 bytes from p */
+__attribute__((target("avx2")))
+static inline __m256i
+decode_24_avx2 (uint8_t const * p, __m256i unpack)
+{
+	__m256i const raw = _mm256_inserti128_si256 (
+		_mm256_castsi128_si256 (_mm_loadu_si128 (reinterpret_cast<__m128i const *> (p))),
+		_mm_loadu_si128 (reinterpret_cast<__m128i const *> (p + 12)),
+		1
+		);
+	return _mm256_srai_epi32 (_mm256_shuffle_epi8 (raw, unpack), 8);
+}
+
+__attribute__((target("avx2")))
+void
+dcp::compare_pcm_24_avx2 (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares)
+{
+	if (channels > max_simd_channels) {
+		compare_pcm_24_scalar (a, b, samples, channels, max, sum_of_squares);
+		return;
+	}
+
+	zero_results (channels, max, sum_of_squares);
+
+	int const steps = channels / gcd (8, channels);
+	__m256i max_acc[max_simd_channels];
+	__m256i even_acc[max_simd_channels];
+	__m256i odd_acc[max_simd_channels];
+	for (int j = 0; j < steps; ++j) {
+		max_acc[j] = even_acc[j] = odd_acc[j] = _mm256_setzero_si256 ();
+	}
+
+	/* _mm256_shuffle_epi8 works within each 128-bit half, so each half gets 4 samples' worth of bytes */
+	__m256i const unpack = _mm256_setr_epi8 (
+		-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+		-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11
+		);
+
+	int const n = samples * channels;
+	int i = 0;
+	int j = 0;
+	/* The second load of each pair reads 16 bytes from 12 bytes in, so stop before it could go off the end */
+	for (; i + 10 <= n; i += 8) {
+		__m256i const d = _mm256_abs_epi32 (_mm256_sub_epi32 (decode_24_avx2 (a + i * 3, unpack), decode_24_avx2 (b + i * 3, unpack)));
+		max_acc[j] = _mm256_max_epi32 (max_acc[j], d);
+		__m256i const odd = _mm256_srli_epi64 (d, 32);
+		even_acc[j] = _mm256_add_epi64 (even_acc[j], _mm256_mul_epi32 (d, d));
+		odd_acc[j] = _mm256_add_epi64 (odd_acc[j], _mm256_mul_epi32 (odd, odd));
+		if (++j == steps) {
+			j = 0;
+		}
+	}
+
+	for (int k = 0; k < steps; ++k) {
+		int32_t m[8];
+		int64_t even[4];
+		int64_t odd[4];
+		_mm256_storeu_si256 (reinterpret_cast<__m256i*> (m), max_acc[k]);
+		_mm256_storeu_si256 (reinterpret_cast<__m256i*> (even), even_acc[k]);
+		_mm256_storeu_si256 (reinterpret_cast<__m256i*> (odd), odd_acc[k]);
+		for (int l = 0; l < 8; ++l) {
+			int const c = (k * 8 + l) % channels;
+			max[c] = std::max (max[c], m[l]);
+			sum_of_squares[c] += (l % 2) ? odd[l / 2] : even[l / 2];
+		}
+	}
+
+	compare_pcm_24_range (a, b, i, n, channels, max, sum_of_squares);
+}
+
+
+/* The pack_float_24 kernels take 4 channels at a time.  They convert a vector of samples from
+ * each, using the same float operations as pack_one_float_24, transpose the 4 vectors so that
+ * each holds one sample from each channel, and then shuffle the low 3 bytes of each sample
+ * together for storing.
+ */
+
+/** Convert 4 samples to 24 bits in 32-bit lanes, clipping if necessary */
+__attribute__((target("sse4.1")))
+static inline __m128i
+convert_float_24_sse41 (float const * in, int offset)
+{
+	if (!in) {
+		return _mm_setzero_si128 ();
+	}
+
+	float const clip = 1.0f - (1.0f / (1 << 23));
+	__m128 const x = _mm_max_ps (_mm_min_ps (_mm_loadu_ps (in + offset), _mm_set1_ps (clip)), _mm_set1_ps (-clip));
+	return _mm_cvttps_epi32 (_mm_mul_ps (x, _mm_set1_ps (1 << 23)));
+}
+
+/** Write the 12 bytes at the bottom of v to out */
+__attribute__((target("sse4.1")))
+static inline void
+store_12_sse41 (uint8_t* out, __m128i v)
+{
+	_mm_storel_epi64 (reinterpret_cast<__m128i*> (out), v);
+	int32_t const top = _mm_extract_epi32 (v, 2);
+	memcpy (out + 8, &top, 4);
+}
+
+__attribute__((target("sse4.1")))
+void
+dcp::pack_float_24_sse41 (float const * const * in, int channels, int samples, uint8_t* out)
+{
+	__m128i const pack = _mm_setr_epi8 (0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	int const stride = channels * 3;
+	int const vector_channels = channels - channels % 4;
+
+	int i = 0;
+	for (; i + 4 <= samples; i += 4) {
+		for (int c = 0; c < vector_channels; c += 4) {
+			__m128i const s0 = convert_float_24_sse41 (in[c], i);
+			__m128i const s1 = convert_float_24_sse41 (in[c + 1], i);
+			__m128i const s2 = convert_float_24_sse41 (in[c + 2], i);
+			__m128i const s3 = convert_float_24_sse41 (in[c + 3], i);
+
+			__m128i const s01_low = _mm_unpacklo_epi32 (s0, s1);
+			__m128i const s23_low = _mm_unpacklo_epi32 (s2, s3);
+			__m128i const s01_high = _mm_unpackhi_epi32 (s0, s1);
+			__m128i const s23_high = _mm_unpackhi_epi32 (s2, s3);
+
+			uint8_t* o = out + i * stride + c * 3;
+			store_12_sse41 (o, _mm_shuffle_epi8 (_mm_unpacklo_epi64 (s01_low, s23_low), pack));
+			store_12_sse41 (o + stride, _mm_shuffle_epi8 (_mm_unpackhi_epi64 (s01_low, s23_low), pack));
+			store_12_sse41 (o + stride * 2, _mm_shuffle_epi8 (_mm_unpacklo_epi64 (s01_high, s23_high), pack));
+			store_12_sse41 (o + stride * 3, _mm_shuffle_epi8 (_mm_unpackhi_epi64 (s01_high, s23_high), pack));
+		}
+		pack_float_24_range (in, channels, vector_channels, channels, i, i + 4, out);
+	}
+
+	pack_float_24_range (in, channels, 0, channels, i, samples, out);
+}
+
+/** Convert 8 samples to 24 bits in 32-bit lanes, clipping if necessary */
+__attribute__((target("avx2")))
+static inline __m256i
+convert_float_24_avx2 (float const * in, int offset)
+{
+	if (!in) {
+		return _mm256_setzero_si256 ();
+	}
+
+	float const clip = 1.0f - (1.0f / (1 << 23));
+	__m256 const x = _mm256_max_ps (_mm256_min_ps (_mm256_loadu_ps (in + offset), _mm256_set1_ps (clip)), _mm256_set1_ps (-clip));
+	return _mm256_cvttps_epi32 (_mm256_mul_ps (x, _mm256_set1_ps (1 << 23)));
+}
+
+/** Write the 12 bytes at the bottom of each half of v to out and out + offset */
+__attribute__((target("avx2")))
+static inline void
+store_12_12_avx2 (uint8_t* out, int offset, __m256i v)
+{
+	store_12_sse41 (out, _mm256_castsi256_si128 (v));
+	store_12_sse41 (out + offset, _mm256_extracti128_si256 (v, 1));
+}
+
+__attribute__((target("avx2")))
+void
+dcp::pack_float_24_avx2 (float const * const * in, int channels, int samples, uint8_t* out)
+{
+	__m256i const pack = _mm256_setr_epi8 (
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+		);
+
+	int const stride = channels * 3;
+	int const vector_channels = channels - channels % 4;
+
+	int i = 0;
+	for (; i + 8 <= samples; i += 8) {
+		for (int c = 0; c < vector_channels; c += 4) {
+			__m256i const s0 = convert_float_24_avx2 (in[c], i);
+			__m256i const s1 = convert_float_24_avx2 (in[c + 1], i);
+			__m256i const s2 = convert_float_24_avx2 (in[c + 2], i);
+			__m256i const s3 = convert_float_24_avx2 (in[c + 3], i);
+
+			/* The unpacks work within each 128-bit half, so the low half ends up with samples
+			   i to i + 3 and the high half with samples i + 4 to i + 7.
+			*/
+			__m256i const s01_low = _mm256_unpacklo_epi32 (s0, s1);
+			__m256i const s23_low = _mm256_unpacklo_epi32 (s2, s3);
+			__m256i const s01_high = _mm256_unpackhi_epi32 (s0, s1);
+			__m256i const s23_high = _mm256_unpackhi_epi32 (s2, s3);
+
+			uint8_t* o = out + i * stride + c * 3;
+			int const half = stride * 4;
+			store_12_12_avx2 (o, half, _mm256_shuffle_epi8 (_mm256_unpacklo_epi64 (s01_low, s23_low), pack));
+			store_12_12_avx2 (o + stride, half, _mm256_shuffle_epi8 (_mm256_unpackhi_epi64 (s01_low, s23_low), pack));
+			store_12_12_avx2 (o + stride * 2, half, _mm256_shuffle_epi8 (_mm256_unpacklo_epi64 (s01_high, s23_high), pack));
+			store_12_12_avx2 (o + stride * 3, half, _mm256_shuffle_epi8 (_mm256_unpackhi_epi64 (s01_high, s23_high), pack));
+		}
+		pack_float_24_range (in, channels, vector_channels, channels, i, i + 8, out);
+	}
+
+	pack_float_24_range (in, channels, 0, channels, i, samples, out);
+}
+
+#endif
+
+dcp::ComparePCM24Kernel
+dcp::compare_pcm_24_kernel ()
+{
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("avx2")) {
+		return &compare_pcm_24_avx2;
+	} else if (__builtin_cpu_supports ("sse4.1")) {
+		return &compare_pcm_24_sse41;
+	}
+#endif
+	return &compare_pcm_24_scalar;
+}
+
+dcp::PackFloat24Kernel
+dcp::pack_float_24_kernel ()
+{
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("avx2")) {
+		return &pack_float_24_avx2;
+	} else if (__builtin_cpu_supports ("sse4.1")) {
+		return &pack_float_24_sse41;
+	}
+#endif
+	return &pack_float_24_scalar;
+}
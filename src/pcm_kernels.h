@@ -0,0 +1,89 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/pcm_kernels.h
+ *  @brief Internal kernels for working with packed 24-bit PCM samples.
+ */
+
+#ifndef LIBDCP_PCM_KERNELS_H
+#define LIBDCP_PCM_KERNELS_H
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define LIBDCP_X86_SIMD
+#endif
+
+namespace dcp {
+
+/** Compare some interleaved, packed little-endian 24-bit samples.
+ *  @param a First set of samples.
+ *  @param b Second set of samples.
+ *  @param samples Number of samples per channel.
+ *  @param channels Number of channels.
+ *  @param max Filled in with the biggest difference in each channel.
+ *  @param sum_of_squares Filled in with the sum of the squared differences in each channel.
+ */
+typedef void (*ComparePCM24Kernel) (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares);
+
+extern void compare_pcm_24_scalar (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares);
+#ifdef LIBDCP_X86_SIMD
+extern void compare_pcm_24_sse41 (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares);
+extern void compare_pcm_24_avx2 (uint8_t const * a, uint8_t const * b, int samples, int channels, int32_t* max, int64_t* sum_of_squares);
+#endif
+
+/** @return The fastest compare_pcm_24 kernel that this CPU can run */
+extern ComparePCM24Kernel compare_pcm_24_kernel ();
+
+/** Convert planar float samples to interleaved, packed little-endian 24-bit samples, clipping if necessary.
+ *  @param in Pointer to the samples for each channel, which should be between -1 and 1.
+ *  A null pointer means that the channel is written as silence.
+ *  @param channels Number of channels.
+ *  @param samples Number of samples per channel.
+ *  @param out Where to write the samples: one for each channel, then the next one for each
+ *  channel, and so on.
+ */
+typedef void (*PackFloat24Kernel) (float const * const * in, int channels, int samples, uint8_t* out);
+
+extern void pack_float_24_scalar (float const * const * in, int channels, int samples, uint8_t* out);
+#ifdef LIBDCP_X86_SIMD
+extern void pack_float_24_sse41 (float const * const * in, int channels, int samples, uint8_t* out);
+extern void pack_float_24_avx2 (float const * const * in, int channels, int samples, uint8_t* out);
+#endif
+
+/** @return The fastest pack_float_24 kernel that this CPU can run */
+extern PackFloat24Kernel pack_float_24_kernel ();
+
+}
+
+#endif
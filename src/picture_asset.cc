@@ -43,12 +43,18 @@
 #include <asdcp/KM_fileio.h>
 #include <libxml++/nodes/element.h>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
 #include <list>
 #include <stdexcept>
 
 using std::string;
 using std::list;
 using std::vector;
+using std::min;
 using std::max;
 using std::pair;
 using std::make_pair;
@@ -199,6 +205,220 @@ PictureAsset::frame_buffer_equals (
 	return true;
 }
 
+namespace {
+
+typedef list<pair<NoteType, string> > NoteList;
+
+static void
+storing_note_handler (NoteList& notes, NoteType t, string s)
+{
+	notes.push_back (make_pair (t, s));
+}
+
+/** @class ParallelFrameComparison
+ *  @brief State for comparing frames of two picture assets using several threads.
+ *
+ *  Each thread makes its own comparer (and hence its own readers) and then takes
+ *  frames in turn; the thread which calls run () passes on each frame's notes and
+ *  result in frame order.
+ */
+class ParallelFrameComparison : public boost::noncopyable
+{
+public:
+	/** Same as PictureAsset::FrameComparer */
+	typedef boost::function<bool (int, NoteHandler)> FrameComparer;
+
+	ParallelFrameComparison (int frames, bool keep_going, boost::function<FrameComparer ()> make_comparer)
+		: _frames (frames)
+		, _keep_going (keep_going)
+		, _make_comparer (make_comparer)
+		, _results (frames)
+		, _next (0)
+		, _limit (frames)
+		, _stop (false)
+	{}
+
+	~ParallelFrameComparison ()
+	{
+		stop ();
+	}
+
+	bool run (int threads, NoteHandler note)
+	{
+		for (int i = 0; i < min (threads, _frames); ++i) {
+			_threads.create_thread (boost::bind (&ParallelFrameComparison::thread, this));
+		}
+
+		bool result = true;
+
+		for (int i = 0; i < _frames; ++i) {
+			boost::mutex::scoped_lock lm (_mutex);
+			while (!_results[i].done && !_exception) {
+				_done.wait (lm);
+			}
+
+			if (_exception) {
+				boost::exception_ptr e = _exception;
+				lm.unlock ();
+				stop ();
+				boost::rethrow_exception (e);
+			}
+
+			Result r;
+			std::swap (r, _results[i]);
+			lm.unlock ();
+
+			/* Pass on any notes given before an exception, as would happen if we were not using threads */
+			for (NoteList::const_iterator j = r.notes.begin(); j != r.notes.end(); ++j) {
+				note (j->first, j->second);
+			}
+
+			if (r.exception) {
+				stop ();
+				boost::rethrow_exception (r.exception);
+			}
+
+			if (!r.equal) {
+				result = false;
+				if (!_keep_going) {
+					break;
+				}
+			}
+		}
+
+		stop ();
+		return result;
+	}
+
+private:
+	struct Result
+	{
+		Result ()
+			: done (false)
+			, equal (false)
+		{}
+
+		bool done;
+		bool equal;
+		NoteList notes;
+		boost::exception_ptr exception;
+	};
+
+	void stop ()
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			_stop = true;
+		}
+		_threads.join_all ();
+	}
+
+	void thread ()
+	{
+		FrameComparer compare;
+		try {
+			compare = _make_comparer ();
+		} catch (...) {
+			boost::mutex::scoped_lock lm (_mutex);
+			if (!_exception) {
+				_exception = boost::current_exception ();
+			}
+			_done.notify_all ();
+			return;
+		}
+
+		while (true) {
+			int n;
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				if (_stop || _next >= _limit) {
+					return;
+				}
+				n = _next++;
+			}
+
+			Result r;
+			try {
+				r.equal = compare (n, boost::bind (&storing_note_handler, boost::ref (r.notes), _1, _2));
+			} catch (...) {
+				r.exception = boost::current_exception ();
+			}
+			r.done = true;
+
+			boost::mutex::scoped_lock lm (_mutex);
+			if ((!r.equal && !_keep_going) || r.exception) {
+				/* Nothing after this frame will be needed */
+				_limit = min (_limit, n + 1);
+			}
+			std::swap (_results[n], r);
+			_done.notify_all ();
+		}
+	}
+
+	int const _frames;
+	bool const _keep_going;
+	boost::function<FrameComparer ()> _make_comparer;
+
+	/** mutex to protect everything below, except _threads */
+	boost::mutex _mutex;
+	/** signalled when a frame has been compared, or _exception has been set */
+	boost::condition _done;
+	vector<Result> _results;
+	/** next frame for a thread to compare */
+	int _next;
+	/** one past the last frame that threads should compare */
+	int _limit;
+	bool _stop;
+	/** exception thrown when a thread was setting up, if any */
+	boost::exception_ptr _exception;
+
+	boost::thread_group _threads;
+};
+
+}
+
+/** Compare all the frames of this asset with those of another.
+ *  @param other_intrinsic_duration Intrinsic duration of the other asset.
+ *  @param opt Comparison options; opt.threads frames are compared at once.
+ *  @param note Handler for notes, which are given in frame order and from the calling thread.
+ *  @param make_comparer Function to make a FrameComparer; this will be called once per thread,
+ *  so each comparer can have its own readers.
+ *  @return true if all the frames are equal.
+ */
+bool
+PictureAsset::frames_equal (
+	int64_t other_intrinsic_duration, EqualityOptions opt, NoteHandler note, boost::function<FrameComparer ()> make_comparer
+	) const
+{
+	bool result = true;
+
+	int64_t frames = _intrinsic_duration;
+	if (other_intrinsic_duration != _intrinsic_duration) {
+		/* descriptor_equals will have already said so */
+		result = false;
+		if (!opt.keep_going) {
+			return result;
+		}
+		frames = std::min (frames, other_intrinsic_duration);
+	}
+
+	if (opt.threads <= 1 || frames < 2) {
+		FrameComparer compare = make_comparer ();
+		for (int i = 0; i < frames; ++i) {
+			if (!compare (i, note)) {
+				result = false;
+				if (!opt.keep_going) {
+					break;
+				}
+			}
+		}
+		return result;
+	}
+
+	ParallelFrameComparison comparison (frames, opt.keep_going, make_comparer);
+	return comparison.run (opt.threads, note) && result;
+}
+
 string
 PictureAsset::static_pkl_type (Standard standard)
 {
@@ -112,6 +112,18 @@ protected:
 		uint8_t const * data_A, unsigned int size_A, uint8_t const * data_B, unsigned int size_B
 		) const;
 
+	/** Function to compare a frame of this asset with the same frame of another,
+	 *  giving any notes to a handler, and returning true if they are equal.
+	 */
+	typedef boost::function<bool (int, NoteHandler)> FrameComparer;
+
+	bool frames_equal (
+		int64_t other_intrinsic_duration,
+		EqualityOptions opt,
+		NoteHandler note,
+		boost::function<FrameComparer ()> make_comparer
+		) const;
+
 	bool descriptor_equals (
 		ASDCP::JP2K::PictureDescriptor const & a,
 		ASDCP::JP2K::PictureDescriptor const & b,
@@ -34,19 +34,198 @@
 #include "picture_asset_writer.h"
 #include "exceptions.h"
 #include "picture_asset.h"
+#include "dcp_assert.h"
 #include <asdcp/KM_fileio.h>
 #include <asdcp/AS_DCP.h>
+#include <boost/bind.hpp>
 #include <inttypes.h>
 #include <stdint.h>
 
 using std::string;
 using boost::shared_ptr;
+using boost::shared_future;
 using namespace dcp;
 
+/** Maximum number of jobs that can be waiting for the writer thread; write_async()
+ *  blocks when there are this many.
+ */
+static int const max_jobs = 8;
+
 PictureAssetWriter::PictureAssetWriter (PictureAsset* asset, boost::filesystem::path file, bool overwrite)
 	: AssetWriter (asset, file)
 	, _picture_asset (asset)
 	, _overwrite (overwrite)
+	, _unfinished_jobs (0)
+	, _stop (false)
 {
 	asset->set_file (file);
 }
+
+/** Write a frame, waiting for it to be written.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data.
+ *  @return Details of the written frame.
+ */
+FrameInfo
+PictureAssetWriter::write (uint8_t const * data, int size)
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (!_thread.joinable()) {
+			lm.unlock ();
+			return do_write (data, size);
+		}
+	}
+
+	return write_async(data, size).get();
+}
+
+/** Fake-write a frame; see ASDCP's FakeWriteFrame */
+void
+PictureAssetWriter::fake_write (int size)
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (!_thread.joinable()) {
+			lm.unlock ();
+			do_fake_write (size);
+			return;
+		}
+	}
+
+	shared_ptr<Job> job (new Job);
+	job->fake_size = size;
+	add_job (job);
+}
+
+/** Give a frame to the writer thread to write after everything that has been given
+ *  before it, starting the thread if necessary.  The data are copied, so they can be
+ *  re-used by the caller as soon as this method returns.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data.
+ *  @return Future for the details of the written frame, which will throw any
+ *  exception that happened when writing it.
+ */
+shared_future<FrameInfo>
+PictureAssetWriter::write_async (uint8_t const * data, int size)
+{
+	shared_ptr<Job> job (new Job);
+	job->data.assign (data, data + size);
+	job->result.reset (new boost::promise<FrameInfo>);
+	return add_job (job);
+}
+
+shared_future<FrameInfo>
+PictureAssetWriter::add_job (shared_ptr<Job> job)
+{
+	DCP_ASSERT (!_finalized);
+
+	shared_future<FrameInfo> future;
+	if (job->result) {
+		future = job->result->get_future ();
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (!_thread.joinable()) {
+		_thread = boost::thread (boost::bind (&PictureAssetWriter::thread, this));
+	}
+
+	while (int (_jobs.size()) >= max_jobs) {
+		_changed.wait (lm);
+	}
+
+	_jobs.push_back (job);
+	++_unfinished_jobs;
+	_changed.notify_all ();
+
+	return future;
+}
+
+void
+PictureAssetWriter::thread ()
+{
+	while (true) {
+		shared_ptr<Job> job;
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			while (_jobs.empty() && !_stop) {
+				_changed.wait (lm);
+			}
+			if (_jobs.empty()) {
+				return;
+			}
+			job = _jobs.front ();
+			_jobs.pop_front ();
+			/* There may be someone waiting for space in _jobs */
+			_changed.notify_all ();
+		}
+
+		boost::exception_ptr exception;
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			exception = _exception;
+		}
+
+		/* Once something has failed we fail everything after it, as the
+		   MXF will not be usable.
+		*/
+		if (!exception) {
+			try {
+				if (job->result) {
+					FrameInfo info = do_write (&job->data[0], job->data.size());
+					job->result->set_value (info);
+				} else {
+					do_fake_write (job->fake_size);
+				}
+			} catch (...) {
+				exception = boost::current_exception ();
+				boost::mutex::scoped_lock lm (_mutex);
+				_exception = exception;
+			}
+		}
+
+		if (exception && job->result) {
+			job->result->set_exception (exception);
+		}
+
+		boost::mutex::scoped_lock lm (_mutex);
+		--_unfinished_jobs;
+		_changed.notify_all ();
+	}
+}
+
+/** Wait until everything given to write_async(), and the write() and fake_write() calls after it,
+ *  has been written, re-throwing the first exception that happened when writing, if any.
+ */
+void
+PictureAssetWriter::flush ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	while (_unfinished_jobs > 0) {
+		_changed.wait (lm);
+	}
+
+	if (_exception) {
+		boost::rethrow_exception (_exception);
+	}
+}
+
+/** Stop the writer thread, if there is one, after it has done any outstanding jobs.
+ *  This must be called by derived classes' destructors, as the thread uses their state.
+ */
+void
+PictureAssetWriter::stop_thread ()
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (!_thread.joinable()) {
+			return;
+		}
+		_stop = true;
+		_changed.notify_all ();
+	}
+
+	_thread.join ();
+}
@@ -43,8 +43,14 @@
 #include "asset_writer.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/exception_ptr.hpp>
 #include <stdint.h>
 #include <string>
+#include <list>
+#include <vector>
 
 namespace dcp {
 
@@ -73,12 +79,20 @@ struct FrameInfo
 
 /** @class PictureAssetWriter
  *  @brief Parent class for classes which write picture assets.
+ *
+ *  Frames can be written synchronously with write(), or handed to a writer thread
+ *  with write_async().  Once write_async() has been called, write() and fake_write()
+ *  are also passed to the writer thread so that all frames are written in the order
+ *  in which they were given.  flush() waits for everything to be written; finalize()
+ *  also does this.
  */
 class PictureAssetWriter : public AssetWriter
 {
 public:
-	virtual FrameInfo write (uint8_t const *, int) = 0;
-	virtual void fake_write (int) = 0;
+	FrameInfo write (uint8_t const *, int);
+	void fake_write (int);
+	boost::shared_future<FrameInfo> write_async (uint8_t const *, int);
+	void flush ();
 
 protected:
 	template <class P, class Q>
@@ -86,8 +100,46 @@ protected:
 
 	PictureAssetWriter (PictureAsset *, boost::filesystem::path, bool);
 
+	/** Write a frame on the calling thread */
+	virtual FrameInfo do_write (uint8_t const *, int) = 0;
+	/** Fake-write a frame on the calling thread */
+	virtual void do_fake_write (int) = 0;
+
+	void stop_thread ();
+
 	PictureAsset* _picture_asset;
 	bool _overwrite;
+
+private:
+	/** A write or fake write waiting for the writer thread */
+	struct Job
+	{
+		Job ()
+			: fake_size (0)
+		{}
+
+		/** JPEG2000 data to write, or empty for a fake write */
+		std::vector<uint8_t> data;
+		/** size to pass to fake_write for a fake write */
+		int fake_size;
+		/** promise for the result of a real write */
+		boost::shared_ptr<boost::promise<FrameInfo> > result;
+	};
+
+	boost::shared_future<FrameInfo> add_job (boost::shared_ptr<Job> job);
+	void thread ();
+
+	boost::thread _thread;
+	/** mutex to protect the things below */
+	boost::mutex _mutex;
+	/** signalled when a job has been added, taken or finished, or the thread should stop */
+	boost::condition _changed;
+	std::list<boost::shared_ptr<Job> > _jobs;
+	/** number of jobs that have been added but not yet finished */
+	int _unfinished_jobs;
+	bool _stop;
+	/** exception thrown by the first job to fail, if any */
+	boost::exception_ptr _exception;
 };
 
 }
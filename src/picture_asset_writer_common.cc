@@ -42,13 +42,50 @@ struct ASDCPStateBase
 	{}
 
 	ASDCP::JP2K::CodestreamParser j2k_parser;
+	/** buffer for frames that must be copied and parsed */
 	ASDCP::JP2K::FrameBuffer frame_buffer;
+	/** buffer which points to the caller's data, for frames which need not be copied */
+	ASDCP::JP2K::FrameBuffer wrapped_frame_buffer;
 	ASDCP::WriterInfo writer_info;
 	ASDCP::JP2K::PictureDescriptor picture_descriptor;
 };
 
 }
 
+/** Get a frame ready to be passed to an ASDCP writer.
+ *  @param state ASDCP state of the writer.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data.
+ *  @param encrypted true if the frame will be encrypted.
+ *  @return Buffer to write.
+ */
+template <class P>
+static ASDCP::JP2K::FrameBuffer const &
+prepare_frame (shared_ptr<P> state, uint8_t const * data, int size, bool encrypted)
+{
+	if (encrypted) {
+		/* We need ASDCP's parse to find the start of the image data, as the
+		   headers before it are left unencrypted.
+		*/
+		if (ASDCP_FAILURE (state->j2k_parser.OpenReadFrame (data, size, state->frame_buffer))) {
+			boost::throw_exception (dcp::MiscError ("could not parse J2K frame"));
+		}
+		return state->frame_buffer;
+	}
+
+	/* The picture descriptor came from the first frame, and ASDCP does not use anything else
+	   from a parse when writing unencrypted data, so we just check that this looks like a
+	   codestream (it starts with a SOC marker) and then write it from where it is.
+	*/
+	if (size < 2 || data[0] != 0xff || data[1] != 0x4f) {
+		boost::throw_exception (dcp::MiscError ("could not parse J2K frame"));
+	}
+
+	state->wrapped_frame_buffer.SetData (const_cast<uint8_t*> (data), size);
+	state->wrapped_frame_buffer.Size (size);
+	return state->wrapped_frame_buffer;
+}
+
 template <class P, class Q>
 void dcp::start (PictureAssetWriter* writer, shared_ptr<P> state, Q* asset, uint8_t const * data, int size)
 {
@@ -40,7 +40,9 @@
 #include <boost/foreach.hpp>
 #include <iostream>
 
+using std::list;
 using std::string;
+using std::make_pair;
 using boost::shared_ptr;
 using boost::optional;
 using namespace dcp;
@@ -69,14 +71,18 @@ PKL::PKL (boost::filesystem::path file)
 	_creator = pkl.string_child ("Creator");
 
 	BOOST_FOREACH (cxml::ConstNodePtr i, pkl.node_child("AssetList")->node_children("Asset")) {
-		_asset_list.push_back (shared_ptr<Asset> (new Asset (i)));
+		shared_ptr<Asset> asset (new Asset (i));
+		_asset_list.push_back (asset);
+		_asset_map.insert (make_pair (asset->id(), asset));
 	}
 }
 
 void
 PKL::add_asset (std::string id, boost::optional<std::string> annotation_text, std::string hash, int64_t size, std::string type)
 {
-	_asset_list.push_back (shared_ptr<Asset> (new Asset (id, annotation_text, hash, size, type)));
+	shared_ptr<Asset> asset (new Asset (id, annotation_text, hash, size, type));
+	_asset_list.push_back (asset);
+	_asset_map.insert (make_pair (id, asset));
 }
 
 void
@@ -123,23 +129,43 @@ PKL::write (boost::filesystem::path file, shared_ptr<const CertificateChain> sig
 optional<string>
 PKL::hash (string id) const
 {
-	BOOST_FOREACH (shared_ptr<Asset> i, _asset_list) {
-		if (i->id() == id) {
-			return i->hash;
-		}
+	boost::unordered_map<string, shared_ptr<Asset> >::const_iterator i = _asset_map.find (id);
+	if (i == _asset_map.end ()) {
+		return optional<string>();
 	}
 
-	return optional<string>();
+	return i->second->hash;
 }
 
 optional<string>
 PKL::type (string id) const
 {
-	BOOST_FOREACH (shared_ptr<Asset> i, _asset_list) {
-		if (i->id() == id) {
-			return i->type;
-		}
+	boost::unordered_map<string, shared_ptr<Asset> >::const_iterator i = _asset_map.find (id);
+	if (i == _asset_map.end ()) {
+		return optional<string>();
+	}
+
+	return i->second->type;
+}
+
+optional<int64_t>
+PKL::size (string id) const
+{
+	boost::unordered_map<string, shared_ptr<Asset> >::const_iterator i = _asset_map.find (id);
+	if (i == _asset_map.end ()) {
+		return optional<int64_t>();
 	}
 
-	return optional<string>();
+	return i->second->size;
+}
+
+/** @return IDs of the assets in this PKL, in the order that they appear in it */
+list<string>
+PKL::asset_ids () const
+{
+	list<string> ids;
+	BOOST_FOREACH (shared_ptr<Asset> i, _asset_list) {
+		ids.push_back (i->id());
+	}
+	return ids;
 }
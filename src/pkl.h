@@ -40,6 +40,7 @@
 #include "certificate_chain.h"
 #include <libcxml/cxml.h>
 #include <boost/filesystem.hpp>
+#include <boost/unordered_map.hpp>
 
 namespace dcp {
 
@@ -62,6 +63,8 @@ public:
 
 	boost::optional<std::string> hash (std::string id) const;
 	boost::optional<std::string> type (std::string id) const;
+	boost::optional<int64_t> size (std::string id) const;
+	std::list<std::string> asset_ids () const;
 
 	void add_asset (std::string id, boost::optional<std::string> annotation_text, std::string hash, int64_t size, std::string type);
 	void write (boost::filesystem::path file, boost::shared_ptr<const CertificateChain> signer) const;
@@ -104,6 +107,8 @@ private:
 	std::string _issuer;
 	std::string _creator;
 	std::list<boost::shared_ptr<Asset> > _asset_list;
+	/** The assets in _asset_list, keyed on their IDs */
+	boost::unordered_map<std::string, boost::shared_ptr<Asset> > _asset_map;
 	/** The most recent disk file used to read or write this PKL */
 	mutable boost::optional<boost::filesystem::path> _file;
 };
@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/private_key.cc
+ *  @brief PrivateKey class.
+ */
+
+#include "private_key.h"
+#include "exceptions.h"
+#include "compose.hpp"
+#include <openssl/pem.h>
+#include <openssl/err.h>
+
+using std::string;
+using namespace dcp;
+
+PrivateKey::PrivateKey (string pem)
+	: _rsa (0)
+{
+	BIO* bio = BIO_new_mem_buf (const_cast<char *> (pem.c_str ()), -1);
+	if (!bio) {
+		throw MiscError ("could not create memory BIO");
+	}
+
+	_rsa = PEM_read_bio_RSAPrivateKey (bio, 0, 0, 0);
+	BIO_free (bio);
+
+	if (!_rsa) {
+		/* Don't put the PEM in the message, as it is the key itself */
+		throw MiscError (String::compose ("could not read RSA private key (%1)", ERR_error_string (ERR_get_error(), 0)));
+	}
+}
+
+PrivateKey::~PrivateKey ()
+{
+	RSA_free (_rsa);
+}
+
+int
+PrivateKey::size () const
+{
+	return RSA_size (_rsa);
+}
+
+int
+PrivateKey::bits () const
+{
+#if OPENSSL_VERSION_NUMBER > 0x10100000L
+	return RSA_bits (_rsa);
+#else
+	return _rsa->n->dmax;
+#endif
+}
+
+/** Decrypt some RSA-OAEP-encrypted data.
+ *  @param in Encrypted data.
+ *  @param in_length Length of in in bytes.
+ *  @param out Buffer for the decrypted data, which must have space for at least size() bytes.
+ *  @return Length of the decrypted data in bytes, or -1 on error (when ERR_get_error() will say more).
+ */
+int
+PrivateKey::decrypt (unsigned char const * in, int in_length, unsigned char* out) const
+{
+	return RSA_private_decrypt (in_length, in, out, _rsa, RSA_PKCS1_OAEP_PADDING);
+}
@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/private_key.h
+ *  @brief PrivateKey class.
+ */
+
+#ifndef LIBDCP_PRIVATE_KEY_H
+#define LIBDCP_PRIVATE_KEY_H
+
+#include <openssl/rsa.h>
+#include <boost/noncopyable.hpp>
+#include <string>
+
+namespace dcp {
+
+/** @class PrivateKey
+ *  @brief An RSA private key which has been read from PEM once, so that it can be used
+ *  to decrypt many KDMs.
+ *
+ *  A PrivateKey may be used by several threads at once.
+ */
+class PrivateKey : public boost::noncopyable
+{
+public:
+	/** @param pem Private key as a PEM-format string */
+	explicit PrivateKey (std::string pem);
+	~PrivateKey ();
+
+	RSA* rsa () const {
+		return _rsa;
+	}
+
+	/** @return Size of the key's modulus in bytes, which is the most that decrypt() can write */
+	int size () const;
+	int bits () const;
+
+	int decrypt (unsigned char const * in, int in_length, unsigned char* out) const;
+
+private:
+	RSA* _rsa;
+};
+
+}
+
+#endif
@@ -49,6 +49,7 @@
 #include "smpte_subtitle_asset.h"
 #include "reel_atmos_asset.h"
 #include "reel_closed_caption_asset.h"
+#include "asset_index.h"
 #include <libxml++/nodes/element.h>
 #include <boost/foreach.hpp>
 #include <stdint.h>
@@ -309,7 +310,13 @@ Reel::assets () const
 }
 
 void
-Reel::resolve_refs (list<shared_ptr<Asset> > assets)
+Reel::resolve_refs (list<shared_ptr<Asset> > const & assets)
+{
+	resolve_refs (AssetIndex (assets));
+}
+
+void
+Reel::resolve_refs (AssetIndex const & assets)
 {
 	if (_main_picture) {
 		_main_picture->asset_ref().resolve (assets);
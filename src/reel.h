@@ -59,6 +59,7 @@ class ReelSubtitleAsset;
 class ReelMarkersAsset;
 class ReelClosedCaptionAsset;
 class ReelAtmosAsset;
+class AssetIndex;
 class Content;
 
 /** @brief A reel within a DCP; the part which actually refers to picture, sound, subtitle, marker and Atmos data */
@@ -121,7 +122,8 @@ public:
 
 	void add (DecryptedKDM const &);
 
-	void resolve_refs (std::list<boost::shared_ptr<Asset> >);
+	void resolve_refs (std::list<boost::shared_ptr<Asset> > const &);
+	void resolve_refs (AssetIndex const &);
 
 private:
 	boost::shared_ptr<ReelPictureAsset> _main_picture;
@@ -32,23 +32,57 @@
 */
 
 #include "ref.h"
+#include "lazy_asset.h"
+#include "asset_index.h"
 
 using std::list;
 using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
 using namespace dcp;
 
 /** Look through a list of assets and copy a shared_ptr to any asset
  *  which matches the ID of this one.
  */
 void
-Ref::resolve (list<shared_ptr<Asset> > assets)
+Ref::resolve (list<shared_ptr<Asset> > const & assets)
 {
-	list<shared_ptr<Asset> >::iterator i = assets.begin();
+	list<shared_ptr<Asset> >::const_iterator i = assets.begin();
 	while (i != assets.end() && !ids_equal ((*i)->id(), _id)) {
 		++i;
 	}
 
 	if (i != assets.end ()) {
-		_asset = *i;
+		set (*i);
 	}
 }
+
+/** Look up this Ref's ID in an index and copy a shared_ptr to the asset, if there is one */
+void
+Ref::resolve (AssetIndex const & assets)
+{
+	shared_ptr<Asset> a = assets.find (_id);
+	if (a) {
+		set (a);
+	}
+}
+
+void
+Ref::set (shared_ptr<Asset> asset)
+{
+	_lazy = dynamic_pointer_cast<LazyAsset> (asset);
+	_asset = _lazy ? shared_ptr<Asset> () : asset;
+}
+
+shared_ptr<Asset>
+Ref::asset () const
+{
+	if (_lazy) {
+		return _lazy->asset ();
+	}
+
+	if (!_asset) {
+		throw UnresolvedRefError (_id);
+	}
+
+	return _asset;
+}
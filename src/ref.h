@@ -46,6 +46,9 @@
 
 namespace dcp {
 
+class LazyAsset;
+class AssetIndex;
+
 /** @class Ref
  *  @brief A reference to an asset which is identified by a universally-unique identifier (UUID).
  *
@@ -54,8 +57,10 @@ namespace dcp {
  *  which represents the thing.
  *
  *  If the Ref does not have a shared_ptr it may be given one by
- *  calling resolve() with a list of assets.  The shared_ptr will be
+ *  calling resolve() with a list of assets or an AssetIndex.  The shared_ptr will be
  *  set up using any object on the list which has a matching ID.
+ *  If that object is a LazyAsset the Ref will give out the real asset
+ *  that it opens, rather than the LazyAsset itself.
  */
 class Ref
 {
@@ -77,7 +82,8 @@ public:
 		_id = id;
 	}
 
-	void resolve (std::list<boost::shared_ptr<Asset> > assets);
+	void resolve (std::list<boost::shared_ptr<Asset> > const & assets);
+	void resolve (AssetIndex const & assets);
 
 	/** @return the ID of the thing that we are pointing to */
 	std::string id () const {
@@ -87,33 +93,26 @@ public:
 	/** @return a shared_ptr to the thing; an UnresolvedRefError is thrown
 	 *  if the shared_ptr is not known.
 	 */
-	boost::shared_ptr<Asset> asset () const {
-		if (!_asset) {
-			throw UnresolvedRefError (_id);
-		}
-
-		return _asset;
-	}
+	boost::shared_ptr<Asset> asset () const;
 
 	/** operator-> to access the shared_ptr; an UnresolvedRefError is thrown
 	 *  if the shared_ptr is not known.
 	 */
 	Asset * operator->() const {
-		if (!_asset) {
-			throw UnresolvedRefError (_id);
-		}
-
-		return _asset.get ();
+		return asset().get ();
 	}
 
 	/** @return true if a shared_ptr is known for this Ref */
 	bool resolved () const {
-		return static_cast<bool>(_asset);
+		return _asset || _lazy;
 	}
 
 private:
+	void set (boost::shared_ptr<Asset> asset);
+
 	std::string _id;             ///< ID; will always be known
 	boost::shared_ptr<Asset> _asset; ///< shared_ptr to the thing, may be null.
+	boost::shared_ptr<LazyAsset> _lazy; ///< placeholder which can open the thing, may be null.
 };
 
 }
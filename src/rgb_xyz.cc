@@ -37,17 +37,460 @@
 #include "transfer_function.h"
 #include "dcp_assert.h"
 #include "compose.hpp"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
 #include <cmath>
+#if defined(__GNUC__) && defined(__x86_64__)
+#define LIBDCP_X86_SIMD
+#include <immintrin.h>
+#endif
 
 using std::min;
 using std::max;
 using std::cout;
+using std::vector;
+using std::list;
+using std::pair;
+using std::string;
+using std::make_pair;
 using boost::shared_ptr;
 using boost::optional;
+using boost::scoped_array;
 using namespace dcp;
 
 #define DCI_COEFFICIENT (48.0 / 52.37)
 
+namespace {
+
+/** @class XYZToRGBTables
+ *  @brief Look-up tables and matrix used by the xyz_to_rgb and xyz_to_rgba kernels;
+ *  these are made once per image and shared by all the threads converting it.
+ */
+class XYZToRGBTables
+{
+public:
+	/** @param bits Number of bits in each output component (16 for xyz_to_rgb, 8 for xyz_to_rgba) */
+	XYZToRGBTables (ColourConversion const & conversion, int bits)
+		: lut_in (new double[4096])
+		/* One extra entry so that a 32-bit gather of the last entry stays inside the array */
+		, lut_out (new uint16_t[65537])
+	{
+		/* In gamma LUT with the DCI companding folded in */
+		double const * lut_in_double = conversion.out()->lut (12, false);
+		for (int i = 0; i < 4096; ++i) {
+			lut_in[i] = lut_in_double[i] / DCI_COEFFICIENT;
+		}
+
+		boost::numeric::ublas::matrix<double> const m = conversion.xyz_to_rgb ();
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				matrix[i * 3 + j] = m (i, j);
+			}
+		}
+
+		/* Out gamma LUT with the scaling to the output bit depth folded in */
+		double const * lut_out_double = conversion.in()->lut (16, true);
+		if (bits == 16) {
+			for (int i = 0; i < 65536; ++i) {
+				lut_out[i] = lrint (lut_out_double[i] * 65535);
+			}
+		} else {
+			DCP_ASSERT (bits == 8);
+			for (int i = 0; i < 65536; ++i) {
+				/* Truncate, as a conversion to uint8_t would */
+				lut_out[i] = static_cast<uint8_t> (lut_out_double[i] * 0xff);
+			}
+		}
+		lut_out[65536] = 0;
+	}
+
+	scoped_array<double> lut_in;
+	double matrix[9];
+	scoped_array<uint16_t> lut_out;
+};
+
+}
+
+/** Convert one in-range XYZ pixel to RGB, giving values from the tables' out LUT */
+static inline void
+xyz_to_rgb_pixel (XYZToRGBTables const & tables, int cx, int cy, int cz, int& r, int& g, int& b)
+{
+	double const * m = tables.matrix;
+
+	/* In gamma LUT and DCI companding */
+	double const x = tables.lut_in[cx];
+	double const y = tables.lut_in[cy];
+	double const z = tables.lut_in[cz];
+
+	/* XYZ to RGB */
+	double const dr = max (min ((x * m[0]) + (y * m[1]) + (z * m[2]), 1.0), 0.0);
+	double const dg = max (min ((x * m[3]) + (y * m[4]) + (z * m[5]), 1.0), 0.0);
+	double const db = max (min ((x * m[6]) + (y * m[7]) + (z * m[8]), 1.0), 0.0);
+
+	/* Out gamma LUT */
+	r = tables.lut_out[lrint(dr * 65535)];
+	g = tables.lut_out[lrint(dg * 65535)];
+	b = tables.lut_out[lrint(db * 65535)];
+}
+
+static inline int
+clamp_xyz (int v, optional<NoteHandler> const & note)
+{
+	if (v < 0 || v > 4095) {
+		if (note) {
+			note.get() (DCP_NOTE, String::compose ("XYZ value %1 out of range", v));
+		}
+		return max (min (v, 4095), 0);
+	}
+	return v;
+}
+
+/** Convert some pixels from XYZ to 48bpp RGB one at a time, clamping (and noting) any XYZ values
+ *  that are out of range.
+ */
+static void
+xyz_to_rgb_pixels_scalar (
+	XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int n, uint16_t* rgb, optional<NoteHandler> const & note
+	)
+{
+	for (int i = 0; i < n; ++i) {
+		int const cx = clamp_xyz (*xyz_x++, note);
+		int const cy = clamp_xyz (*xyz_y++, note);
+		int const cz = clamp_xyz (*xyz_z++, note);
+		int r, g, b;
+		xyz_to_rgb_pixel (tables, cx, cy, cz, r, g, b);
+		*rgb++ = r;
+		*rgb++ = g;
+		*rgb++ = b;
+	}
+}
+
+/** Convert some pixels from XYZ to 32bpp BGRA one at a time.
+ *  @return false if an XYZ value was out of range, in which case conversion stops there.
+ */
+static bool
+xyz_to_rgba_pixels_scalar (XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int n, uint8_t* argb)
+{
+	for (int i = 0; i < n; ++i) {
+		int const cx = *xyz_x++;
+		int const cy = *xyz_y++;
+		int const cz = *xyz_z++;
+		if (cx < 0 || cy < 0 || cz < 0 || cx > 4095 || cy > 4095 || cz > 4095) {
+			return false;
+		}
+		int r, g, b;
+		xyz_to_rgb_pixel (tables, cx, cy, cz, r, g, b);
+		*argb++ = b;
+		*argb++ = g;
+		*argb++ = r;
+		*argb++ = 0xff;
+	}
+
+	return true;
+}
+
+#ifdef LIBDCP_X86_SIMD
+
+/* As with the rgb_to_xyz kernels these do the same double-precision arithmetic, in the same
+ * order, as xyz_to_rgb_pixel so their results are bit-identical to it.  Any group of pixels
+ * containing an out-of-range XYZ value is handed to the scalar code so that it is noted
+ * (or rejected) exactly as before.
+ */
+
+/** Convert 2 pixels from XYZ to RGB out LUT values.
+ *  @return false if any XYZ value is out of range, in which case nothing is converted.
+ */
+__attribute__((target("sse4.1")))
+static inline bool
+xyz_to_rgb_2_sse41 (XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int* r, int* g, int* b)
+{
+	__m128i const cx = _mm_loadl_epi64 (reinterpret_cast<__m128i const *> (xyz_x));
+	__m128i const cy = _mm_loadl_epi64 (reinterpret_cast<__m128i const *> (xyz_y));
+	__m128i const cz = _mm_loadl_epi64 (reinterpret_cast<__m128i const *> (xyz_z));
+
+	/* Treating the values as unsigned makes negative ones big, so one test finds both ends of the range */
+	__m128i const top = _mm_set1_epi32 (4095);
+	__m128i const big = _mm_max_epu32 (_mm_max_epu32 (cx, cy), cz);
+	if (!_mm_testc_si128 (_mm_cmpeq_epi32 (_mm_min_epu32 (big, top), big), _mm_set1_epi32 (-1))) {
+		return false;
+	}
+
+	double const * lut_in = tables.lut_in.get ();
+	double const * m = tables.matrix;
+
+	__m128d const x = _mm_setr_pd (lut_in[xyz_x[0]], lut_in[xyz_x[1]]);
+	__m128d const y = _mm_setr_pd (lut_in[xyz_y[0]], lut_in[xyz_y[1]]);
+	__m128d const z = _mm_setr_pd (lut_in[xyz_z[0]], lut_in[xyz_z[1]]);
+
+	__m128d const zero = _mm_setzero_pd ();
+	__m128d const one = _mm_set1_pd (1);
+	__m128d const scale = _mm_set1_pd (65535);
+
+	__m128d const dr = _mm_add_pd (_mm_add_pd (_mm_mul_pd (x, _mm_set1_pd (m[0])), _mm_mul_pd (y, _mm_set1_pd (m[1]))), _mm_mul_pd (z, _mm_set1_pd (m[2])));
+	__m128d const dg = _mm_add_pd (_mm_add_pd (_mm_mul_pd (x, _mm_set1_pd (m[3])), _mm_mul_pd (y, _mm_set1_pd (m[4]))), _mm_mul_pd (z, _mm_set1_pd (m[5])));
+	__m128d const db = _mm_add_pd (_mm_add_pd (_mm_mul_pd (x, _mm_set1_pd (m[6])), _mm_mul_pd (y, _mm_set1_pd (m[7]))), _mm_mul_pd (z, _mm_set1_pd (m[8])));
+
+	__m128i const ir = _mm_cvtpd_epi32 (_mm_mul_pd (_mm_max_pd (_mm_min_pd (dr, one), zero), scale));
+	__m128i const ig = _mm_cvtpd_epi32 (_mm_mul_pd (_mm_max_pd (_mm_min_pd (dg, one), zero), scale));
+	__m128i const ib = _mm_cvtpd_epi32 (_mm_mul_pd (_mm_max_pd (_mm_min_pd (db, one), zero), scale));
+
+	uint16_t const * lut_out = tables.lut_out.get ();
+	r[0] = lut_out[_mm_cvtsi128_si32 (ir)];
+	r[1] = lut_out[_mm_extract_epi32 (ir, 1)];
+	g[0] = lut_out[_mm_cvtsi128_si32 (ig)];
+	g[1] = lut_out[_mm_extract_epi32 (ig, 1)];
+	b[0] = lut_out[_mm_cvtsi128_si32 (ib)];
+	b[1] = lut_out[_mm_extract_epi32 (ib, 1)];
+
+	return true;
+}
+
+/** Convert 4 pixels from XYZ to RGB out LUT values, using gathers for the LUT look-ups.
+ *  @return false if any XYZ value is out of range, in which case nothing is converted.
+ */
+__attribute__((target("avx2")))
+static inline bool
+xyz_to_rgb_4_avx2 (XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, __m128i& r, __m128i& g, __m128i& b)
+{
+	__m128i const cx = _mm_loadu_si128 (reinterpret_cast<__m128i const *> (xyz_x));
+	__m128i const cy = _mm_loadu_si128 (reinterpret_cast<__m128i const *> (xyz_y));
+	__m128i const cz = _mm_loadu_si128 (reinterpret_cast<__m128i const *> (xyz_z));
+
+	/* Treating the values as unsigned makes negative ones big, so one test finds both ends of the range */
+	__m128i const top = _mm_set1_epi32 (4095);
+	__m128i const big = _mm_max_epu32 (_mm_max_epu32 (cx, cy), cz);
+	if (!_mm_testc_si128 (_mm_cmpeq_epi32 (_mm_min_epu32 (big, top), big), _mm_set1_epi32 (-1))) {
+		return false;
+	}
+
+	double const * lut_in = tables.lut_in.get ();
+	double const * m = tables.matrix;
+
+	__m256d const x = _mm256_i32gather_pd (lut_in, cx, 8);
+	__m256d const y = _mm256_i32gather_pd (lut_in, cy, 8);
+	__m256d const z = _mm256_i32gather_pd (lut_in, cz, 8);
+
+	__m256d const zero = _mm256_setzero_pd ();
+	__m256d const one = _mm256_set1_pd (1);
+	__m256d const scale = _mm256_set1_pd (65535);
+
+	__m256d const dr = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (x, _mm256_set1_pd (m[0])), _mm256_mul_pd (y, _mm256_set1_pd (m[1]))), _mm256_mul_pd (z, _mm256_set1_pd (m[2])));
+	__m256d const dg = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (x, _mm256_set1_pd (m[3])), _mm256_mul_pd (y, _mm256_set1_pd (m[4]))), _mm256_mul_pd (z, _mm256_set1_pd (m[5])));
+	__m256d const db = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (x, _mm256_set1_pd (m[6])), _mm256_mul_pd (y, _mm256_set1_pd (m[7]))), _mm256_mul_pd (z, _mm256_set1_pd (m[8])));
+
+	__m128i const ir = _mm256_cvtpd_epi32 (_mm256_mul_pd (_mm256_max_pd (_mm256_min_pd (dr, one), zero), scale));
+	__m128i const ig = _mm256_cvtpd_epi32 (_mm256_mul_pd (_mm256_max_pd (_mm256_min_pd (dg, one), zero), scale));
+	__m128i const ib = _mm256_cvtpd_epi32 (_mm256_mul_pd (_mm256_max_pd (_mm256_min_pd (db, one), zero), scale));
+
+	/* The out LUT is 16-bit so gather 32 bits at a 2-byte scale and mask */
+	int const * lut_out = reinterpret_cast<int const *> (tables.lut_out.get ());
+	__m128i const low16 = _mm_set1_epi32 (0xffff);
+	r = _mm_and_si128 (_mm_i32gather_epi32 (lut_out, ir, 2), low16);
+	g = _mm_and_si128 (_mm_i32gather_epi32 (lut_out, ig, 2), low16);
+	b = _mm_and_si128 (_mm_i32gather_epi32 (lut_out, ib, 2), low16);
+
+	return true;
+}
+
+__attribute__((target("sse4.1")))
+static void
+xyz_to_rgb_pixels_sse41 (
+	XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int n, uint16_t* rgb, optional<NoteHandler> const & note
+	)
+{
+	int i = 0;
+	for (; i + 2 <= n; i += 2) {
+		int r[2], g[2], b[2];
+		if (xyz_to_rgb_2_sse41 (tables, xyz_x, xyz_y, xyz_z, r, g, b)) {
+			for (int j = 0; j < 2; ++j) {
+				*rgb++ = r[j];
+				*rgb++ = g[j];
+				*rgb++ = b[j];
+			}
+		} else {
+			xyz_to_rgb_pixels_scalar (tables, xyz_x, xyz_y, xyz_z, 2, rgb, note);
+			rgb += 6;
+		}
+		xyz_x += 2;
+		xyz_y += 2;
+		xyz_z += 2;
+	}
+
+	xyz_to_rgb_pixels_scalar (tables, xyz_x, xyz_y, xyz_z, n - i, rgb, note);
+}
+
+__attribute__((target("sse4.1")))
+static bool
+xyz_to_rgba_pixels_sse41 (XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int n, uint8_t* argb)
+{
+	int i = 0;
+	for (; i + 2 <= n; i += 2) {
+		int r[2], g[2], b[2];
+		if (!xyz_to_rgb_2_sse41 (tables, xyz_x, xyz_y, xyz_z, r, g, b)) {
+			return false;
+		}
+		for (int j = 0; j < 2; ++j) {
+			*argb++ = b[j];
+			*argb++ = g[j];
+			*argb++ = r[j];
+			*argb++ = 0xff;
+		}
+		xyz_x += 2;
+		xyz_y += 2;
+		xyz_z += 2;
+	}
+
+	return xyz_to_rgba_pixels_scalar (tables, xyz_x, xyz_y, xyz_z, n - i, argb);
+}
+
+__attribute__((target("avx2")))
+static void
+xyz_to_rgb_pixels_avx2 (
+	XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int n, uint16_t* rgb, optional<NoteHandler> const & note
+	)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i r, g, b;
+		if (xyz_to_rgb_4_avx2 (tables, xyz_x, xyz_y, xyz_z, r, g, b)) {
+			int rs[4], gs[4], bs[4];
+			_mm_storeu_si128 (reinterpret_cast<__m128i*> (rs), r);
+			_mm_storeu_si128 (reinterpret_cast<__m128i*> (gs), g);
+			_mm_storeu_si128 (reinterpret_cast<__m128i*> (bs), b);
+			for (int j = 0; j < 4; ++j) {
+				*rgb++ = rs[j];
+				*rgb++ = gs[j];
+				*rgb++ = bs[j];
+			}
+		} else {
+			xyz_to_rgb_pixels_scalar (tables, xyz_x, xyz_y, xyz_z, 4, rgb, note);
+			rgb += 12;
+		}
+		xyz_x += 4;
+		xyz_y += 4;
+		xyz_z += 4;
+	}
+
+	xyz_to_rgb_pixels_scalar (tables, xyz_x, xyz_y, xyz_z, n - i, rgb, note);
+}
+
+__attribute__((target("avx2")))
+static bool
+xyz_to_rgba_pixels_avx2 (XYZToRGBTables const & tables, int const * xyz_x, int const * xyz_y, int const * xyz_z, int n, uint8_t* argb)
+{
+	__m128i const alpha = _mm_set1_epi32 (0xff000000);
+
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i r, g, b;
+		if (!xyz_to_rgb_4_avx2 (tables, xyz_x, xyz_y, xyz_z, r, g, b)) {
+			return false;
+		}
+		/* Pack into B, G, R, A bytes */
+		__m128i const pixels = _mm_or_si128 (_mm_or_si128 (b, _mm_slli_epi32 (g, 8)), _mm_or_si128 (_mm_slli_epi32 (r, 16), alpha));
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (argb), pixels);
+		argb += 16;
+		xyz_x += 4;
+		xyz_y += 4;
+		xyz_z += 4;
+	}
+
+	return xyz_to_rgba_pixels_scalar (tables, xyz_x, xyz_y, xyz_z, n - i, argb);
+}
+
+#endif
+
+typedef void (*XYZToRGBKernel) (XYZToRGBTables const &, int const *, int const *, int const *, int, uint16_t*, optional<NoteHandler> const &);
+typedef bool (*XYZToRGBAKernel) (XYZToRGBTables const &, int const *, int const *, int const *, int, uint8_t*);
+
+/** @return The fastest xyz_to_rgb kernel that this CPU can run */
+static XYZToRGBKernel
+xyz_to_rgb_kernel ()
+{
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("avx2")) {
+		return &xyz_to_rgb_pixels_avx2;
+	} else if (__builtin_cpu_supports ("sse4.1")) {
+		return &xyz_to_rgb_pixels_sse41;
+	}
+#endif
+	return &xyz_to_rgb_pixels_scalar;
+}
+
+/** @return The fastest xyz_to_rgba kernel that this CPU can run */
+static XYZToRGBAKernel
+xyz_to_rgba_kernel ()
+{
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("avx2")) {
+		return &xyz_to_rgba_pixels_avx2;
+	} else if (__builtin_cpu_supports ("sse4.1")) {
+		return &xyz_to_rgba_pixels_sse41;
+	}
+#endif
+	return &xyz_to_rgba_pixels_scalar;
+}
+
+/** Convert a range of rows of an image from XYZ to 48bpp RGB.
+ *  @param y_start First row to convert.
+ *  @param y_end One past the last row to convert.
+ *  @param note Handler for notes; this is called from the thread running this method.
+ */
+static void
+xyz_to_rgb_rows (
+	XYZToRGBTables const * tables, OpenJPEGImage const * xyz, uint8_t* rgb, int stride, int y_start, int y_end, optional<NoteHandler> note
+	)
+{
+	XYZToRGBKernel kernel = xyz_to_rgb_kernel ();
+	int const width = xyz->size().width;
+
+	for (int y = y_start; y < y_end; ++y) {
+		kernel (
+			*tables,
+			xyz->data(0) + y * width,
+			xyz->data(1) + y * width,
+			xyz->data(2) + y * width,
+			width,
+			reinterpret_cast<uint16_t*> (rgb + y * stride),
+			note
+			);
+	}
+}
+
+/** Convert a range of rows of an image from XYZ to 32bpp BGRA.
+ *  @param y_start First row to convert.
+ *  @param y_end One past the last row to convert.
+ *  @param ok Set to false if an XYZ value was out of range.
+ */
+static void
+xyz_to_rgba_rows (
+	XYZToRGBTables const * tables, OpenJPEGImage const * xyz, uint8_t* argb, int stride, int y_start, int y_end, bool* ok
+	)
+{
+	XYZToRGBAKernel kernel = xyz_to_rgba_kernel ();
+	int const width = xyz->size().width;
+
+	*ok = true;
+	for (int y = y_start; y < y_end && *ok; ++y) {
+		*ok = kernel (
+			*tables,
+			xyz->data(0) + y * width,
+			xyz->data(1) + y * width,
+			xyz->data(2) + y * width,
+			width,
+			argb + y * stride
+			);
+	}
+}
+
+/** Store notes so that they can be passed on later in a predictable order */
+static void
+store_note (list<pair<NoteType, string> >* notes, NoteType type, string note)
+{
+	notes->push_back (make_pair (type, note));
+}
+
 /** Convert an XYZ image to RGBA.
  *  @param xyz_image Image in XYZ.
  *  @param conversion Colour conversion to use.
@@ -71,71 +514,46 @@ dcp::xyz_to_rgba (
 	int stride
 	)
 {
-	int const max_colour = pow (2, 16) - 1;
-
-	struct {
-		double x, y, z;
-	} s;
-
-	struct {
-		double r, g, b;
-	} d;
-
-	int* xyz_x = xyz_image->data (0);
-	int* xyz_y = xyz_image->data (1);
-	int* xyz_z = xyz_image->data (2);
-
-	double const * lut_in = conversion.out()->lut (12, false);
-	double const * lut_out = conversion.in()->lut (16, true);
-	boost::numeric::ublas::matrix<double> const matrix = conversion.xyz_to_rgb ();
-
-	double fast_matrix[9] = {
-		matrix (0, 0), matrix (0, 1), matrix (0, 2),
-		matrix (1, 0), matrix (1, 1), matrix (1, 2),
-		matrix (2, 0), matrix (2, 1), matrix (2, 2)
-	};
+	xyz_to_rgba (xyz_image, conversion, argb, stride, 1);
+}
 
+/** As xyz_to_rgba above, but splitting the image into bands of rows and converting
+ *  each band in a separate thread.
+ *  @param threads Number of threads to use.
+ */
+void
+dcp::xyz_to_rgba (
+	boost::shared_ptr<const OpenJPEGImage> xyz_image,
+	ColourConversion const & conversion,
+	uint8_t* argb,
+	int stride,
+	int threads
+	)
+{
+	XYZToRGBTables const tables (conversion, 8);
 	int const height = xyz_image->size().height;
-	int const width = xyz_image->size().width;
-
-	for (int y = 0; y < height; ++y) {
-		uint8_t* argb_line = argb;
-		for (int x = 0; x < width; ++x) {
-
-			DCP_ASSERT (*xyz_x >= 0 && *xyz_y >= 0 && *xyz_z >= 0 && *xyz_x < 4096 && *xyz_y < 4096 && *xyz_z < 4096);
-
-			/* In gamma LUT */
-			s.x = lut_in[*xyz_x++];
-			s.y = lut_in[*xyz_y++];
-			s.z = lut_in[*xyz_z++];
-
-			/* DCI companding */
-			s.x /= DCI_COEFFICIENT;
-			s.y /= DCI_COEFFICIENT;
-			s.z /= DCI_COEFFICIENT;
-
-			/* XYZ to RGB */
-			d.r = ((s.x * fast_matrix[0]) + (s.y * fast_matrix[1]) + (s.z * fast_matrix[2]));
-			d.g = ((s.x * fast_matrix[3]) + (s.y * fast_matrix[4]) + (s.z * fast_matrix[5]));
-			d.b = ((s.x * fast_matrix[6]) + (s.y * fast_matrix[7]) + (s.z * fast_matrix[8]));
-
-			d.r = min (d.r, 1.0);
-			d.r = max (d.r, 0.0);
-
-			d.g = min (d.g, 1.0);
-			d.g = max (d.g, 0.0);
-
-			d.b = min (d.b, 1.0);
-			d.b = max (d.b, 0.0);
 
-			/* Out gamma LUT */
-			*argb_line++ = lut_out[lrint(d.b * max_colour)] * 0xff;
-			*argb_line++ = lut_out[lrint(d.g * max_colour)] * 0xff;
-			*argb_line++ = lut_out[lrint(d.r * max_colour)] * 0xff;
-			*argb_line++ = 0xff;
+	threads = max (1, min (threads, height));
+	/* vector<bool> is not up to being written from several threads */
+	scoped_array<bool> ok (new bool[threads]);
+
+	if (threads == 1) {
+		xyz_to_rgba_rows (&tables, xyz_image.get(), argb, stride, 0, height, &ok[0]);
+	} else {
+		boost::thread_group group;
+		for (int i = 0; i < threads; ++i) {
+			group.create_thread (
+				boost::bind (
+					&xyz_to_rgba_rows, &tables, xyz_image.get(), argb, stride,
+					height * i / threads, height * (i + 1) / threads, &ok[i]
+					)
+				);
 		}
+		group.join_all ();
+	}
 
-		argb += stride;
+	for (int i = 0; i < threads; ++i) {
+		DCP_ASSERT (ok[i]);
 	}
 }
 
@@ -157,88 +575,55 @@ dcp::xyz_to_rgb (
 	optional<NoteHandler> note
 	)
 {
-	struct {
-		double x, y, z;
-	} s;
-
-	struct {
-		double r, g, b;
-	} d;
-
-	/* These should be 12-bit values from 0-4095 */
-	int* xyz_x = xyz_image->data (0);
-	int* xyz_y = xyz_image->data (1);
-	int* xyz_z = xyz_image->data (2);
-
-	double const * lut_in = conversion.out()->lut (12, false);
-	double const * lut_out = conversion.in()->lut (16, true);
-	boost::numeric::ublas::matrix<double> const matrix = conversion.xyz_to_rgb ();
-
-	double fast_matrix[9] = {
-		matrix (0, 0), matrix (0, 1), matrix (0, 2),
-		matrix (1, 0), matrix (1, 1), matrix (1, 2),
-		matrix (2, 0), matrix (2, 1), matrix (2, 2)
-	};
+	xyz_to_rgb (xyz_image, conversion, rgb, stride, 1, note);
+}
 
+/** As xyz_to_rgb above, but splitting the image into bands of rows and converting
+ *  each band in a separate thread.  Notes are passed to the handler in the same order
+ *  as they would be with a single thread, and always from the calling thread.
+ *  @param threads Number of threads to use.
+ */
+void
+dcp::xyz_to_rgb (
+	shared_ptr<const OpenJPEGImage> xyz_image,
+	ColourConversion const & conversion,
+	uint8_t* rgb,
+	int stride,
+	int threads,
+	optional<NoteHandler> note
+	)
+{
+	XYZToRGBTables const tables (conversion, 16);
 	int const height = xyz_image->size().height;
-	int const width = xyz_image->size().width;
 
-	for (int y = 0; y < height; ++y) {
-		uint16_t* rgb_line = reinterpret_cast<uint16_t*> (rgb + y * stride);
-		for (int x = 0; x < width; ++x) {
+	threads = max (1, min (threads, height));
 
-			int cx = *xyz_x++;
-			int cy = *xyz_y++;
-			int cz = *xyz_z++;
-
-			if (cx < 0 || cx > 4095) {
-				if (note) {
-					note.get() (DCP_NOTE, String::compose ("XYZ value %1 out of range", cx));
-				}
-				cx = max (min (cx, 4095), 0);
-			}
+	if (threads == 1) {
+		xyz_to_rgb_rows (&tables, xyz_image.get(), rgb, stride, 0, height, note);
+		return;
+	}
 
-			if (cy < 0 || cy > 4095) {
-				if (note) {
-					note.get() (DCP_NOTE, String::compose ("XYZ value %1 out of range", cy));
-				}
-				cy = max (min (cy, 4095), 0);
-			}
+	vector<list<pair<NoteType, string> > > notes (threads);
+	boost::thread_group group;
+	for (int i = 0; i < threads; ++i) {
+		optional<NoteHandler> band_note;
+		if (note) {
+			band_note = NoteHandler (boost::bind (&store_note, &notes[i], _1, _2));
+		}
+		group.create_thread (
+			boost::bind (
+				&xyz_to_rgb_rows, &tables, xyz_image.get(), rgb, stride,
+				height * i / threads, height * (i + 1) / threads, band_note
+				)
+			);
+	}
+	group.join_all ();
 
-			if (cz < 0 || cz > 4095) {
-				if (note) {
-					note.get() (DCP_NOTE, String::compose ("XYZ value %1 out of range", cz));
-				}
-				cz = max (min (cz, 4095), 0);
+	if (note) {
+		for (vector<list<pair<NoteType, string> > >::const_iterator i = notes.begin(); i != notes.end(); ++i) {
+			for (list<pair<NoteType, string> >::const_iterator j = i->begin(); j != i->end(); ++j) {
+				note.get() (j->first, j->second);
 			}
-
-			/* In gamma LUT */
-			s.x = lut_in[cx];
-			s.y = lut_in[cy];
-			s.z = lut_in[cz];
-
-			/* DCI companding */
-			s.x /= DCI_COEFFICIENT;
-			s.y /= DCI_COEFFICIENT;
-			s.z /= DCI_COEFFICIENT;
-
-			/* XYZ to RGB */
-			d.r = ((s.x * fast_matrix[0]) + (s.y * fast_matrix[1]) + (s.z * fast_matrix[2]));
-			d.g = ((s.x * fast_matrix[3]) + (s.y * fast_matrix[4]) + (s.z * fast_matrix[5]));
-			d.b = ((s.x * fast_matrix[6]) + (s.y * fast_matrix[7]) + (s.z * fast_matrix[8]));
-
-			d.r = min (d.r, 1.0);
-			d.r = max (d.r, 0.0);
-
-			d.g = min (d.g, 1.0);
-			d.g = max (d.g, 0.0);
-
-			d.b = min (d.b, 1.0);
-			d.b = max (d.b, 0.0);
-
-			*rgb_line++ = lrint(lut_out[lrint(d.r * 65535)] * 65535);
-			*rgb_line++ = lrint(lut_out[lrint(d.g * 65535)] * 65535);
-			*rgb_line++ = lrint(lut_out[lrint(d.b * 65535)] * 65535);
 		}
 	}
 }
@@ -272,6 +657,258 @@ dcp::combined_rgb_to_xyz (ColourConversion const & conversion, double* matrix)
 		* DCI_COEFFICIENT * 65535;
 }
 
+namespace {
+
+/** @class RGBToXYZTables
+ *  @brief Look-up tables and matrix used by the rgb_to_xyz kernels; these are
+ *  made once per image and shared by all the threads converting it.
+ */
+class RGBToXYZTables
+{
+public:
+	explicit RGBToXYZTables (ColourConversion const & conversion)
+		: lut_in (conversion.in()->lut (12, false))
+		/* One extra entry so that a 32-bit gather of the last entry stays inside the array */
+		, lut_out (new uint16_t[65537])
+	{
+		/* This is is the product of the RGB to XYZ matrix, the Bradford transform and the DCI companding */
+		combined_rgb_to_xyz (conversion, matrix);
+
+		/* Fold the conversion to 12-bit into the out gamma LUT */
+		double const * lut_out_double = conversion.out()->lut (16, true);
+		for (int i = 0; i < 65536; ++i) {
+			lut_out[i] = lrint (lut_out_double[i] * 4095);
+		}
+		lut_out[65536] = 0;
+	}
+
+	double const * lut_in;
+	double matrix[9];
+	scoped_array<uint16_t> lut_out;
+};
+
+}
+
+/** Convert some pixels from RGB to XYZ one at a time.
+ *  @param p First RGB sample to convert.
+ *  @param n Number of pixels to convert.
+ *  @return Number of pixels which needed to be clamped.
+ */
+static int
+rgb_to_xyz_pixels_scalar (RGBToXYZTables const & tables, uint16_t const * p, int n, int* xyz_x, int* xyz_y, int* xyz_z)
+{
+	double const * lut_in = tables.lut_in;
+	double const * m = tables.matrix;
+	uint16_t const * lut_out = tables.lut_out.get ();
+
+	int clamped = 0;
+
+	for (int i = 0; i < n; ++i) {
+		/* In gamma LUT (converting 16-bit to 12-bit) */
+		double const r = lut_in[*p++ >> 4];
+		double const g = lut_in[*p++ >> 4];
+		double const b = lut_in[*p++ >> 4];
+
+		/* RGB to XYZ, Bradford transform and DCI companding */
+		double x = r * m[0] + g * m[1] + b * m[2];
+		double y = r * m[3] + g * m[4] + b * m[5];
+		double z = r * m[6] + g * m[7] + b * m[8];
+
+		/* Clamp */
+
+		if (x < 0 || y < 0 || z < 0 || x > 65535 || y > 65535 || z > 65535) {
+			++clamped;
+		}
+
+		x = min (65535.0, max (0.0, x));
+		y = min (65535.0, max (0.0, y));
+		z = min (65535.0, max (0.0, z));
+
+		/* Out gamma LUT */
+		*xyz_x++ = lut_out[lrint(x)];
+		*xyz_y++ = lut_out[lrint(y)];
+		*xyz_z++ = lut_out[lrint(z)];
+	}
+
+	return clamped;
+}
+
+#ifdef LIBDCP_X86_SIMD
+
+/* The SIMD kernels do the same double-precision arithmetic, in the same order, as
+ * rgb_to_xyz_pixels_scalar (and do not allow FMA contraction), so their results are
+ * bit-identical to it.  Rounding uses the current rounding mode, as lrint does.
+ */
+
+/** SSE4.1 version of rgb_to_xyz_pixels_scalar, converting 2 pixels at a time */
+__attribute__((target("sse4.1")))
+static int
+rgb_to_xyz_pixels_sse41 (RGBToXYZTables const & tables, uint16_t const * p, int n, int* xyz_x, int* xyz_y, int* xyz_z)
+{
+	double const * lut_in = tables.lut_in;
+	double const * m = tables.matrix;
+	uint16_t const * lut_out = tables.lut_out.get ();
+
+	__m128d const m0 = _mm_set1_pd (m[0]);
+	__m128d const m1 = _mm_set1_pd (m[1]);
+	__m128d const m2 = _mm_set1_pd (m[2]);
+	__m128d const m3 = _mm_set1_pd (m[3]);
+	__m128d const m4 = _mm_set1_pd (m[4]);
+	__m128d const m5 = _mm_set1_pd (m[5]);
+	__m128d const m6 = _mm_set1_pd (m[6]);
+	__m128d const m7 = _mm_set1_pd (m[7]);
+	__m128d const m8 = _mm_set1_pd (m[8]);
+	__m128d const zero = _mm_setzero_pd ();
+	__m128d const top = _mm_set1_pd (65535);
+
+	int clamped = 0;
+	int i = 0;
+
+	for (; i + 2 <= n; i += 2) {
+		__m128d const r = _mm_setr_pd (lut_in[p[0] >> 4], lut_in[p[3] >> 4]);
+		__m128d const g = _mm_setr_pd (lut_in[p[1] >> 4], lut_in[p[4] >> 4]);
+		__m128d const b = _mm_setr_pd (lut_in[p[2] >> 4], lut_in[p[5] >> 4]);
+		p += 6;
+
+		__m128d x = _mm_add_pd (_mm_add_pd (_mm_mul_pd (r, m0), _mm_mul_pd (g, m1)), _mm_mul_pd (b, m2));
+		__m128d y = _mm_add_pd (_mm_add_pd (_mm_mul_pd (r, m3), _mm_mul_pd (g, m4)), _mm_mul_pd (b, m5));
+		__m128d z = _mm_add_pd (_mm_add_pd (_mm_mul_pd (r, m6), _mm_mul_pd (g, m7)), _mm_mul_pd (b, m8));
+
+		__m128d const out = _mm_or_pd (
+			_mm_or_pd (
+				_mm_or_pd (_mm_cmplt_pd (x, zero), _mm_cmpgt_pd (x, top)),
+				_mm_or_pd (_mm_cmplt_pd (y, zero), _mm_cmpgt_pd (y, top))
+				),
+			_mm_or_pd (_mm_cmplt_pd (z, zero), _mm_cmpgt_pd (z, top))
+			);
+		clamped += __builtin_popcount (_mm_movemask_pd (out));
+
+		__m128i const xi = _mm_cvtpd_epi32 (_mm_min_pd (_mm_max_pd (x, zero), top));
+		__m128i const yi = _mm_cvtpd_epi32 (_mm_min_pd (_mm_max_pd (y, zero), top));
+		__m128i const zi = _mm_cvtpd_epi32 (_mm_min_pd (_mm_max_pd (z, zero), top));
+
+		*xyz_x++ = lut_out[_mm_cvtsi128_si32 (xi)];
+		*xyz_x++ = lut_out[_mm_extract_epi32 (xi, 1)];
+		*xyz_y++ = lut_out[_mm_cvtsi128_si32 (yi)];
+		*xyz_y++ = lut_out[_mm_extract_epi32 (yi, 1)];
+		*xyz_z++ = lut_out[_mm_cvtsi128_si32 (zi)];
+		*xyz_z++ = lut_out[_mm_extract_epi32 (zi, 1)];
+	}
+
+	return clamped + rgb_to_xyz_pixels_scalar (tables, p, n - i, xyz_x, xyz_y, xyz_z);
+}
+
+/** AVX2 version of rgb_to_xyz_pixels_scalar, converting 4 pixels at a time and
+ *  using gathers for the LUT look-ups.
+ */
+__attribute__((target("avx2")))
+static int
+rgb_to_xyz_pixels_avx2 (RGBToXYZTables const & tables, uint16_t const * p, int n, int* xyz_x, int* xyz_y, int* xyz_z)
+{
+	double const * lut_in = tables.lut_in;
+	double const * m = tables.matrix;
+	int const * lut_out = reinterpret_cast<int const *> (tables.lut_out.get ());
+
+	__m256d const m0 = _mm256_set1_pd (m[0]);
+	__m256d const m1 = _mm256_set1_pd (m[1]);
+	__m256d const m2 = _mm256_set1_pd (m[2]);
+	__m256d const m3 = _mm256_set1_pd (m[3]);
+	__m256d const m4 = _mm256_set1_pd (m[4]);
+	__m256d const m5 = _mm256_set1_pd (m[5]);
+	__m256d const m6 = _mm256_set1_pd (m[6]);
+	__m256d const m7 = _mm256_set1_pd (m[7]);
+	__m256d const m8 = _mm256_set1_pd (m[8]);
+	__m256d const zero = _mm256_setzero_pd ();
+	__m256d const top = _mm256_set1_pd (65535);
+	__m128i const low16 = _mm_set1_epi32 (0xffff);
+
+	int clamped = 0;
+	int i = 0;
+
+	for (; i + 4 <= n; i += 4) {
+		/* Deinterleave and make 12-bit indices into the input LUT */
+		__m128i const ri = _mm_setr_epi32 (p[0] >> 4, p[3] >> 4, p[6] >> 4, p[9] >> 4);
+		__m128i const gi = _mm_setr_epi32 (p[1] >> 4, p[4] >> 4, p[7] >> 4, p[10] >> 4);
+		__m128i const bi = _mm_setr_epi32 (p[2] >> 4, p[5] >> 4, p[8] >> 4, p[11] >> 4);
+		p += 12;
+
+		__m256d const r = _mm256_i32gather_pd (lut_in, ri, 8);
+		__m256d const g = _mm256_i32gather_pd (lut_in, gi, 8);
+		__m256d const b = _mm256_i32gather_pd (lut_in, bi, 8);
+
+		__m256d x = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (r, m0), _mm256_mul_pd (g, m1)), _mm256_mul_pd (b, m2));
+		__m256d y = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (r, m3), _mm256_mul_pd (g, m4)), _mm256_mul_pd (b, m5));
+		__m256d z = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (r, m6), _mm256_mul_pd (g, m7)), _mm256_mul_pd (b, m8));
+
+		__m256d const out = _mm256_or_pd (
+			_mm256_or_pd (
+				_mm256_or_pd (_mm256_cmp_pd (x, zero, _CMP_LT_OQ), _mm256_cmp_pd (x, top, _CMP_GT_OQ)),
+				_mm256_or_pd (_mm256_cmp_pd (y, zero, _CMP_LT_OQ), _mm256_cmp_pd (y, top, _CMP_GT_OQ))
+				),
+			_mm256_or_pd (_mm256_cmp_pd (z, zero, _CMP_LT_OQ), _mm256_cmp_pd (z, top, _CMP_GT_OQ))
+			);
+		clamped += __builtin_popcount (_mm256_movemask_pd (out));
+
+		__m128i const xi = _mm256_cvtpd_epi32 (_mm256_min_pd (_mm256_max_pd (x, zero), top));
+		__m128i const yi = _mm256_cvtpd_epi32 (_mm256_min_pd (_mm256_max_pd (y, zero), top));
+		__m128i const zi = _mm256_cvtpd_epi32 (_mm256_min_pd (_mm256_max_pd (z, zero), top));
+
+		/* Out gamma LUT; the LUT is 16-bit so gather 32 bits at a 2-byte scale and mask */
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (xyz_x), _mm_and_si128 (_mm_i32gather_epi32 (lut_out, xi, 2), low16));
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (xyz_y), _mm_and_si128 (_mm_i32gather_epi32 (lut_out, yi, 2), low16));
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (xyz_z), _mm_and_si128 (_mm_i32gather_epi32 (lut_out, zi, 2), low16));
+		xyz_x += 4;
+		xyz_y += 4;
+		xyz_z += 4;
+	}
+
+	return clamped + rgb_to_xyz_pixels_scalar (tables, p, n - i, xyz_x, xyz_y, xyz_z);
+}
+
+#endif
+
+typedef int (*RGBToXYZKernel) (RGBToXYZTables const &, uint16_t const *, int, int*, int*, int*);
+
+/** @return The fastest rgb_to_xyz kernel that this CPU can run */
+static RGBToXYZKernel
+rgb_to_xyz_kernel ()
+{
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("avx2")) {
+		return &rgb_to_xyz_pixels_avx2;
+	} else if (__builtin_cpu_supports ("sse4.1")) {
+		return &rgb_to_xyz_pixels_sse41;
+	}
+#endif
+	return &rgb_to_xyz_pixels_scalar;
+}
+
+/** Convert a range of rows of an image from RGB to XYZ.
+ *  @param y_start First row to convert.
+ *  @param y_end One past the last row to convert.
+ *  @param clamped Filled in with the number of pixels that were clamped.
+ */
+static void
+rgb_to_xyz_rows (
+	RGBToXYZTables const * tables, uint8_t const * rgb, int stride, OpenJPEGImage* xyz, int y_start, int y_end, int* clamped
+	)
+{
+	RGBToXYZKernel kernel = rgb_to_xyz_kernel ();
+	int const width = xyz->size().width;
+
+	*clamped = 0;
+	for (int y = y_start; y < y_end; ++y) {
+		*clamped += kernel (
+			*tables,
+			reinterpret_cast<uint16_t const *> (rgb + y * stride),
+			width,
+			xyz->data(0) + y * width,
+			xyz->data(1) + y * width,
+			xyz->data(2) + y * width
+			);
+	}
+}
+
 /** @param rgb RGB data; packed RGB 16:16:16, 48bpp, 16R, 16G, 16B,
  *  with the 2-byte value for each R/G/B component stored as
  *  little-endian; i.e. AV_PIX_FMT_RGB48LE.
@@ -287,63 +924,56 @@ dcp::rgb_to_xyz (
 	optional<NoteHandler> note
 	)
 {
-	shared_ptr<OpenJPEGImage> xyz (new OpenJPEGImage (size));
-
-	struct {
-		double r, g, b;
-	} s;
-
-	struct {
-		double x, y, z;
-	} d;
-
-	double const * lut_in = conversion.in()->lut (12, false);
-	double const * lut_out = conversion.out()->lut (16, true);
-
-	/* This is is the product of the RGB to XYZ matrix, the Bradford transform and the DCI companding */
-	double fast_matrix[9];
-	combined_rgb_to_xyz (conversion, fast_matrix);
-
-	int clamped = 0;
-	int* xyz_x = xyz->data (0);
-	int* xyz_y = xyz->data (1);
-	int* xyz_z = xyz->data (2);
-	for (int y = 0; y < size.height; ++y) {
-		uint16_t const * p = reinterpret_cast<uint16_t const *> (rgb + y * stride);
-		for (int x = 0; x < size.width; ++x) {
-
-			/* In gamma LUT (converting 16-bit to 12-bit) */
-			s.r = lut_in[*p++ >> 4];
-			s.g = lut_in[*p++ >> 4];
-			s.b = lut_in[*p++ >> 4];
-
-			/* RGB to XYZ, Bradford transform and DCI companding */
-			d.x = s.r * fast_matrix[0] + s.g * fast_matrix[1] + s.b * fast_matrix[2];
-			d.y = s.r * fast_matrix[3] + s.g * fast_matrix[4] + s.b * fast_matrix[5];
-			d.z = s.r * fast_matrix[6] + s.g * fast_matrix[7] + s.b * fast_matrix[8];
-
-			/* Clamp */
-
-			if (d.x < 0 || d.y < 0 || d.z < 0 || d.x > 65535 || d.y > 65535 || d.z > 65535) {
-				++clamped;
-			}
+	return rgb_to_xyz (rgb, size, stride, conversion, 1, note);
+}
 
-			d.x = max (0.0, d.x);
-			d.y = max (0.0, d.y);
-			d.z = max (0.0, d.z);
-			d.x = min (65535.0, d.x);
-			d.y = min (65535.0, d.y);
-			d.z = min (65535.0, d.z);
-
-			/* Out gamma LUT */
-			*xyz_x++ = lrint (lut_out[lrint(d.x)] * 4095);
-			*xyz_y++ = lrint (lut_out[lrint(d.y)] * 4095);
-			*xyz_z++ = lrint (lut_out[lrint(d.z)] * 4095);
+/** As rgb_to_xyz above, but splitting the image into bands of rows and converting
+ *  each band in a separate thread.  The result is the same whatever the number of threads.
+ *  @param rgb RGB data; packed RGB 16:16:16, 48bpp, 16R, 16G, 16B,
+ *  with the 2-byte value for each R/G/B component stored as
+ *  little-endian; i.e. AV_PIX_FMT_RGB48LE.
+ *  @param size size of RGB image in pixels.
+ *  @param size stride of RGB data in pixels.
+ *  @param threads Number of threads to use.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+dcp::rgb_to_xyz (
+	uint8_t const * rgb,
+	dcp::Size size,
+	int stride,
+	ColourConversion const & conversion,
+	int threads,
+	optional<NoteHandler> note
+	)
+{
+	shared_ptr<OpenJPEGImage> xyz (new OpenJPEGImage (size));
+	RGBToXYZTables const tables (conversion);
+
+	threads = max (1, min (threads, size.height));
+	vector<int> clamped (threads);
+
+	if (threads == 1) {
+		rgb_to_xyz_rows (&tables, rgb, stride, xyz.get(), 0, size.height, &clamped[0]);
+	} else {
+		boost::thread_group group;
+		for (int i = 0; i < threads; ++i) {
+			group.create_thread (
+				boost::bind (
+					&rgb_to_xyz_rows, &tables, rgb, stride, xyz.get(),
+					size.height * i / threads, size.height * (i + 1) / threads, &clamped[i]
+					)
+				);
 		}
+		group.join_all ();
+	}
+
+	int total_clamped = 0;
+	for (vector<int>::const_iterator i = clamped.begin(); i != clamped.end(); ++i) {
+		total_clamped += *i;
 	}
 
-	if (clamped && note) {
-		note.get() (DCP_NOTE, String::compose ("%1 XYZ value(s) clamped", clamped));
+	if (total_clamped && note) {
+		note.get() (DCP_NOTE, String::compose ("%1 XYZ value(s) clamped", total_clamped));
 	}
 
 	return xyz;
@@ -49,6 +49,14 @@ extern void xyz_to_rgba (
 	int stride
 	);
 
+extern void xyz_to_rgba (
+	boost::shared_ptr<const OpenJPEGImage>,
+	ColourConversion const & conversion,
+	uint8_t* rgba,
+	int stride,
+	int threads
+	);
+
 extern void xyz_to_rgb (
 	boost::shared_ptr<const OpenJPEGImage>,
 	ColourConversion const & conversion,
@@ -57,11 +65,29 @@ extern void xyz_to_rgb (
 	boost::optional<NoteHandler> note = boost::optional<NoteHandler> ()
 	);
 
+extern void xyz_to_rgb (
+	boost::shared_ptr<const OpenJPEGImage>,
+	ColourConversion const & conversion,
+	uint8_t* rgb,
+	int stride,
+	int threads,
+	boost::optional<NoteHandler> note = boost::optional<NoteHandler> ()
+	);
+
+extern boost::shared_ptr<OpenJPEGImage> rgb_to_xyz (
+	uint8_t const * rgb,
+	dcp::Size size,
+	int stride,
+	ColourConversion const & conversion,
+	boost::optional<NoteHandler> note = boost::optional<NoteHandler> ()
+	);
+
 extern boost::shared_ptr<OpenJPEGImage> rgb_to_xyz (
 	uint8_t const * rgb,
 	dcp::Size size,
 	int stride,
 	ColourConversion const & conversion,
+	int threads,
 	boost::optional<NoteHandler> note = boost::optional<NoteHandler> ()
 	);
 
@@ -441,6 +441,8 @@ SMPTESubtitleAsset::write (boost::filesystem::path p) const
 	writer.Finalize ();
 
 	_file = p;
+	/* Any digest that we had is of what was there before */
+	_hash = optional<string> ();
 }
 
 bool
@@ -41,18 +41,29 @@
 #include "sound_frame.h"
 #include "sound_asset_writer.h"
 #include "sound_asset_reader.h"
+#include "pcm_kernels.h"
 #include "compose.hpp"
 #include "dcp_assert.h"
 #include <asdcp/KM_fileio.h>
 #include <asdcp/AS_DCP.h>
 #include <libxml++/nodes/element.h>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <cmath>
 #include <stdexcept>
 
 using std::string;
 using std::vector;
 using std::list;
+using std::min;
+using std::max;
 using boost::shared_ptr;
+using boost::optional;
 using boost::dynamic_pointer_cast;
 using namespace dcp;
 
@@ -94,6 +105,178 @@ SoundAsset::SoundAsset (Fraction edit_rate, int sampling_rate, int channels, Sta
 
 }
 
+namespace {
+
+/** Differences found in one channel when comparing two sound assets */
+struct ChannelDifference
+{
+	ChannelDifference ()
+		: max (0)
+		, sum_of_squares (0)
+		, first_bad_difference (0)
+	{}
+
+	/** Add the differences from a later set of frames to these */
+	void merge (ChannelDifference const & other)
+	{
+		max = std::max (max, other.max);
+		sum_of_squares += other.sum_of_squares;
+		if (!first_bad_frame && other.first_bad_frame) {
+			first_bad_frame = other.first_bad_frame;
+			first_bad_difference = other.first_bad_difference;
+		}
+	}
+
+	/** biggest difference between samples */
+	int32_t max;
+	double sum_of_squares;
+	/** first frame with a difference bigger than the allowed maximum, if there is one */
+	optional<int64_t> first_bad_frame;
+	/** biggest difference in first_bad_frame */
+	int32_t first_bad_difference;
+};
+
+/** @class PCMComparison
+ *  @brief Comparison of the PCM data in two sound assets, possibly split into several
+ *  ranges of frames which are compared at the same time.
+ */
+class PCMComparison : public boost::noncopyable
+{
+public:
+	PCMComparison (SoundAsset const * a, SoundAsset const * b, int channels, EqualityOptions opt)
+		: _a (a)
+		, _b (b)
+		, _channels (channels)
+		, _opt (opt)
+	{}
+
+	/** A range of frames to compare, and the results of comparing them */
+	struct Range
+	{
+		Range ()
+			: from (0)
+			, to (0)
+			, samples (0)
+		{}
+
+		int64_t from;
+		int64_t to;
+		vector<ChannelDifference> channels;
+		/** number of samples (per channel) that were compared */
+		int64_t samples;
+		/** first frame whose data sizes differ, if there is one */
+		optional<int64_t> size_mismatch;
+		boost::exception_ptr exception;
+
+		/** @return true if any channel had a difference bigger than the allowed maximum */
+		bool bad () const
+		{
+			BOOST_FOREACH (ChannelDifference const & i, channels) {
+				if (i.first_bad_frame) {
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	void compare (Range& range)
+	{
+		range.channels.resize (_channels);
+
+		try {
+			shared_ptr<const SoundAssetReader> reader = _a->start_read ();
+			shared_ptr<const SoundAssetReader> other_reader = _b->start_read ();
+
+			ComparePCM24Kernel kernel = compare_pcm_24_kernel ();
+			vector<int32_t> max (_channels);
+			vector<int64_t> sum_of_squares (_channels);
+
+			for (int64_t i = range.from; i < range.to && !stopped (i); ++i) {
+
+				shared_ptr<const SoundFrame> frame_A = reader->get_frame (i);
+				shared_ptr<const SoundFrame> frame_B = other_reader->get_frame (i);
+
+				if (frame_A->size() != frame_B->size()) {
+					range.size_mismatch = i;
+					stop (i);
+					return;
+				}
+
+				range.samples += frame_A->samples ();
+
+				if (memcmp (frame_A->data(), frame_B->data(), frame_A->size()) == 0) {
+					continue;
+				}
+
+				kernel (frame_A->data(), frame_B->data(), frame_A->samples(), _channels, &max[0], &sum_of_squares[0]);
+
+				bool bad = false;
+				for (int j = 0; j < _channels; ++j) {
+					ChannelDifference& d = range.channels[j];
+					d.max = std::max (d.max, max[j]);
+					d.sum_of_squares += sum_of_squares[j];
+					if (max[j] > _opt.max_audio_sample_error && !d.first_bad_frame) {
+						d.first_bad_frame = i;
+						d.first_bad_difference = max[j];
+						bad = true;
+					}
+				}
+
+				if (bad) {
+					boost::mutex::scoped_lock lm (_mutex);
+					if (!_first_bad_frame || i < _first_bad_frame.get()) {
+						_first_bad_frame = i;
+					}
+					if (!_opt.keep_going) {
+						lm.unlock ();
+						stop (i);
+						return;
+					}
+				}
+			}
+		} catch (...) {
+			range.exception = boost::current_exception ();
+			stop (range.from);
+		}
+	}
+
+	/** @return the first frame found with a difference that is too big, if any */
+	optional<int64_t> first_bad_frame () const
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		return _first_bad_frame;
+	}
+
+private:
+	/** Tell all ranges that they need not compare any frames after frame */
+	void stop (int64_t frame)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (!_stop_after || frame < _stop_after.get()) {
+			_stop_after = frame;
+		}
+	}
+
+	bool stopped (int64_t frame) const
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		return _stop_after && frame > _stop_after.get();
+	}
+
+	SoundAsset const * _a;
+	SoundAsset const * _b;
+	int _channels;
+	EqualityOptions _opt;
+
+	/** mutex to protect _stop_after and _first_bad_frame */
+	mutable boost::mutex _mutex;
+	optional<int64_t> _stop_after;
+	optional<int64_t> _first_bad_frame;
+};
+
+}
+
 bool
 SoundAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt, NoteHandler note) const
 {
@@ -164,42 +347,105 @@ SoundAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt, NoteHand
 	}
 
 	shared_ptr<const SoundAsset> other_sound = dynamic_pointer_cast<const SoundAsset> (other);
+	DCP_ASSERT (other_sound);
 
-	shared_ptr<const SoundAssetReader> reader = start_read ();
-	shared_ptr<const SoundAssetReader> other_reader = other_sound->start_read ();
+	int const threads = max (1, min (opt.threads, int (_intrinsic_duration)));
 
-	for (int i = 0; i < _intrinsic_duration; ++i) {
+	/* Split the frames into one contiguous range per thread */
+	PCMComparison comparison (this, other_sound.get(), _channels, opt);
+	vector<PCMComparison::Range> ranges (threads);
+	for (int i = 0; i < threads; ++i) {
+		ranges[i].from = _intrinsic_duration * i / threads;
+		ranges[i].to = _intrinsic_duration * (i + 1) / threads;
+	}
 
-		shared_ptr<const SoundFrame> frame_A = reader->get_frame (i);
-		shared_ptr<const SoundFrame> frame_B = other_reader->get_frame (i);
+	if (threads == 1) {
+		comparison.compare (ranges.front());
+	} else {
+		boost::thread_group group;
+		for (vector<PCMComparison::Range>::iterator i = ranges.begin(); i != ranges.end(); ++i) {
+			group.create_thread (boost::bind (&PCMComparison::compare, &comparison, boost::ref (*i)));
+		}
+		group.join_all ();
+	}
 
-		if (frame_A->size() != frame_B->size()) {
-			note (DCP_ERROR, String::compose ("sizes of audio data for frame %1 differ", i));
-			return false;
+	/* Merge the results of the ranges in order, stopping where a serial comparison would have stopped
+	   so that a problem in a later range (in particular an exception) does not hide an earlier one.
+	*/
+	vector<ChannelDifference> channels (_channels);
+	optional<int64_t> size_mismatch;
+	int64_t samples = 0;
+	BOOST_FOREACH (PCMComparison::Range const & i, ranges) {
+		if (i.exception) {
+			boost::rethrow_exception (i.exception);
+		}
+		for (int j = 0; j < _channels; ++j) {
+			channels[j].merge (i.channels[j]);
+		}
+		samples += i.samples;
+		if (i.size_mismatch) {
+			size_mismatch = i.size_mismatch;
+			break;
 		}
+		if (!opt.keep_going && i.bad()) {
+			break;
+		}
+	}
 
-		if (memcmp (frame_A->data(), frame_B->data(), frame_A->size()) != 0) {
-			for (int i = 0; i < frame_A->size(); ++i) {
-				int const d = abs (frame_A->data()[i] - frame_B->data()[i]);
-				if (d > opt.max_audio_sample_error) {
-					note (DCP_ERROR, String::compose ("PCM data difference of %1", d));
-					return false;
-				}
-			}
+	optional<int64_t> first_bad_frame = comparison.first_bad_frame ();
+
+	/* If we stopped at a bad frame before reaching the size mismatch a serial comparison
+	   would not have seen the mismatch, so don't report it.
+	*/
+	if (size_mismatch && (opt.keep_going || !first_bad_frame || size_mismatch.get() < first_bad_frame.get())) {
+		note (DCP_ERROR, String::compose ("sizes of audio data for frame %1 differ", size_mismatch.get()));
+		return false;
+	}
+
+	bool result = true;
+
+	for (int i = 0; i < _channels; ++i) {
+		ChannelDifference const & d = channels[i];
+		/* Only summarise if we compared everything */
+		if ((opt.keep_going || !first_bad_frame) && d.max > 0) {
+			note (
+				DCP_NOTE,
+				String::compose (
+					"audio channel %1: maximum sample difference %2, RMS difference %3",
+					i + 1, d.max, sqrt (d.sum_of_squares / samples)
+					)
+				);
+		}
+		/* Without keep_going we only report the channels which went wrong in the first bad frame */
+		if (d.first_bad_frame && (opt.keep_going || d.first_bad_frame == first_bad_frame)) {
+			note (
+				DCP_ERROR,
+				String::compose (
+					"PCM data difference of %1 in channel %2 of frame %3",
+					d.first_bad_difference, i + 1, d.first_bad_frame.get()
+					)
+				);
+			result = false;
 		}
 	}
 
-	return true;
+	return result;
 }
 
+/** Start writing this asset.
+ *  @param file File to write to.
+ *  @param atmos_sync true to write an ATMOS sync track on channel 14.
+ *  @param background true to encrypt and write each edit unit in another thread,
+ *  so that the caller can carry on preparing the next one.
+ */
 shared_ptr<SoundAssetWriter>
-SoundAsset::start_write (boost::filesystem::path file, bool atmos_sync)
+SoundAsset::start_write (boost::filesystem::path file, bool atmos_sync, bool background)
 {
 	if (atmos_sync && _channels < 14) {
 		throw MiscError ("Insufficient channels to write ATMOS sync (there must be at least 14)");
 	}
 
-	return shared_ptr<SoundAssetWriter> (new SoundAssetWriter(this, file, atmos_sync));
+	return shared_ptr<SoundAssetWriter> (new SoundAssetWriter(this, file, atmos_sync, background));
 }
 
 shared_ptr<SoundAssetReader>
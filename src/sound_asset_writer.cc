@@ -38,31 +38,76 @@
 #include "dcp_assert.h"
 #include "compose.hpp"
 #include "crypto_context.h"
+#include "pcm_kernels.h"
 #include <asdcp/AS_DCP.h>
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
 #include <iostream>
+#include <list>
 
 using std::min;
 using std::max;
 using std::cout;
 using std::string;
 using std::vector;
+using std::list;
+using boost::shared_ptr;
 using namespace dcp;
 
 struct SoundAssetWriter::ASDCPState
 {
 	ASDCP::PCM::MXFWriter mxf_writer;
-	ASDCP::PCM::FrameBuffer frame_buffer;
+	/** buffer that we are currently filling */
+	shared_ptr<ASDCP::PCM::FrameBuffer> frame_buffer;
 	ASDCP::WriterInfo writer_info;
 	ASDCP::PCM::AudioDescriptor desc;
+
+	/* Things used when writing in the background; all but the thread are protected by mutex */
+	boost::mutex mutex;
+	/** signalled when a buffer has been added to pending or free_buffers, or the thread should finish */
+	boost::condition changed;
+	/** full buffers waiting to be written */
+	list<shared_ptr<ASDCP::PCM::FrameBuffer> > pending;
+	/** buffers that can be filled */
+	list<shared_ptr<ASDCP::PCM::FrameBuffer> > free_buffers;
+	bool finish;
+	/** exception thrown by the thread, if any */
+	boost::exception_ptr exception;
+	boost::thread thread;
 };
 
-SoundAssetWriter::SoundAssetWriter (SoundAsset* asset, boost::filesystem::path file, bool sync)
+/** Number of frame buffers to use when writing in the background */
+static int const background_buffers = 4;
+
+/** Convert 24-bit samples in int32_t, which may be interleaved, to packed 24-bit.
+ *  @param in_stride Distance between samples in in, in samples.
+ *  @param n Number of samples.
+ *  @param out Where to write the first sample.
+ *  @param stride Distance between samples in out, in bytes.
+ */
+static void
+pack_int_24 (int32_t const * in, int in_stride, int n, uint8_t* out, int stride)
+{
+	for (int i = 0; i < n; ++i) {
+		int32_t const s = *in;
+		out[0] = s & 0xff;
+		out[1] = (s >> 8) & 0xff;
+		out[2] = (s >> 16) & 0xff;
+		in += in_stride;
+		out += stride;
+	}
+}
+
+SoundAssetWriter::SoundAssetWriter (SoundAsset* asset, boost::filesystem::path file, bool sync, bool background)
 	: AssetWriter (asset, file)
 	, _state (new SoundAssetWriter::ASDCPState)
 	, _asset (asset)
 	, _frame_buffer_offset (0)
 	, _sync (sync)
 	, _sync_packet (0)
+	, _background (background)
 {
 	DCP_ASSERT (!_sync || _asset->channels() >= 14);
 	DCP_ASSERT (!_sync || _asset->standard() == SMPTE);
@@ -90,9 +135,15 @@ SoundAssetWriter::SoundAssetWriter (SoundAsset* asset, boost::filesystem::path f
 	*/
 	_state->desc.ContainerDuration = 0;
 
-	_state->frame_buffer.Capacity (ASDCP::PCM::CalcFrameBufferSize (_state->desc));
-	_state->frame_buffer.Size (ASDCP::PCM::CalcFrameBufferSize (_state->desc));
-	memset (_state->frame_buffer.Data(), 0, _state->frame_buffer.Capacity());
+	_state->frame_buffer = make_frame_buffer ();
+	_samples_per_frame = _state->frame_buffer->Capacity() / (3 * _asset->channels());
+
+	_state->finish = false;
+	if (_background) {
+		for (int i = 1; i < background_buffers; ++i) {
+			_state->free_buffers.push_back (make_frame_buffer ());
+		}
+	}
 
 	_asset->fill_writer_info (&_state->writer_info, _asset->id());
 
@@ -101,68 +152,156 @@ SoundAssetWriter::SoundAssetWriter (SoundAsset* asset, boost::filesystem::path f
 	}
 }
 
+SoundAssetWriter::~SoundAssetWriter ()
+{
+	try {
+		stop_thread ();
+	} catch (...) {
+		/* Errors will already have been reported by write() or finalize(), if they were called */
+	}
+}
+
+shared_ptr<ASDCP::PCM::FrameBuffer>
+SoundAssetWriter::make_frame_buffer () const
+{
+	shared_ptr<ASDCP::PCM::FrameBuffer> buffer (new ASDCP::PCM::FrameBuffer);
+	buffer->Capacity (ASDCP::PCM::CalcFrameBufferSize (_state->desc));
+	buffer->Size (ASDCP::PCM::CalcFrameBufferSize (_state->desc));
+	memset (buffer->Data(), 0, buffer->Capacity());
+	return buffer;
+}
+
+void
+SoundAssetWriter::start ()
+{
+	if (_started) {
+		return;
+	}
+
+	Kumu::Result_t r = _state->mxf_writer.OpenWrite (_file.string().c_str(), _state->writer_info, _state->desc);
+	if (ASDCP_FAILURE (r)) {
+		boost::throw_exception (FileError ("could not open audio MXF for writing", _file.string(), r));
+	}
+
+	_asset->set_file (_file);
+	_started = true;
+
+	if (_background) {
+		_state->thread = boost::thread (boost::bind (&SoundAssetWriter::thread, this));
+	}
+}
+
+/** Write some samples for each channel.
+ *  @param data Pointer to an array of pointers, one per channel, to float samples,
+ *  which should be between -1 and 1.
+ *  @param frames Number of samples to write for each channel.
+ */
 void
 SoundAssetWriter::write (float const * const * data, int frames)
 {
 	DCP_ASSERT (!_finalized);
 	DCP_ASSERT (frames > 0);
 
-	static float const clip = 1.0f - (1.0f / pow (2, 23));
+	start ();
 
-	if (!_started) {
-		Kumu::Result_t r = _state->mxf_writer.OpenWrite (_file.string().c_str(), _state->writer_info, _state->desc);
-		if (ASDCP_FAILURE (r)) {
-			boost::throw_exception (FileError ("could not open audio MXF for writing", _file.string(), r));
+	int const ch = _asset->channels ();
+	PackFloat24Kernel pack = pack_float_24_kernel ();
+	vector<float const *> in (ch);
+
+	int done = 0;
+	while (done < frames) {
+		/* Fill as much of the current edit unit as we can */
+		int const n = min (frames - done, _samples_per_frame - _frame_buffer_offset / (3 * ch));
+		byte_t* out = _state->frame_buffer->Data() + _frame_buffer_offset;
+		for (int j = 0; j < ch; ++j) {
+			/* The sync channel is packed as silence and then overwritten */
+			in[j] = (j == 13 && _sync) ? 0 : data[j] + done;
 		}
-
-		_asset->set_file (_file);
-		_started = true;
+		pack (&in[0], ch, n, out);
+		if (_sync) {
+			write_sync (out + 13 * 3, n);
+		}
+		done += n;
+		advance (n);
 	}
+}
 
-	int const ch = _asset->channels ();
+/** Write some samples.
+ *  @param data Interleaved samples (one per channel, then the next one per channel, and so on)
+ *  as 24-bit values in the low bits of each int32_t.
+ *  @param frames Number of samples to write for each channel.
+ */
+void
+SoundAssetWriter::write (int32_t const * data, int frames)
+{
+	DCP_ASSERT (!_finalized);
+	DCP_ASSERT (frames > 0);
 
-	for (int i = 0; i < frames; ++i) {
+	start ();
 
-		byte_t* out = _state->frame_buffer.Data() + _frame_buffer_offset;
+	int const ch = _asset->channels ();
 
-		/* Write one sample per channel */
+	int done = 0;
+	while (done < frames) {
+		int const n = min (frames - done, _samples_per_frame - _frame_buffer_offset / (3 * ch));
+		byte_t* out = _state->frame_buffer->Data() + _frame_buffer_offset;
 		for (int j = 0; j < ch; ++j) {
-			int32_t s = 0;
 			if (j == 13 && _sync) {
-				s = _fsk.get();
+				write_sync (out + j * 3, n);
 			} else {
-				/* Convert sample to 24-bit int, clipping if necessary. */
-				float x = data[j][i];
-				if (x > clip) {
-					x = clip;
-				} else if (x < -clip) {
-					x = -clip;
-				}
-				s = x * (1 << 23);
+				pack_int_24 (data + done * ch + j, ch, n, out + j * 3, 3 * ch);
 			}
-			*out++ = (s & 0xff);
-			*out++ = (s & 0xff00) >> 8;
-			*out++ = (s & 0xff0000) >> 16;
 		}
-		_frame_buffer_offset += 3 * ch;
+		done += n;
+		advance (n);
+	}
+}
 
-		DCP_ASSERT (_frame_buffer_offset <= int (_state->frame_buffer.Capacity()));
+/** Write n samples of sync signal, with each sample 3 * channels bytes after the last */
+void
+SoundAssetWriter::write_sync (uint8_t* out, int n)
+{
+	int const stride = 3 * _asset->channels();
+	for (int i = 0; i < n; ++i) {
+		int32_t const s = _fsk.get ();
+		out[0] = s & 0xff;
+		out[1] = (s >> 8) & 0xff;
+		out[2] = (s >> 16) & 0xff;
+		out += stride;
+	}
+}
 
-		/* Finish the MXF frame if required */
-		if (_frame_buffer_offset == int (_state->frame_buffer.Capacity())) {
-			write_current_frame ();
-			_frame_buffer_offset = 0;
-			memset (_state->frame_buffer.Data(), 0, _state->frame_buffer.Capacity());
-		}
+/** Move on by n samples in the current edit unit, writing it if it is full */
+void
+SoundAssetWriter::advance (int n)
+{
+	_frame_buffer_offset += 3 * _asset->channels() * n;
+
+	DCP_ASSERT (_frame_buffer_offset <= int (_state->frame_buffer->Capacity()));
+
+	if (_frame_buffer_offset == int (_state->frame_buffer->Capacity())) {
+		write_current_frame ();
+		_frame_buffer_offset = 0;
 	}
 }
 
 void
 SoundAssetWriter::write_current_frame ()
 {
-	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (_state->frame_buffer, _crypto_context->context(), _crypto_context->hmac());
-	if (ASDCP_FAILURE (r)) {
-		boost::throw_exception (MiscError (String::compose ("could not write audio MXF frame (%1)", int (r))));
+	if (_background) {
+		boost::mutex::scoped_lock lm (_state->mutex);
+		while (_state->free_buffers.empty() && !_state->exception) {
+			_state->changed.wait (lm);
+		}
+		if (_state->exception) {
+			boost::rethrow_exception (_state->exception);
+		}
+		_state->pending.push_back (_state->frame_buffer);
+		_state->frame_buffer = _state->free_buffers.front ();
+		_state->free_buffers.pop_front ();
+		_state->changed.notify_all ();
+	} else {
+		write_frame_buffer (*_state->frame_buffer.get());
 	}
 
 	++_frames_written;
@@ -173,18 +312,88 @@ SoundAssetWriter::write_current_frame ()
 	}
 }
 
+void
+SoundAssetWriter::write_frame_buffer (ASDCP::PCM::FrameBuffer const & buffer)
+{
+	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (buffer, _crypto_context->context(), _crypto_context->hmac());
+	if (ASDCP_FAILURE (r)) {
+		boost::throw_exception (MiscError (String::compose ("could not write audio MXF frame (%1)", int (r))));
+	}
+}
+
+/** Thread to encrypt and write full edit units when we are writing in the background */
+void
+SoundAssetWriter::thread ()
+try
+{
+	while (true) {
+		shared_ptr<ASDCP::PCM::FrameBuffer> buffer;
+		{
+			boost::mutex::scoped_lock lm (_state->mutex);
+			while (_state->pending.empty() && !_state->finish) {
+				_state->changed.wait (lm);
+			}
+			if (_state->pending.empty()) {
+				return;
+			}
+			buffer = _state->pending.front ();
+			_state->pending.pop_front ();
+		}
+
+		write_frame_buffer (*buffer.get());
+
+		boost::mutex::scoped_lock lm (_state->mutex);
+		_state->free_buffers.push_back (buffer);
+		_state->changed.notify_all ();
+	}
+}
+catch (...)
+{
+	boost::mutex::scoped_lock lm (_state->mutex);
+	_state->exception = boost::current_exception ();
+	_state->changed.notify_all ();
+}
+
+/** Wait for the background thread, if there is one, to write everything that it has been
+ *  given and then finish, re-throwing any exception that it threw.
+ */
+void
+SoundAssetWriter::stop_thread ()
+{
+	if (!_state->thread.joinable()) {
+		return;
+	}
+
+	{
+		boost::mutex::scoped_lock lm (_state->mutex);
+		_state->finish = true;
+		_state->changed.notify_all ();
+	}
+
+	_state->thread.join ();
+
+	if (_state->exception) {
+		boost::rethrow_exception (_state->exception);
+	}
+}
+
 bool
 SoundAssetWriter::finalize ()
 {
 	if (_frame_buffer_offset > 0) {
+		/* Pad the last edit unit with silence */
+		memset (_state->frame_buffer->Data() + _frame_buffer_offset, 0, _state->frame_buffer->Capacity() - _frame_buffer_offset);
 		write_current_frame ();
 	}
 
+	stop_thread ();
+
 	if (_started) {
 		ASDCP::Result_t const r = _state->mxf_writer.Finalize();
 		if (ASDCP_FAILURE(r)) {
 			boost::throw_exception (MiscError (String::compose ("could not finalise audio MXF (%1)", int(r))));
 		}
+		finalize_hash (_asset);
 	}
 
 	_asset->_intrinsic_duration = _frames_written;
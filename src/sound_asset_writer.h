@@ -57,22 +57,36 @@ class SoundAsset;
  *  Objects of this class can only be created with SoundAsset::start_write().
  *
  *  Sound samples can be written to the SoundAsset by calling write() with
- *  a buffer of float values.  finalize() must be called after the last samples
- *  have been written.
+ *  a buffer of float values or of interleaved 24-bit integer values.  finalize()
+ *  must be called after the last samples have been written.
+ *
+ *  If the writer was created to write in the background, full edit units are
+ *  encrypted and written to disk by another thread while the caller fills the
+ *  next ones.
  */
 class SoundAssetWriter : public AssetWriter
 {
 public:
+	~SoundAssetWriter ();
+
 	void write (float const * const *, int);
+	void write (int32_t const *, int);
 	bool finalize ();
 
 private:
 	friend class SoundAsset;
 	friend struct ::sync_test1;
 
-	SoundAssetWriter (SoundAsset *, boost::filesystem::path, bool sync);
+	SoundAssetWriter (SoundAsset *, boost::filesystem::path, bool sync, bool background);
 
+	void start ();
+	void write_sync (uint8_t* out, int n);
+	void advance (int n);
 	void write_current_frame ();
+	void write_frame_buffer (ASDCP::PCM::FrameBuffer const & buffer);
+	boost::shared_ptr<ASDCP::PCM::FrameBuffer> make_frame_buffer () const;
+	void thread ();
+	void stop_thread ();
 	std::vector<bool> create_sync_packets ();
 
 	/* do this with an opaque pointer so we don't have to include
@@ -84,12 +98,16 @@ private:
 
 	SoundAsset* _asset;
 	int _frame_buffer_offset;
+	/** number of samples (per channel) in each edit unit */
+	int _samples_per_frame;
 
 	/** true to ignore any signal passed to write() on channel 14 and instead write a sync track */
 	bool _sync;
 	/** index of the sync packet (0-3) which starts the next edit unit */
 	int _sync_packet;
 	FSK _fsk;
+	/** true to write full edit units to disk in another thread */
+	bool _background;
 };
 
 }
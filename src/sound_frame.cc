@@ -38,14 +38,29 @@
 using std::cout;
 using namespace dcp;
 
-SoundFrame::SoundFrame (ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c)
-	: Frame<ASDCP::PCM::MXFReader, ASDCP::PCM::FrameBuffer> (reader, n, c)
+SoundFrame::SoundFrame (
+	ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c, boost::shared_ptr<ASDCP::PCM::FrameBuffer> buffer
+	)
+	: Frame<ASDCP::PCM::MXFReader, ASDCP::PCM::FrameBuffer> (reader, n, c, buffer)
 {
 	ASDCP::PCM::AudioDescriptor desc;
 	reader->FillAudioDescriptor (desc);
 	_channels = desc.ChannelCount;
 }
 
+/** @return Capacity that buffers for frames from reader need; PCM frames are
+ *  all the same size, so this can be worked out exactly from the descriptor.
+ */
+int
+SoundFrame::buffer_size (ASDCP::PCM::MXFReader* reader)
+{
+	ASDCP::PCM::AudioDescriptor desc;
+	if (ASDCP_FAILURE (reader->FillAudioDescriptor (desc))) {
+		return Kumu::Megabyte;
+	}
+	return ASDCP::PCM::CalcFrameBufferSize (desc);
+}
+
 int32_t
 SoundFrame::get (int channel, int frame) const
 {
@@ -46,7 +46,12 @@ namespace dcp {
 class SoundFrame : public Frame<ASDCP::PCM::MXFReader, ASDCP::PCM::FrameBuffer>
 {
 public:
-	SoundFrame (ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c);
+	SoundFrame (
+		ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c, boost::shared_ptr<ASDCP::PCM::FrameBuffer> buffer
+		);
+
+	static int buffer_size (ASDCP::PCM::MXFReader* reader);
+
 	int samples () const;
 	int32_t get (int channel, int sample) const;
 
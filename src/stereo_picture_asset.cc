@@ -38,6 +38,7 @@
 #include "stereo_picture_asset_reader.h"
 #include "dcp_assert.h"
 #include <asdcp/AS_DCP.h>
+#include <boost/bind.hpp>
 
 using std::string;
 using std::pair;
@@ -121,47 +122,61 @@ StereoPictureAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt,
 	shared_ptr<const StereoPictureAsset> other_picture = dynamic_pointer_cast<const StereoPictureAsset> (other);
 	DCP_ASSERT (other_picture);
 
-	shared_ptr<const StereoPictureAssetReader> reader = start_read ();
-	shared_ptr<const StereoPictureAssetReader> other_reader = other_picture->start_read ();
+	return frames_equal (
+		other_picture->intrinsic_duration(), opt, note,
+		boost::bind (&StereoPictureAsset::make_comparer, this, other_picture, opt)
+		);
+}
 
-	bool result = true;
+/** @return a FrameComparer with its own readers for this asset and another */
+PictureAsset::FrameComparer
+StereoPictureAsset::make_comparer (shared_ptr<const StereoPictureAsset> other, EqualityOptions opt) const
+{
+	return boost::bind (&StereoPictureAsset::frame_equals, this, start_read(), other->start_read(), _1, opt, _2);
+}
 
-	for (int i = 0; i < _intrinsic_duration; ++i) {
-		shared_ptr<const StereoPictureFrame> frame_A;
-		shared_ptr<const StereoPictureFrame> frame_B;
-		try {
-			frame_A = reader->get_frame (i);
-			frame_B = other_reader->get_frame (i);
-		} catch (ReadError& e) {
-			/* If there was a problem reading the frame data we'll just assume
-			   the two frames are not equal.
-			*/
-			note (DCP_ERROR, e.what ());
-			return false;
-		}
+bool
+StereoPictureAsset::frame_equals (
+	shared_ptr<StereoPictureAssetReader> reader,
+	shared_ptr<StereoPictureAssetReader> other_reader,
+	int frame,
+	EqualityOptions opt,
+	NoteHandler note
+	) const
+{
+	shared_ptr<const StereoPictureFrame> frame_A;
+	shared_ptr<const StereoPictureFrame> frame_B;
+	try {
+		frame_A = reader->get_frame (frame);
+		frame_B = other_reader->get_frame (frame);
+	} catch (ReadError& e) {
+		/* If there was a problem reading the frame data we'll just assume
+		   the two frames are not equal.
+		*/
+		note (DCP_ERROR, e.what ());
+		return false;
+	}
 
-		if (!frame_buffer_equals (
-			    i, opt, note,
-			    frame_A->left_j2k_data(), frame_A->left_j2k_size(),
-			    frame_B->left_j2k_data(), frame_B->left_j2k_size()
-			    )) {
-			result = false;
-			if (!opt.keep_going) {
-				return result;
-			}
-		}
+	bool result = true;
 
-		if (!frame_buffer_equals (
-			    i, opt, note,
-			    frame_A->right_j2k_data(), frame_A->right_j2k_size(),
-			    frame_B->right_j2k_data(), frame_B->right_j2k_size()
-			    )) {
-			result = false;
-			if (!opt.keep_going) {
-				return result;
-			}
+	if (!frame_buffer_equals (
+		    frame, opt, note,
+		    frame_A->left_j2k_data(), frame_A->left_j2k_size(),
+		    frame_B->left_j2k_data(), frame_B->left_j2k_size()
+		    )) {
+		result = false;
+		if (!opt.keep_going) {
+			return result;
 		}
 	}
 
+	if (!frame_buffer_equals (
+		    frame, opt, note,
+		    frame_A->right_j2k_data(), frame_A->right_j2k_size(),
+		    frame_B->right_j2k_data(), frame_B->right_j2k_size()
+		    )) {
+		result = false;
+	}
+
 	return result;
 }
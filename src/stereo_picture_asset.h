@@ -55,6 +55,17 @@ public:
 		EqualityOptions opt,
 		NoteHandler note
 		) const;
+
+private:
+	FrameComparer make_comparer (boost::shared_ptr<const StereoPictureAsset> other, EqualityOptions opt) const;
+
+	bool frame_equals (
+		boost::shared_ptr<StereoPictureAssetReader> reader,
+		boost::shared_ptr<StereoPictureAssetReader> other_reader,
+		int frame,
+		EqualityOptions opt,
+		NoteHandler note
+		) const;
 };
 
 }
@@ -58,6 +58,12 @@ StereoPictureAssetWriter::StereoPictureAssetWriter (PictureAsset* mxf, boost::fi
 
 }
 
+StereoPictureAssetWriter::~StereoPictureAssetWriter ()
+{
+	/* The writer thread uses _state, so it must finish before _state is destroyed */
+	stop_thread ();
+}
+
 void
 StereoPictureAssetWriter::start (uint8_t const * data, int size)
 {
@@ -70,7 +76,7 @@ StereoPictureAssetWriter::start (uint8_t const * data, int size)
  *  @param size Size of data.
  */
 FrameInfo
-StereoPictureAssetWriter::write (uint8_t const * data, int size)
+StereoPictureAssetWriter::do_write (uint8_t const * data, int size)
 {
 	DCP_ASSERT (!_finalized);
 
@@ -78,15 +84,13 @@ StereoPictureAssetWriter::write (uint8_t const * data, int size)
 		start (data, size);
 	}
 
- 	if (ASDCP_FAILURE (_state->j2k_parser.OpenReadFrame (data, size, _state->frame_buffer))) {
- 		boost::throw_exception (MiscError ("could not parse J2K frame"));
- 	}
+	ASDCP::JP2K::FrameBuffer const & frame = prepare_frame (_state, data, size, _crypto_context->context());
 
 	uint64_t const before_offset = _state->mxf_writer.Tell ();
 
 	string hash;
 	Kumu::Result_t r = _state->mxf_writer.WriteFrame (
-		_state->frame_buffer,
+		frame,
 		_next_eye == EYE_LEFT ? ASDCP::JP2K::SP_LEFT : ASDCP::JP2K::SP_RIGHT,
 		_crypto_context->context(),
 		_crypto_context->hmac(),
@@ -107,7 +111,7 @@ StereoPictureAssetWriter::write (uint8_t const * data, int size)
 }
 
 void
-StereoPictureAssetWriter::fake_write (int size)
+StereoPictureAssetWriter::do_fake_write (int size)
 {
 	DCP_ASSERT (_started);
 	DCP_ASSERT (!_finalized);
@@ -126,11 +130,15 @@ StereoPictureAssetWriter::fake_write (int size)
 bool
 StereoPictureAssetWriter::finalize ()
 {
+	flush ();
+	stop_thread ();
+
 	if (_started) {
 		Kumu::Result_t r = _state->mxf_writer.Finalize();
 		if (ASDCP_FAILURE (r)) {
 			boost::throw_exception (MXFFileError ("error in finalizing video MXF", _file.string(), r));
 		}
+		finalize_hash (_picture_asset);
 	}
 
 	_picture_asset->_intrinsic_duration = _frames_written;
@@ -46,20 +46,17 @@ namespace dcp {
  *
  *  Objects of this class can only be created with StereoPictureAsset::start_write().
  *
- *  Frames can be written to the StereoPictureAsset by calling write() with a JPEG2000 image
- *  (a verbatim .j2c file).  finalize() must be called after the last frame has been written.
+ *  Frames can be written to the StereoPictureAsset by calling write() or write_async() with a
+ *  JPEG2000 image (a verbatim .j2c file), for the left eye, then the right eye, then the left eye
+ *  and so on.  finalize() must be called after the last frame has been written.
  *  The action of finalize() can't be done in StereoPictureAssetWriter's destructor as it may
  *  throw an exception.
  */
 class StereoPictureAssetWriter : public PictureAssetWriter
 {
 public:
-	/** Write a frame for one eye.  Frames must be written left, then right, then left etc.
-	 *  @param data JPEG2000 data.
-	 *  @param size Size of data.
-	 */
-	FrameInfo write (uint8_t const * data, int size);
-	void fake_write (int size);
+	~StereoPictureAssetWriter ();
+
 	bool finalize ();
 
 private:
@@ -68,6 +65,9 @@ private:
 	StereoPictureAssetWriter (PictureAsset *, boost::filesystem::path file, bool);
 	void start (uint8_t const *, int);
 
+	FrameInfo do_write (uint8_t const *, int);
+	void do_fake_write (int size);
+
 	/* do this with an opaque pointer so we don't have to include
 	   ASDCP headers
 	*/
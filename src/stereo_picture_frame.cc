@@ -49,25 +49,30 @@ using namespace dcp;
 /** Make a picture frame from a 3D (stereoscopic) asset.
  *  @param reader Reader for the MXF file.
  *  @param n Frame within the asset, not taking EntryPoint into account.
+ *  @param buffer Buffer to read into.
  */
-StereoPictureFrame::StereoPictureFrame (ASDCP::JP2K::MXFSReader* reader, int n, shared_ptr<DecryptionContext> c)
+StereoPictureFrame::StereoPictureFrame (
+	ASDCP::JP2K::MXFSReader* reader, int n, shared_ptr<DecryptionContext> c, shared_ptr<ASDCP::JP2K::SFrameBuffer> buffer
+	)
+	: _buffer (buffer)
 {
-	/* XXX: unfortunate guesswork on this buffer size */
-	_buffer = new ASDCP::JP2K::SFrameBuffer (4 * Kumu::Megabyte);
-
 	if (ASDCP_FAILURE (reader->ReadFrame (n, *_buffer, c->context(), c->hmac()))) {
 		boost::throw_exception (ReadError (String::compose ("could not read video frame %1 of %2", n)));
 	}
 }
 
 StereoPictureFrame::StereoPictureFrame ()
+	: _buffer (new ASDCP::JP2K::SFrameBuffer (buffer_size (0)))
 {
-	_buffer = new ASDCP::JP2K::SFrameBuffer (4 * Kumu::Megabyte);
+
 }
 
-StereoPictureFrame::~StereoPictureFrame ()
+/** @return Capacity that each eye's buffer needs for frames read from an asset */
+int
+StereoPictureFrame::buffer_size (ASDCP::JP2K::MXFSReader *)
 {
-	delete _buffer;
+	/* XXX: unfortunate guesswork on this buffer size */
+	return 4 * Kumu::Megabyte;
 }
 
 /** @param eye Eye to return (EYE_LEFT or EYE_RIGHT).
@@ -59,7 +59,8 @@ class StereoPictureFrame : public boost::noncopyable
 {
 public:
 	StereoPictureFrame ();
-	~StereoPictureFrame ();
+
+	typedef ASDCP::JP2K::SFrameBuffer Buffer;
 
 	boost::shared_ptr<OpenJPEGImage> xyz_image (Eye eye, int reduce = 0) const;
 
@@ -77,9 +78,13 @@ private:
 	*/
 	friend class AssetReader<ASDCP::JP2K::MXFSReader, StereoPictureFrame>;
 
-	StereoPictureFrame (ASDCP::JP2K::MXFSReader* reader, int n, boost::shared_ptr<DecryptionContext>);
+	StereoPictureFrame (
+		ASDCP::JP2K::MXFSReader* reader, int n, boost::shared_ptr<DecryptionContext>, boost::shared_ptr<ASDCP::JP2K::SFrameBuffer> buffer
+		);
+
+	static int buffer_size (ASDCP::JP2K::MXFSReader* reader);
 
-	ASDCP::JP2K::SFrameBuffer* _buffer;
+	boost::shared_ptr<ASDCP::JP2K::SFrameBuffer> _buffer;
 };
 
 }
@@ -47,6 +47,7 @@ namespace xmlpp {
 }
 
 struct interop_dcp_font_test;
+struct interop_dcp_font_resolve_test;
 struct smpte_dcp_font_test;
 struct pull_fonts_test1;
 struct pull_fonts_test2;
@@ -111,6 +112,7 @@ public:
 
 protected:
 	friend struct ::interop_dcp_font_test;
+	friend struct ::interop_dcp_font_resolve_test;
 	friend struct ::smpte_dcp_font_test;
 
 	struct ParseState {
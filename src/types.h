@@ -207,13 +207,14 @@ struct EqualityOptions
 		, reel_hashes_can_differ (false)
 		, issue_dates_can_differ (false)
 		, keep_going (false)
+		, threads (1)
 	{}
 
 	/** The maximum allowable mean difference in pixel value between two images */
 	double max_mean_pixel_error;
 	/** The maximum standard deviation of the differences in pixel value between two images */
 	double max_std_dev_pixel_error;
-	/** The maximum difference in audio sample value between two soundtracks */
+	/** The maximum difference in (24-bit) audio sample value between two soundtracks */
 	int max_audio_sample_error;
 	/** true if the &lt;AnnotationText&gt; nodes of CPLs are allowed to differ */
 	bool cpl_annotation_texts_can_differ;
@@ -224,6 +225,8 @@ struct EqualityOptions
 	/** true if IssueDate nodes can differ */
 	bool issue_dates_can_differ;
 	bool keep_going;
+	/** Number of threads to use when comparing picture or sound frames */
+	int threads;
 };
 
 /* I've been unable to make mingw happy with ERROR as a symbol, so
@@ -42,6 +42,7 @@
 #include "openjpeg_image.h"
 #include "dcp_assert.h"
 #include "compose.hpp"
+#include "digest_cache.h"
 #include <openjpeg.h>
 #include <asdcp/KM_util.h>
 #include <asdcp/KM_fileio.h>
@@ -56,9 +57,17 @@
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/bind.hpp>
 #include <stdexcept>
 #include <iostream>
 #include <iomanip>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
 
 using std::string;
 using std::wstring;
@@ -66,6 +75,7 @@ using std::cout;
 using std::min;
 using std::max;
 using std::list;
+using std::vector;
 using std::setw;
 using std::setfill;
 using std::ostream;
@@ -101,44 +111,254 @@ dcp::make_digest (Data data)
 	return Kumu::base64encode (byte_buffer, SHA_DIGEST_LENGTH, digest, 64);
 }
 
+namespace {
+
+/** @class DigestReader
+ *  @brief Reader which gives a file in large blocks, reading ahead in a background
+ *  thread (for files of more than one block) so that reading overlaps with hashing.
+ */
+class DigestReader : public boost::noncopyable
+{
+public:
+	explicit DigestReader (boost::filesystem::path file)
+		: _file (file)
+		, _size (boost::filesystem::file_size (file))
+		, _current (-1)
+		, _eof (false)
+		, _stop (false)
+	{
+		_handle = fopen_boost (file, "rb");
+		if (!_handle) {
+			boost::throw_exception (FileError ("could not open file to compute digest", file, errno));
+		}
+
+		/* Our reads are big enough that stdio's buffer would just add a copy */
+		setvbuf (_handle, 0, _IONBF, 0);
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise (fileno (_handle), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+		int const buffers = _size > block_size ? 3 : 1;
+		for (int i = 0; i < buffers; ++i) {
+			_buffers.push_back (Block ());
+			_buffers.back().data.reset (new uint8_t[block_size]);
+			_free.push_back (i);
+		}
+
+		if (buffers > 1) {
+			_thread = boost::thread (boost::bind (&DigestReader::thread, this));
+		}
+	}
+
+	~DigestReader ()
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			_stop = true;
+		}
+		_space.notify_all ();
+		if (_thread.joinable ()) {
+			_thread.join ();
+		}
+		fclose (_handle);
+	}
+
+	/** @param size Filled in with the number of bytes in the block.
+	 *  @return Next block of the file, valid until the next call, or 0 at the end of the file.
+	 */
+	uint8_t const * next (int& size)
+	{
+		if (!_thread.joinable ()) {
+			/* Small file: just read it here */
+			size = 0;
+			if (_current == -1) {
+				_current = 0;
+				if (!read (_buffers[0])) {
+					boost::throw_exception (FileError ("could not read file to compute digest", _file, _buffers[0].error));
+				}
+				size = _buffers[0].size;
+			}
+			return size ? _buffers[0].data.get() : 0;
+		}
+
+		if (_eof) {
+			size = 0;
+			return 0;
+		}
+
+		boost::mutex::scoped_lock lm (_mutex);
+
+		if (_current != -1) {
+			_free.push_back (_current);
+			_current = -1;
+			_space.notify_all ();
+		}
+
+		while (_full.empty ()) {
+			_ready.wait (lm);
+		}
+
+		_current = _full.front ();
+		_full.pop_front ();
+
+		Block const & block = _buffers[_current];
+		if (block.error) {
+			boost::throw_exception (FileError ("could not read file to compute digest", _file, block.error));
+		}
+
+		size = block.size;
+		if (size == 0) {
+			_eof = true;
+			return 0;
+		}
+		return block.data.get();
+	}
+
+	int64_t size () const {
+		return _size;
+	}
+
+private:
+	struct Block
+	{
+		Block ()
+			: size (0)
+			, error (0)
+		{}
+
+		boost::shared_array<uint8_t> data;
+		int size;
+		int error;
+	};
+
+	/** @return true on success, false on error (with block.error set) */
+	bool read (Block& block)
+	{
+		block.size = fread (block.data.get(), 1, block_size, _handle);
+		block.error = 0;
+		if (block.size < block_size && ferror (_handle)) {
+			block.error = errno ? errno : EIO;
+			return false;
+		}
+		return true;
+	}
+
+	void thread ()
+	{
+		while (true) {
+			int n;
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				while (!_stop && _free.empty ()) {
+					_space.wait (lm);
+				}
+				if (_stop) {
+					return;
+				}
+				n = _free.front ();
+				_free.pop_front ();
+			}
+
+			/* _buffers[n] is ours until we put it in _full */
+			bool const ok = read (_buffers[n]);
+			bool const done = !ok || _buffers[n].size == 0;
+
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				_full.push_back (n);
+			}
+			_ready.notify_all ();
+
+			if (done) {
+				return;
+			}
+		}
+	}
+
+	static int const block_size = 4 * 1024 * 1024;
+
+	boost::filesystem::path _file;
+	int64_t _size;
+	FILE* _handle;
+	std::vector<Block> _buffers;
+	/** index into _buffers of the block that the caller has, or -1 */
+	int _current;
+	/** true if the caller has been given the end of the file */
+	bool _eof;
+
+	/** mutex to protect _free, _full and _stop */
+	boost::mutex _mutex;
+	/** indices of _buffers which are waiting to be filled */
+	std::list<int> _free;
+	/** indices of _buffers which have been filled, in file order */
+	std::list<int> _full;
+	/** signalled when something is added to _full */
+	boost::condition _ready;
+	/** signalled when something is added to _free, or _stop is set */
+	boost::condition _space;
+	bool _stop;
+
+	boost::thread _thread;
+};
+
+}
+
 /** Create a digest for a file.
  *  @param filename File name.
  *  @param progress Optional progress reporting function.  The function will be called
  *  with a progress value between 0 and 1.
+ *  @param observer Optional function which will be given each block of the file as it is
+ *  read, so that callers can look at the file's contents without reading it a second time.
+ *  @param use_cache true to take the digest from the cache given to set_digest_cache, if it
+ *  has one for the file as it is now, rather than reading the file.  The file is always read
+ *  if there is an observer.  Any digest that is calculated is added to the cache.
  *  @return Digest.
  */
 string
-dcp::make_digest (boost::filesystem::path filename, function<void (float)> progress)
+dcp::make_digest (boost::filesystem::path filename, function<void (float)> progress, function<void (uint8_t const *, int)> observer, bool use_cache)
 {
-	Kumu::FileReader reader;
-	Kumu::Result_t r = reader.OpenRead (filename.string().c_str ());
-	if (ASDCP_FAILURE (r)) {
-		boost::throw_exception (FileError ("could not open file to compute digest", filename, r));
+	if (!boost::filesystem::exists (filename)) {
+		boost::throw_exception (FileError ("could not open file to compute digest", filename, ENOENT));
 	}
 
-	SHA_CTX sha;
-	SHA1_Init (&sha);
+	/* Take the cache key before reading, so that if the file changes while we are
+	   reading it we can see that and not cache a digest of a mixture of old and new data.
+	*/
+	shared_ptr<DigestCache> cache = digest_cache ();
+	optional<DigestCache::Key> key;
+	if (cache) {
+		key = DigestCache::key (filename);
+	}
+
+	if (key && use_cache && !observer) {
+		optional<DigestCache::Entry> cached = cache->get (*key);
+		if (cached) {
+			return cached->digest;
+		}
+	}
 
-	int const buffer_size = 65536;
-	Kumu::ByteString read_buffer (buffer_size);
+	DigestReader reader (filename);
 
-	Kumu::fsize_t done = 0;
-	Kumu::fsize_t const size = reader.Size ();
-	while (1) {
-		ui32_t read = 0;
-		Kumu::Result_t r = reader.Read (read_buffer.Data(), read_buffer.Capacity(), &read);
+	SHA_CTX sha;
+	SHA1_Init (&sha);
 
-		if (r == Kumu::RESULT_ENDOFFILE) {
+	int64_t done = 0;
+	while (true) {
+		int size;
+		uint8_t const * block = reader.next (size);
+		if (!block) {
 			break;
-		} else if (ASDCP_FAILURE (r)) {
-			boost::throw_exception (FileError ("could not read file to compute digest", filename, r));
 		}
 
-		SHA1_Update (&sha, read_buffer.Data(), read);
+		SHA1_Update (&sha, block, size);
+
+		if (observer) {
+			observer (block, size);
+		}
 
 		if (progress) {
-			progress (float (done) / size);
-			done += read;
+			progress (float (done) / reader.size ());
+			done += size;
 		}
 	}
 
@@ -146,7 +366,134 @@ dcp::make_digest (boost::filesystem::path filename, function<void (float)> progr
 	SHA1_Final (byte_buffer, &sha);
 
 	char digest[64];
-	return Kumu::base64encode (byte_buffer, SHA_DIGEST_LENGTH, digest, 64);
+	string const result = Kumu::base64encode (byte_buffer, SHA_DIGEST_LENGTH, digest, 64);
+
+	if (key && DigestCache::key (filename) == key) {
+		cache->add (*key, result);
+	}
+
+	return result;
+}
+
+
+namespace {
+
+/** @class DigestPool
+ *  @brief Worker threads for make_digests.
+ */
+class DigestPool : public boost::noncopyable
+{
+public:
+	DigestPool (vector<boost::filesystem::path> const & files, function<void (float)> progress)
+		: _files (files)
+		, _digests (files.size ())
+		, _done (files.size (), 0)
+		, _total (0)
+		, _next (0)
+		, _progress (progress)
+	{
+		BOOST_FOREACH (boost::filesystem::path const & i, files) {
+			boost::system::error_code ec;
+			uintmax_t const size = boost::filesystem::file_size (i, ec);
+			_sizes.push_back (ec ? 0 : size);
+			_total += _sizes.back ();
+		}
+	}
+
+	vector<string> run (int threads)
+	{
+		boost::thread_group group;
+		for (int i = 0; i < min (threads, static_cast<int> (_files.size ())); ++i) {
+			group.create_thread (boost::bind (&DigestPool::thread, this));
+		}
+		group.join_all ();
+
+		if (_exception) {
+			boost::rethrow_exception (_exception);
+		}
+
+		return _digests;
+	}
+
+private:
+	void thread ()
+	{
+		while (true) {
+			size_t n;
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				if (_next >= _files.size () || _exception) {
+					return;
+				}
+				n = _next++;
+			}
+
+			try {
+				string const digest = make_digest (_files[n], boost::bind (&DigestPool::file_progress, this, n, _1));
+				boost::mutex::scoped_lock lm (_mutex);
+				_digests[n] = digest;
+			} catch (...) {
+				boost::mutex::scoped_lock lm (_mutex);
+				if (!_exception) {
+					_exception = boost::current_exception ();
+				}
+			}
+		}
+	}
+
+	void file_progress (size_t n, float p)
+	{
+		if (!_progress) {
+			return;
+		}
+
+		boost::mutex::scoped_lock lm (_mutex);
+		_done[n] = p * _sizes[n];
+		if (_total > 0) {
+			int64_t done = 0;
+			BOOST_FOREACH (int64_t i, _done) {
+				done += i;
+			}
+			_progress (float (done) / _total);
+		}
+	}
+
+	vector<boost::filesystem::path> _files;
+	vector<int64_t> _sizes;
+	/** mutex to protect _digests, _done, _next and _exception, and to serialise calls to _progress */
+	boost::mutex _mutex;
+	vector<string> _digests;
+	/** bytes of each file that have been hashed */
+	vector<int64_t> _done;
+	int64_t _total;
+	size_t _next;
+	boost::exception_ptr _exception;
+	function<void (float)> _progress;
+};
+
+}
+
+/** Create digests for several files, hashing more than one at the same time.
+ *  @param files Files.
+ *  @param threads Number of files to hash at the same time.
+ *  @param progress Optional progress reporting function.  The function will be called
+ *  with a progress value between 0 and 1 (of all the files), from any of the hashing
+ *  threads but never by two at once.
+ *  @return Digest of each file, in the same order as files.
+ */
+vector<string>
+dcp::make_digests (vector<boost::filesystem::path> files, int threads, function<void (float)> progress)
+{
+	if (threads <= 1 || files.size() < 2) {
+		vector<string> digests;
+		BOOST_FOREACH (boost::filesystem::path const & i, files) {
+			digests.push_back (make_digest (i, progress));
+		}
+		return digests;
+	}
+
+	DigestPool pool (files, progress);
+	return pool.run (threads);
 }
 
 /** @param s A string.
@@ -271,11 +618,18 @@ dcp::relative_to_root (boost::filesystem::path root, boost::filesystem::path fil
 bool
 dcp::ids_equal (string a, string b)
 {
-	transform (a.begin(), a.end(), a.begin(), ::tolower);
-	transform (b.begin(), b.end(), b.begin(), ::tolower);
-	trim (a);
-	trim (b);
-	return a == b;
+	return canonical_id (a) == canonical_id (b);
+}
+
+/** @return id in lower case and with any surrounding white space removed, so that
+ *  IDs which ids_equal considers the same give the same string (e.g. for use as a key).
+ */
+string
+dcp::canonical_id (string id)
+{
+	transform (id.begin(), id.end(), id.begin(), ::tolower);
+	trim (id);
+	return id;
 }
 
 string
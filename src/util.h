@@ -46,6 +46,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 #define LIBDCP_UNUSED(x) (void)(x)
@@ -62,10 +63,19 @@ class GammaLUT;
 class OpenJPEGImage;
 
 extern std::string make_uuid ();
-extern std::string make_digest (boost::filesystem::path filename, boost::function<void (float)>);
+extern std::string make_digest (
+	boost::filesystem::path filename,
+	boost::function<void (float)>,
+	boost::function<void (uint8_t const *, int)> observer = boost::function<void (uint8_t const *, int)> (),
+	bool use_cache = true
+	);
 extern std::string make_digest (Data data);
+extern std::vector<std::string> make_digests (
+	std::vector<boost::filesystem::path> files, int threads, boost::function<void (float)> progress = boost::function<void (float)> ()
+	);
 extern bool empty_or_white_space (std::string s);
 extern bool ids_equal (std::string a, std::string b);
+extern std::string canonical_id (std::string id);
 extern std::string remove_urn_uuid (std::string raw);
 extern void init ();
 
@@ -46,6 +46,9 @@
 #include "exceptions.h"
 #include "compose.hpp"
 #include "raw_convert.h"
+#include "util.h"
+#include "digest_cache.h"
+#include <asdcp/AS_DCP.h>
 #include <xercesc/util/PlatformUtils.hpp>
 #include <xercesc/parsers/XercesDOMParser.hpp>
 #include <xercesc/parsers/AbstractDOMParser.hpp>
@@ -64,8 +67,13 @@
 #include <xercesc/dom/DOMErrorHandler.hpp>
 #include <xercesc/framework/LocalFileInputSource.hpp>
 #include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/framework/XMLGrammarPoolImpl.hpp>
+#include <xercesc/validators/common/Grammar.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread.hpp>
 #include <boost/algorithm/string.hpp>
 #include <map>
 #include <list>
@@ -77,6 +85,7 @@ using std::vector;
 using std::string;
 using std::cout;
 using std::map;
+using std::min;
 using std::max;
 using boost::shared_ptr;
 using boost::optional;
@@ -210,11 +219,16 @@ public:
 	InputSource* resolveEntity(XMLCh const *, XMLCh const * system_id)
 	{
 		string system_id_str = xml_ch_to_string (system_id);
-		boost::filesystem::path p = _xsd_dtd_directory;
-		if (_files.find(system_id_str) == _files.end()) {
-			p /= system_id_str;
+		boost::filesystem::path p;
+		/* This may be called from several threads at once, so don't use _files[] */
+		map<string, string>::const_iterator i = _files.find (system_id_str);
+		if (i != _files.end()) {
+			p = _xsd_dtd_directory / i->second;
+		} else if (boost::filesystem::path(system_id_str).is_absolute()) {
+			/* This is already a full path (e.g. of one of the schemas that we are loading) */
+			p = system_id_str;
 		} else {
-			p /= _files[system_id_str];
+			p = _xsd_dtd_directory / system_id_str;
 		}
 		StringToXMLCh ch (p.string());
 		return new LocalFileInputSource(ch.get());
@@ -246,25 +260,106 @@ parse (XercesDOMParser& parser, std::string xml)
 }
 
 
-template <class T>
-void
-validate_xml (T xml, boost::filesystem::path xsd_dtd_directory, list<VerificationNote>& notes)
+namespace {
+
+/** @class XercesLibrary
+ *  @brief Initialises xerces on construction and terminates it on destruction.
+ */
+class XercesLibrary : public boost::noncopyable
+{
+public:
+	XercesLibrary ()
+	{
+		try {
+			XMLPlatformUtils::Initialize ();
+		} catch (XMLException& e) {
+			throw MiscError ("Failed to initialise xerces library");
+		}
+	}
+
+	~XercesLibrary ()
+	{
+		XMLPlatformUtils::Terminate ();
+	}
+};
+
+
+/** @class XSDValidator
+ *  @brief Validates XML against the schemas in an XSD/DTD directory.
+ *
+ *  The schemas are loaded (and fully checked) once into a grammar pool, which is then
+ *  locked so that it can be shared by any number of parsers.  Each thread which calls
+ *  validate() gets its own parser using that pool, so validations can run in parallel.
+ *  There is one XSDValidator per directory for the life of the process; get it with instance().
+ */
+class XSDValidator : public boost::noncopyable
 {
-	try {
-		XMLPlatformUtils::Initialize ();
-	} catch (XMLException& e) {
-		throw MiscError ("Failed to initialise xerces library");
+public:
+	static XSDValidator& instance (boost::filesystem::path xsd_dtd_directory)
+	{
+		static boost::mutex mutex;
+		boost::mutex::scoped_lock lm (mutex);
+
+		/* These are destroyed in the reverse order to their construction, so all the
+		   validators (and hence their xerces objects) go before xerces is terminated.
+		*/
+		static XercesLibrary xerces;
+		static map<boost::filesystem::path, shared_ptr<XSDValidator> > validators;
+
+		map<boost::filesystem::path, shared_ptr<XSDValidator> >::const_iterator i = validators.find (xsd_dtd_directory);
+		if (i != validators.end()) {
+			return *i->second;
+		}
+
+		shared_ptr<XSDValidator> v (new XSDValidator (xsd_dtd_directory));
+		validators[xsd_dtd_directory] = v;
+		return *v;
 	}
 
-	DCPErrorHandler error_handler;
+	~XSDValidator ()
+	{
+		/* Parsers use the pool, so they must go first */
+		_parser.reset ();
+		delete _pool;
+	}
 
-	/* All the xerces objects in this scope must be destroyed before XMLPlatformUtils::Terminate() is called */
+	template <class T>
+	list<XMLValidationError> validate (T xml)
 	{
-		XercesDOMParser parser;
-		parser.setValidationScheme(XercesDOMParser::Val_Always);
-		parser.setDoNamespaces(true);
-		parser.setDoSchema(true);
+		XercesDOMParser* p = _parser.get ();
+		if (!p) {
+			p = new XercesDOMParser (0, XMLPlatformUtils::fgMemoryManager, _pool);
+			setup (*p);
+			p->useCachedGrammarInParse (true);
+			_parser.reset (p);
+		}
+
+		DCPErrorHandler error_handler;
+		p->setErrorHandler (&error_handler);
+
+		try {
+			parse (*p, xml);
+		} catch (XMLException& e) {
+			p->resetDocumentPool ();
+			throw MiscError(xml_ch_to_string(e.getMessage()));
+		} catch (DOMException& e) {
+			p->resetDocumentPool ();
+			throw MiscError(xml_ch_to_string(e.getMessage()));
+		} catch (...) {
+			p->resetDocumentPool ();
+			throw MiscError("Unknown exception from xerces");
+		}
 
+		p->resetDocumentPool ();
+		p->setErrorHandler (0);
+		return error_handler.errors ();
+	}
+
+private:
+	explicit XSDValidator (boost::filesystem::path xsd_dtd_directory)
+		: _resolver (xsd_dtd_directory)
+		, _pool (new XMLGrammarPoolImpl (XMLPlatformUtils::fgMemoryManager))
+	{
 		vector<string> schema;
 		schema.push_back("xmldsig-core-schema.xsd");
 		schema.push_back("SMPTE-429-7-2006-CPL.xsd");
@@ -277,34 +372,57 @@ validate_xml (T xml, boost::filesystem::path xsd_dtd_directory, list<Verificatio
 		schema.push_back("DCSubtitle.v1.mattsson.xsd");
 		schema.push_back("DCDMSubtitle-2010.xsd");
 
-		/* XXX: I'm not especially clear what this is for, but it seems to be necessary */
-		string locations;
-		BOOST_FOREACH (string i, schema) {
-			locations += String::compose("%1 %1 ", i, i);
+		/* Load each schema into the pool; the loading parser can then go */
+		{
+			XercesDOMParser loader (0, XMLPlatformUtils::fgMemoryManager, _pool);
+			setup (loader);
+			loader.cacheGrammarFromParse (true);
+			loader.useCachedGrammarInParse (true);
+
+			DCPErrorHandler error_handler;
+			loader.setErrorHandler (&error_handler);
+
+			BOOST_FOREACH (string i, schema) {
+				boost::filesystem::path const file = xsd_dtd_directory / i;
+				try {
+					/* Give the loader an input source for the file so that it does not go through our resolver */
+					StringToXMLCh ch (file.string());
+					if (!loader.loadGrammar (LocalFileInputSource (ch.get()), Grammar::SchemaGrammarType, true)) {
+						throw MiscError (String::compose ("Could not load schema %1", file.string()));
+					}
+				} catch (XMLException& e) {
+					throw MiscError(xml_ch_to_string(e.getMessage()));
+				}
+			}
 		}
 
-		parser.setExternalSchemaLocation(locations.c_str());
+		/* From now on the grammars are read-only and can be used by many parsers at once */
+		_pool->lockPool ();
+	}
+
+	void setup (XercesDOMParser& parser)
+	{
+		parser.setValidationScheme(XercesDOMParser::Val_Always);
+		parser.setDoNamespaces(true);
+		parser.setDoSchema(true);
 		parser.setValidationSchemaFullChecking(true);
-		parser.setErrorHandler(&error_handler);
+		parser.setEntityResolver(&_resolver);
+	}
 
-		LocalFileResolver resolver (xsd_dtd_directory);
-		parser.setEntityResolver(&resolver);
+	LocalFileResolver _resolver;
+	XMLGrammarPool* _pool;
+	/** parser for each thread that has called validate() */
+	boost::thread_specific_ptr<XercesDOMParser> _parser;
+};
 
-		try {
-			parser.resetDocumentPool();
-			parse(parser, xml);
-		} catch (XMLException& e) {
-			throw MiscError(xml_ch_to_string(e.getMessage()));
-		} catch (DOMException& e) {
-			throw MiscError(xml_ch_to_string(e.getMessage()));
-		} catch (...) {
-			throw MiscError("Unknown exception from xerces");
-		}
-	}
+}
 
-	XMLPlatformUtils::Terminate ();
 
-	BOOST_FOREACH (XMLValidationError i, error_handler.errors()) {
+template <class T>
+void
+validate_xml (T xml, boost::filesystem::path xsd_dtd_directory, list<VerificationNote>& notes)
+{
+	BOOST_FOREACH (XMLValidationError i, XSDValidator::instance(xsd_dtd_directory).validate(xml)) {
 		notes.push_back (
 			VerificationNote(
 				VerificationNote::VERIFY_ERROR,
@@ -318,6 +436,20 @@ validate_xml (T xml, boost::filesystem::path xsd_dtd_directory, list<Verificatio
 }
 
 
+/** Validate an XML file (such as a CPL, PKL, ASSETMAP or Interop subtitle file) against the
+ *  schemas in a directory.  The schemas are only loaded the first time that a directory is used,
+ *  and this may be called from several threads at once.
+ *  @param xml XML file.
+ *  @param xsd_dtd_directory Directory containing the schemas (usually the libdcp xsd directory).
+ *  @param notes List to add any validation errors to.
+ */
+void
+dcp::validate_xml (boost::filesystem::path xml, boost::filesystem::path xsd_dtd_directory, list<VerificationNote>& notes)
+{
+	::validate_xml<boost::filesystem::path> (xml, boost::filesystem::canonical(xsd_dtd_directory), notes);
+}
+
+
 enum VerifyAssetResult {
 	VERIFY_ASSET_RESULT_GOOD,
 	VERIFY_ASSET_RESULT_CPL_PKL_DIFFER,
@@ -326,10 +458,8 @@ enum VerifyAssetResult {
 
 
 static VerifyAssetResult
-verify_asset (shared_ptr<const DCP> dcp, shared_ptr<const ReelMXF> reel_mxf, function<void (float)> progress)
+verify_asset_hash (shared_ptr<const DCP> dcp, shared_ptr<const ReelMXF> reel_mxf, string actual_hash)
 {
-	string const actual_hash = reel_mxf->asset_ref()->hash(progress);
-
 	list<shared_ptr<PKL> > pkls = dcp->pkls();
 	/* We've read this DCP in so it must have at least one PKL */
 	DCP_ASSERT (!pkls.empty());
@@ -359,6 +489,17 @@ verify_asset (shared_ptr<const DCP> dcp, shared_ptr<const ReelMXF> reel_mxf, fun
 }
 
 
+static VerifyAssetResult
+verify_asset (shared_ptr<const DCP> dcp, shared_ptr<const ReelMXF> reel_mxf, function<void (float)> progress, bool strict)
+{
+	/* Don't use Asset::hash here as it caches the hash in the Asset, which may be
+	   shared between reels whose assets are being checked at the same time.
+	*/
+	string const hash = make_digest (*reel_mxf->asset_ref().asset()->file(), progress, function<void (uint8_t const *, int)>(), !strict);
+	return verify_asset_hash (dcp, reel_mxf, hash);
+}
+
+
 enum VerifyPictureAssetResult
 {
 	VERIFY_PICTURE_ASSET_RESULT_GOOD,
@@ -367,16 +508,245 @@ enum VerifyPictureAssetResult
 };
 
 
+/** @class PictureFrameSizeScanner
+ *  @brief Parser for the KLV packets of a JPEG2000 MXF file which finds the size of each
+ *  picture essence element (the two eyes of a 3D frame are separate elements).
+ *
+ *  The file is given to feed () in blocks, in order, so that this can be done while the
+ *  file is being hashed.  Encrypted elements are recognised and their plaintext size is used.
+ */
+class PictureFrameSizeScanner
+{
+public:
+	PictureFrameSizeScanner ()
+		: _state (READING_KEY_AND_LENGTH)
+		, _value_length (0)
+		, _skip (0)
+		, _elements (0)
+		, _biggest (0)
+		, _failed (false)
+	{}
+
+	void feed (uint8_t const * data, int size)
+	{
+		while (size > 0 && !_failed) {
+			if (_skip > 0) {
+				int const n = min (static_cast<int64_t> (size), _skip);
+				data += n;
+				size -= n;
+				_skip -= n;
+				continue;
+			}
+
+			_header.push_back (*data++);
+			--size;
+
+			if (_state == READING_KEY_AND_LENGTH) {
+				if (_header.size() == 4 && memcmp (&_header[0], ul_prefix, 4)) {
+					/* Not the start of a KLV packet; we've lost our place */
+					_failed = true;
+				} else if (_header.size() > key_length) {
+					size_t length_bytes;
+					if (!parse_ber (&_header[key_length], _header.size() - key_length, length_bytes, _value_length)) {
+						continue;
+					}
+					start_value ();
+				}
+			} else if (_header.size() == encrypted_prefix_length) {
+				encrypted_prefix_done ();
+			}
+		}
+	}
+
+	/** @return number of picture essence elements found, or an empty optional if the file could not be parsed */
+	optional<int64_t> elements () const {
+		if (_failed || _state != READING_KEY_AND_LENGTH || _skip != 0 || !_header.empty()) {
+			return optional<int64_t> ();
+		}
+		return _elements;
+	}
+
+	/** @return size of the biggest picture essence element found, in bytes */
+	int64_t biggest () const {
+		return _biggest;
+	}
+
+private:
+	void start_value ()
+	{
+		if (is_picture_essence (&_header[0])) {
+			add_element (_value_length);
+			done_with_value (_value_length);
+		} else if (is_encrypted_essence (&_header[0]) && _value_length >= static_cast<int64_t> (encrypted_prefix_length)) {
+			/* We need to look at the start of the value to see what is inside */
+			_header.clear ();
+			_state = READING_ENCRYPTED_PREFIX;
+		} else {
+			done_with_value (_value_length);
+		}
+	}
+
+	/** Called when we have the first encrypted_prefix_length bytes of an encrypted
+	 *  triplet's value in _header.  This is a set of BER-length-prefixed items:
+	 *  cryptographic context link, plaintext offset, source key, source length,
+	 *  then the encrypted source value.
+	 */
+	void encrypted_prefix_done ()
+	{
+		uint8_t const * p = &_header[0];
+		uint8_t const * const end = p + _header.size();
+		uint8_t const * source_key = 0;
+		int64_t source_length = -1;
+
+		for (int item = 0; item < 4; ++item) {
+			size_t length_bytes;
+			int64_t length;
+			if (!parse_ber (p, end - p, length_bytes, length) || (end - p) < static_cast<int64_t> (length_bytes) + length) {
+				_failed = true;
+				return;
+			}
+			p += length_bytes;
+			if (item == 2 && length == static_cast<int64_t> (key_length)) {
+				source_key = p;
+			} else if (item == 3 && length == 8) {
+				source_length = 0;
+				for (int i = 0; i < 8; ++i) {
+					source_length = (source_length << 8) | p[i];
+				}
+			}
+			p += length;
+		}
+
+		if (source_key && is_picture_essence (source_key)) {
+			if (source_length < 0) {
+				_failed = true;
+				return;
+			}
+			add_element (source_length);
+		}
+
+		done_with_value (_value_length - _header.size());
+	}
+
+	void add_element (int64_t size)
+	{
+		++_elements;
+		_biggest = max (_biggest, size);
+	}
+
+	void done_with_value (int64_t remaining)
+	{
+		_skip = remaining;
+		_header.clear ();
+		_state = READING_KEY_AND_LENGTH;
+	}
+
+	/** Parse a BER length.
+	 *  @param p Data.
+	 *  @param available Number of bytes at p.
+	 *  @param length_bytes Filled in with the number of bytes that the BER length takes up.
+	 *  @param length Filled in with the length.
+	 *  @return true if the length is complete, false if we need more bytes.
+	 */
+	static bool parse_ber (uint8_t const * p, size_t available, size_t& length_bytes, int64_t& length)
+	{
+		if (available < 1) {
+			return false;
+		}
+
+		if ((p[0] & 0x80) == 0) {
+			length_bytes = 1;
+			length = p[0];
+			return true;
+		}
+
+		length_bytes = 1 + (p[0] & 0x7f);
+		if (available < length_bytes) {
+			return false;
+		}
+
+		length = 0;
+		for (size_t i = 1; i < length_bytes; ++i) {
+			length = (length << 8) | p[i];
+		}
+		return true;
+	}
+
+	/** @return true if key is that of a picture element in the MXF generic container */
+	static bool is_picture_essence (uint8_t const * key)
+	{
+		/* Ignore byte 7, the registry version */
+		return memcmp (key, ul_prefix, 7) == 0 && memcmp (key + 8, picture_essence + 8, 5) == 0;
+	}
+
+	/** @return true if key is that of a SMPTE 429-6 encrypted triplet */
+	static bool is_encrypted_essence (uint8_t const * key)
+	{
+		return memcmp (key, encrypted_essence, 7) == 0 && memcmp (key + 8, encrypted_essence + 8, 8) == 0;
+	}
+
+	static uint8_t const ul_prefix[7];
+	static uint8_t const picture_essence[16];
+	static uint8_t const encrypted_essence[16];
+	static size_t const key_length = 16;
+	/** number of bytes at the start of an encrypted triplet's value which we need to see;
+	 *  this is enough for the four items that precede the encrypted data when they have
+	 *  4-byte BER lengths, which is what asdcplib writes.
+	 */
+	static size_t const encrypted_prefix_length = 64;
+
+	enum State {
+		READING_KEY_AND_LENGTH,
+		READING_ENCRYPTED_PREFIX
+	};
+
+	State _state;
+	/** key and length of the current KLV packet or the start of an encrypted value */
+	std::vector<uint8_t> _header;
+	int64_t _value_length;
+	/** number of bytes to skip before the next thing that we are interested in */
+	int64_t _skip;
+	int64_t _elements;
+	int64_t _biggest;
+	bool _failed;
+};
+
+uint8_t const PictureFrameSizeScanner::ul_prefix[7] = { 0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01 };
+/* Generic container picture item, JPEG2000 frame-wrapped (SMPTE 422M) */
+uint8_t const PictureFrameSizeScanner::picture_essence[16] = {
+	0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01, 0x0d, 0x01, 0x03, 0x01, 0x15, 0x01, 0x08, 0x01
+};
+/* Encrypted triplet (SMPTE 429-6) */
+uint8_t const PictureFrameSizeScanner::encrypted_essence[16] = {
+	0x06, 0x0e, 0x2b, 0x34, 0x02, 0x04, 0x01, 0x07, 0x0d, 0x01, 0x03, 0x01, 0x02, 0x7e, 0x01, 0x00
+};
+
+
+static VerifyPictureAssetResult
+picture_frame_size_result (int64_t biggest_frame, Fraction edit_rate)
+{
+	int const max_frame =   rint(250 * 1000000 / (8 * edit_rate.as_float()));
+	int const risky_frame = rint(230 * 1000000 / (8 * edit_rate.as_float()));
+	if (biggest_frame > max_frame) {
+		return VERIFY_PICTURE_ASSET_RESULT_BAD;
+	} else if (biggest_frame > risky_frame) {
+		return VERIFY_PICTURE_ASSET_RESULT_FRAME_NEARLY_TOO_BIG;
+	}
+
+	return VERIFY_PICTURE_ASSET_RESULT_GOOD;
+}
+
+
 int
-biggest_frame_size (shared_ptr<const MonoPictureFrame> frame)
+biggest_frame_size (ASDCP::JP2K::FrameBuffer const & buffer)
 {
-	return frame->j2k_size ();
+	return buffer.Size ();
 }
 
 int
-biggest_frame_size (shared_ptr<const StereoPictureFrame> frame)
+biggest_frame_size (ASDCP::JP2K::SFrameBuffer const & buffer)
 {
-	return max(frame->left_j2k_size(), frame->right_j2k_size());
+	return max(buffer.Left.Size(), buffer.Right.Size());
 }
 
 
@@ -391,22 +761,15 @@ verify_picture_asset_type (shared_ptr<ReelMXF> reel_mxf, function<void (float)>
 
 	int biggest_frame = 0;
 	shared_ptr<R> reader = asset->start_read ();
+	shared_ptr<typename F::Buffer> buffer = reader->make_buffer ();
 	int64_t const duration = asset->intrinsic_duration ();
 	for (int64_t i = 0; i < duration; ++i) {
-		shared_ptr<const F> frame = reader->get_frame (i);
-		biggest_frame = max(biggest_frame, biggest_frame_size(frame));
+		reader->get_frame (i, *buffer);
+		biggest_frame = max(biggest_frame, biggest_frame_size(*buffer));
 		progress (float(i) / duration);
 	}
 
-	static const int max_frame =   rint(250 * 1000000 / (8 * asset->edit_rate().as_float()));
-	static const int risky_frame = rint(230 * 1000000 / (8 * asset->edit_rate().as_float()));
-	if (biggest_frame > max_frame) {
-		return VERIFY_PICTURE_ASSET_RESULT_BAD;
-	} else if (biggest_frame > risky_frame) {
-		return VERIFY_PICTURE_ASSET_RESULT_FRAME_NEARLY_TOO_BIG;
-	}
-
-	return VERIFY_PICTURE_ASSET_RESULT_GOOD;
+	return picture_frame_size_result (biggest_frame, asset->edit_rate());
 }
 
 
@@ -427,14 +790,49 @@ static void
 verify_main_picture_asset (
 	shared_ptr<const DCP> dcp,
 	shared_ptr<const Reel> reel,
+	bool strict,
 	function<void (string, optional<boost::filesystem::path>)> stage,
 	function<void (float)> progress,
 	list<VerificationNote>& notes
 	)
 {
-	boost::filesystem::path const file = *reel->main_picture()->asset()->file();
-	stage ("Checking picture asset hash", file);
-	VerifyAssetResult const r = verify_asset (dcp, reel->main_picture(), progress);
+	shared_ptr<const PictureAsset> asset = reel->main_picture()->asset();
+	boost::filesystem::path const file = *asset->file();
+
+	stage ("Checking picture asset hash and frame sizes", file);
+
+	shared_ptr<DigestCache> cache = digest_cache ();
+	optional<DigestCache::Key> key;
+	if (cache) {
+		key = DigestCache::key (file);
+	}
+
+	string actual_hash;
+	optional<int64_t> biggest_frame;
+
+	/* If the cache knows the digest and frame sizes we need not read the file at all */
+	if (key && !strict) {
+		optional<DigestCache::Entry> cached = cache->get (*key);
+		if (cached && cached->biggest_picture_frame) {
+			actual_hash = cached->digest;
+			biggest_frame = cached->biggest_picture_frame;
+		}
+	}
+
+	if (!biggest_frame) {
+		/* Read the file once, hashing it and finding the frame sizes at the same time */
+		PictureFrameSizeScanner scanner;
+		actual_hash = make_digest (file, progress, boost::bind (&PictureFrameSizeScanner::feed, &scanner, _1, _2));
+		int64_t const elements_per_frame = dynamic_pointer_cast<const StereoPictureAsset>(asset) ? 2 : 1;
+		if (scanner.elements() && *scanner.elements() == asset->intrinsic_duration() * elements_per_frame) {
+			biggest_frame = scanner.biggest ();
+			if (key && DigestCache::key (file) == key) {
+				cache->add (*key, actual_hash, biggest_frame);
+			}
+		}
+	}
+
+	VerifyAssetResult const r = verify_asset_hash (dcp, reel->main_picture(), actual_hash);
 	switch (r) {
 		case VERIFY_ASSET_RESULT_BAD:
 			notes.push_back (
@@ -453,8 +851,16 @@ verify_main_picture_asset (
 		default:
 			break;
 	}
-	stage ("Checking picture frame sizes", reel->main_picture()->asset()->file());
-	VerifyPictureAssetResult const pr = verify_picture_asset (reel->main_picture(), progress);
+
+	VerifyPictureAssetResult pr;
+	if (biggest_frame) {
+		pr = picture_frame_size_result (*biggest_frame, asset->edit_rate());
+	} else {
+		/* We couldn't make sense of the MXF, so ask asdcplib to read the frames */
+		stage ("Checking picture frame sizes", file);
+		pr = verify_picture_asset (reel->main_picture(), progress);
+	}
+
 	switch (pr) {
 		case VERIFY_PICTURE_ASSET_RESULT_BAD:
 			notes.push_back (
@@ -480,13 +886,14 @@ static void
 verify_main_sound_asset (
 	shared_ptr<const DCP> dcp,
 	shared_ptr<const Reel> reel,
+	bool strict,
 	function<void (string, optional<boost::filesystem::path>)> stage,
 	function<void (float)> progress,
 	list<VerificationNote>& notes
 	)
 {
 	stage ("Checking sound asset hash", reel->main_sound()->asset()->file());
-	VerifyAssetResult const r = verify_asset (dcp, reel->main_sound(), progress);
+	VerifyAssetResult const r = verify_asset (dcp, reel->main_sound(), progress, strict);
 	switch (r) {
 		case VERIFY_ASSET_RESULT_BAD:
 			notes.push_back (
@@ -525,17 +932,180 @@ verify_main_subtitle_asset (
 }
 
 
+/** @class OrderedNotes
+ *  @brief Verification notes from checks which may run in any order, kept in the order that
+ *  they would have been made in had all the checks been run one after another.
+ */
+class OrderedNotes
+{
+public:
+	OrderedNotes ()
+		: _reserved (true)
+	{}
+
+	/** @return list to add notes to now */
+	list<VerificationNote>& now ()
+	{
+		if (_reserved) {
+			_parts.push_back (list<VerificationNote> ());
+			_reserved = false;
+		}
+		return _parts.back ();
+	}
+
+	/** @return list for a check which will be run later to add its notes to */
+	list<VerificationNote>& reserve ()
+	{
+		_parts.push_back (list<VerificationNote> ());
+		_reserved = true;
+		return _parts.back ();
+	}
+
+	list<VerificationNote> get () const
+	{
+		list<VerificationNote> all;
+		BOOST_FOREACH (list<VerificationNote> const & i, _parts) {
+			all.insert (all.end(), i.begin(), i.end());
+		}
+		return all;
+	}
+
+private:
+	/* This must be a list, as we hand out references to its elements */
+	list<list<VerificationNote> > _parts;
+	bool _reserved;
+};
+
+
+typedef function<void (string, optional<boost::filesystem::path>)> StageFunction;
+typedef function<void (float)> ProgressFunction;
+/** A check of an asset which takes functions to report its stage and progress */
+typedef function<void (StageFunction, ProgressFunction)> AssetCheck;
+
+
+/** @class AssetCheckPool
+ *  @brief Runner for the (slow) checks of MXF assets.
+ *
+ *  With one thread each check is run as soon as it is added.  Otherwise checks
+ *  are kept until run () is called, and then shared out between the threads.  Calls
+ *  to the caller's stage and progress functions are then serialised, and progress
+ *  is reported as the proportion of all checks that has been done.
+ */
+class AssetCheckPool : public boost::noncopyable
+{
+public:
+	AssetCheckPool (int threads, StageFunction stage, ProgressFunction progress)
+		: _threads (threads)
+		, _stage (stage)
+		, _progress (progress)
+		, _next (0)
+	{}
+
+	void add (AssetCheck check)
+	{
+		if (_threads <= 1) {
+			check (_stage, _progress);
+		} else {
+			_checks.push_back (check);
+		}
+	}
+
+	/** Run any checks that have been added, returning when they are finished.  If any
+	 *  check throws an exception the first such exception is re-thrown here.
+	 */
+	void run ()
+	{
+		if (_checks.empty()) {
+			return;
+		}
+
+		_check_progress.assign (_checks.size(), 0);
+
+		boost::thread_group group;
+		for (int i = 0; i < min (_threads, static_cast<int> (_checks.size())); ++i) {
+			group.create_thread (boost::bind (&AssetCheckPool::thread, this));
+		}
+		group.join_all ();
+
+		_checks.clear ();
+
+		if (_exception) {
+			boost::rethrow_exception (_exception);
+		}
+	}
+
+private:
+	void thread ()
+	{
+		while (true) {
+			size_t n;
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				if (_next >= _checks.size() || _exception) {
+					return;
+				}
+				n = _next++;
+			}
+
+			try {
+				_checks[n] (boost::bind (&AssetCheckPool::stage, this, _1, _2), boost::bind (&AssetCheckPool::progress, this, n, _1));
+			} catch (...) {
+				boost::mutex::scoped_lock lm (_mutex);
+				if (!_exception) {
+					_exception = boost::current_exception ();
+				}
+			}
+
+			progress (n, 1);
+		}
+	}
+
+	void stage (string s, optional<boost::filesystem::path> path)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_stage (s, path);
+	}
+
+	void progress (size_t check, float p)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_check_progress[check] = p;
+		float total = 0;
+		BOOST_FOREACH (float i, _check_progress) {
+			total += i;
+		}
+		_progress (total / _check_progress.size());
+	}
+
+	int _threads;
+	StageFunction _stage;
+	ProgressFunction _progress;
+	vector<AssetCheck> _checks;
+
+	/** mutex to protect _check_progress, _next and _exception, and to serialise
+	 *  calls to _stage and _progress
+	 */
+	boost::mutex _mutex;
+	vector<float> _check_progress;
+	size_t _next;
+	boost::exception_ptr _exception;
+};
+
+
 list<VerificationNote>
 dcp::verify (
 	vector<boost::filesystem::path> directories,
 	function<void (string, optional<boost::filesystem::path>)> stage,
 	function<void (float)> progress,
-	boost::filesystem::path xsd_dtd_directory
+	boost::filesystem::path xsd_dtd_directory,
+	int threads,
+	bool strict
 	)
 {
 	xsd_dtd_directory = boost::filesystem::canonical (xsd_dtd_directory);
 
-	list<VerificationNote> notes;
+	OrderedNotes notes;
+	AssetCheckPool asset_checks (threads, stage, progress);
 
 	list<shared_ptr<DCP> > dcps;
 	BOOST_FOREACH (boost::filesystem::path i, directories) {
@@ -545,22 +1115,22 @@ dcp::verify (
 	BOOST_FOREACH (shared_ptr<DCP> dcp, dcps) {
 		stage ("Checking DCP", dcp->directory());
 		try {
-			dcp->read (&notes);
+			dcp->read (&notes.now());
 		} catch (ReadError& e) {
-			notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
+			notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
 		} catch (XMLError& e) {
-			notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
+			notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
 		}
 
 		BOOST_FOREACH (shared_ptr<CPL> cpl, dcp->cpls()) {
 			stage ("Checking CPL", cpl->file());
-			validate_xml (cpl->file().get(), xsd_dtd_directory, notes);
+			validate_xml (cpl->file().get(), xsd_dtd_directory, notes.now());
 
 			/* Check that the CPL's hash corresponds to the PKL */
 			BOOST_FOREACH (shared_ptr<PKL> i, dcp->pkls()) {
 				optional<string> h = i->hash(cpl->id());
 				if (h && make_digest(Data(*cpl->file())) != *h) {
-					notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::CPL_HASH_INCORRECT));
+					notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::CPL_HASH_INCORRECT));
 				}
 			}
 
@@ -569,10 +1139,10 @@ dcp::verify (
 
 				BOOST_FOREACH (shared_ptr<ReelAsset> i, reel->assets()) {
 					if (i->duration() && (i->duration().get() * i->edit_rate().denominator / i->edit_rate().numerator) < 1) {
-						notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::DURATION_TOO_SMALL, i->id()));
+						notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::DURATION_TOO_SMALL, i->id()));
 					}
 					if ((i->intrinsic_duration() * i->edit_rate().denominator / i->edit_rate().numerator) < 1) {
-						notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::INTRINSIC_DURATION_TOO_SMALL, i->id()));
+						notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::INTRINSIC_DURATION_TOO_SMALL, i->id()));
 					}
 				}
 
@@ -587,38 +1157,40 @@ dcp::verify (
 					     frame_rate.numerator != 50 &&
 					     frame_rate.numerator != 60 &&
 					     frame_rate.numerator != 96)) {
-						notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::INVALID_PICTURE_FRAME_RATE));
+						notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::INVALID_PICTURE_FRAME_RATE));
 					}
 					/* Check asset */
 					if (reel->main_picture()->asset_ref().resolved()) {
-						verify_main_picture_asset (dcp, reel, stage, progress, notes);
+						asset_checks.add (boost::bind (&verify_main_picture_asset, dcp, reel, strict, _1, _2, boost::ref (notes.reserve ())));
 					}
 				}
 
 				if (reel->main_sound() && reel->main_sound()->asset_ref().resolved()) {
-					verify_main_sound_asset (dcp, reel, stage, progress, notes);
+					asset_checks.add (boost::bind (&verify_main_sound_asset, dcp, reel, strict, _1, _2, boost::ref (notes.reserve ())));
 				}
 
 				if (reel->main_subtitle() && reel->main_subtitle()->asset_ref().resolved()) {
-					verify_main_subtitle_asset (reel, stage, xsd_dtd_directory, notes);
+					verify_main_subtitle_asset (reel, stage, xsd_dtd_directory, notes.now());
 				}
 			}
 		}
 
 		BOOST_FOREACH (shared_ptr<PKL> pkl, dcp->pkls()) {
 			stage ("Checking PKL", pkl->file());
-			validate_xml (pkl->file().get(), xsd_dtd_directory, notes);
+			validate_xml (pkl->file().get(), xsd_dtd_directory, notes.now());
 		}
 
 		if (dcp->asset_map_path()) {
 			stage ("Checking ASSETMAP", dcp->asset_map_path().get());
-			validate_xml (dcp->asset_map_path().get(), xsd_dtd_directory, notes);
+			validate_xml (dcp->asset_map_path().get(), xsd_dtd_directory, notes.now());
 		} else {
-			notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::MISSING_ASSETMAP));
+			notes.now().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::MISSING_ASSETMAP));
 		}
 	}
 
-	return notes;
+	asset_checks.run ();
+
+	return notes.get ();
 }
 
 string
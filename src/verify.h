@@ -154,13 +154,30 @@ private:
 	uint64_t _line;
 };
 
+/** Verify some DCPs.
+ *  @param directories DCP directories.
+ *  @param stage Function to be told each stage of verification as it starts.
+ *  @param progress Function to be told the progress of the current stage(s).
+ *  @param xsd_dtd_directory Directory containing XSDs and DTDs to validate XML against.
+ *  @param threads Number of picture and sound assets to check at the same time.  With more
+ *  than one, these checks are done after everything else and the calls to stage and progress
+ *  for them come from other threads (though never two at once).  The notes that are returned
+ *  are in the same order whatever the number of threads.
+ *  @param strict true to read every asset to check its hash (and picture frame sizes), even if
+ *  the cache given to set_digest_cache already has them for the asset's file.
+ *  @return Notes about any problems that were found.
+ */
 std::list<VerificationNote> verify (
 	std::vector<boost::filesystem::path> directories,
 	boost::function<void (std::string, boost::optional<boost::filesystem::path>)> stage,
 	boost::function<void (float)> progress,
-	boost::filesystem::path xsd_dtd_directory
+	boost::filesystem::path xsd_dtd_directory,
+	int threads = 1,
+	bool strict = false
 	);
 
+void validate_xml (boost::filesystem::path xml, boost::filesystem::path xsd_dtd_directory, std::list<VerificationNote>& notes);
+
 std::string note_to_string (dcp::VerificationNote note);
 
 }
@@ -33,9 +33,21 @@
 
 #include <boost/test/unit_test.hpp>
 #include "asset.h"
+#include "asset_index.h"
+#include "font_asset.h"
+#include "ref.h"
+#include "cpl.h"
+#include "reel.h"
+#include "lazy_asset.h"
+#include "mono_picture_asset.h"
+#include "sound_asset.h"
+#include "reel_picture_asset.h"
+#include "reel_sound_asset.h"
 
+using std::list;
 using std::string;
 using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
 
 class DummyAsset : public dcp::Asset
 {
@@ -67,3 +79,71 @@ BOOST_AUTO_TEST_CASE (asset_test)
 	b->_file = "foo/bar/baz";
 	BOOST_CHECK (a->equals (b, dcp::EqualityOptions (), boost::bind (&note_handler, _1, _2)));
 }
+
+/** Check that resolving a Ref with an AssetIndex finds the same asset as resolving it with a list */
+BOOST_AUTO_TEST_CASE (asset_index_test)
+{
+	shared_ptr<dcp::FontAsset> a (new dcp::FontAsset ("d36f4bb3-c4fa-4a95-9915-6fec3110cc71", "test/data/dummy.ttf"));
+	shared_ptr<dcp::FontAsset> b (new dcp::FontAsset ("d36f4bb3-c4fa-4a95-9915-6fec3110cc71", "test/data/dummy.ttf"));
+	shared_ptr<dcp::FontAsset> c (new dcp::FontAsset ("59a2d1a7-9a5d-4d6d-8d6a-2e0c1d1e6b3f", "test/data/dummy.ttf"));
+
+	list<shared_ptr<dcp::Asset> > assets;
+	assets.push_back (a);
+	assets.push_back (b);
+	assets.push_back (c);
+	dcp::AssetIndex index (assets);
+
+	dcp::Ref from_list (" D36F4BB3-C4FA-4A95-9915-6FEC3110CC71 ");
+	from_list.resolve (assets);
+	dcp::Ref from_index (" D36F4BB3-C4FA-4A95-9915-6FEC3110CC71 ");
+	from_index.resolve (index);
+	BOOST_REQUIRE (from_list.resolved ());
+	BOOST_REQUIRE (from_index.resolved ());
+	BOOST_CHECK (from_list.asset() == a);
+	BOOST_CHECK (from_index.asset() == a);
+
+	dcp::Ref missing ("b2e3ec4f-5a3c-4b34-9d3e-3a8ad0b7a1c2");
+	missing.resolve (index);
+	BOOST_CHECK (!missing.resolved ());
+
+	BOOST_CHECK (index.find_font ("dummy.ttf") == a);
+	BOOST_CHECK (!index.find_font ("missing.ttf"));
+}
+
+/** Check that Reel::resolve_refs with an AssetIndex gives out the real asset for a LazyAsset,
+ *  and the first asset that was added when an ID is duplicated.
+ */
+BOOST_AUTO_TEST_CASE (reel_resolve_refs_index_test)
+{
+	dcp::CPL cpl ("test/ref/DCP/dcp_test1/cpl_81fb54df-e1bf-4647-8788-ea7ba154375b.xml");
+	BOOST_REQUIRE_EQUAL (cpl.reels().size(), 1);
+	shared_ptr<dcp::Reel> reel = cpl.reels().front ();
+	BOOST_REQUIRE (reel->main_picture ());
+	BOOST_REQUIRE (reel->main_sound ());
+	BOOST_CHECK (!reel->main_picture()->asset_ref().resolved ());
+	BOOST_CHECK (!reel->main_sound()->asset_ref().resolved ());
+
+	shared_ptr<dcp::LazyAsset> picture (
+		new dcp::LazyAsset ("1fab8bb0-cfaf-4225-ad6d-01768bc10470", "test/ref/DCP/dcp_test1/video.mxf", false)
+		);
+	shared_ptr<dcp::SoundAsset> sound_A (new dcp::SoundAsset ("test/ref/DCP/dcp_test1/audio.mxf"));
+	shared_ptr<dcp::SoundAsset> sound_B (new dcp::SoundAsset ("test/ref/DCP/dcp_test1/audio.mxf"));
+	BOOST_REQUIRE_EQUAL (sound_A->id(), sound_B->id());
+
+	dcp::AssetIndex index;
+	index.add (picture);
+	index.add (sound_A);
+	index.add (sound_B);
+	reel->resolve_refs (index);
+
+	BOOST_REQUIRE (reel->main_picture()->asset_ref().resolved ());
+	shared_ptr<dcp::MonoPictureAsset> mono = dynamic_pointer_cast<dcp::MonoPictureAsset> (reel->main_picture()->asset ());
+	BOOST_REQUIRE (mono);
+	BOOST_CHECK_EQUAL (mono->id(), "1fab8bb0-cfaf-4225-ad6d-01768bc10470");
+	/* The LazyAsset only opens the MXF once */
+	BOOST_CHECK (mono == picture->asset ());
+	BOOST_CHECK (reel->main_picture()->asset() == mono);
+
+	BOOST_REQUIRE (reel->main_sound()->asset_ref().resolved ());
+	BOOST_CHECK (reel->main_sound()->asset() == sound_A);
+}
@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "atmos_asset.h"
+#include "atmos_asset_writer.h"
+#include "cpl.h"
+#include "dcp.h"
+#include "file.h"
+#include "mono_picture_asset.h"
+#include "picture_asset_writer.h"
+#include "pkl.h"
+#include "reel.h"
+#include "reel_mono_picture_asset.h"
+#include "util.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <vector>
+
+using std::vector;
+using boost::shared_ptr;
+
+/** Check that a picture asset writer gives its asset the digest of the file that it wrote,
+ *  and that this digest is the one that goes into the PKL and CPL.
+ */
+BOOST_AUTO_TEST_CASE (picture_asset_writer_hash_test)
+{
+	boost::filesystem::path dir = "build/test/picture_asset_writer_hash_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	shared_ptr<dcp::MonoPictureAsset> asset (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = asset->start_write (dir / "video.mxf", false);
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	for (int i = 0; i < 24; ++i) {
+		writer->write (j2c.data (), j2c.size ());
+	}
+	writer->finalize ();
+
+	std::string const digest = dcp::make_digest (dir / "video.mxf", 0);
+	BOOST_CHECK_EQUAL (asset->hash(), digest);
+
+	shared_ptr<dcp::ReelMonoPictureAsset> reel_asset (new dcp::ReelMonoPictureAsset (asset, 0));
+	BOOST_REQUIRE (reel_asset->hash ());
+	BOOST_CHECK_EQUAL (reel_asset->hash().get(), digest);
+
+	shared_ptr<dcp::Reel> reel (new dcp::Reel ());
+	reel->add (reel_asset);
+	shared_ptr<dcp::CPL> cpl (new dcp::CPL ("A Test DCP", dcp::FEATURE));
+	cpl->add (reel);
+	dcp::DCP dcp (dir);
+	dcp.add (cpl);
+	dcp.write_xml (dcp::SMPTE);
+
+	BOOST_REQUIRE_EQUAL (dcp.pkls().size(), 1U);
+	BOOST_REQUIRE (dcp.pkls().front()->hash (asset->id ()));
+	BOOST_CHECK_EQUAL (dcp.pkls().front()->hash(asset->id()).get(), digest);
+}
+
+/** Check that an Atmos asset writer gives its asset the digest of the file that it wrote */
+BOOST_AUTO_TEST_CASE (atmos_asset_writer_hash_test)
+{
+	boost::filesystem::path dir = "build/test/atmos_asset_writer_hash_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	dcp::AtmosAsset asset (dcp::Fraction (24, 1), 0, 10, 118, 1);
+	shared_ptr<dcp::AtmosAssetWriter> writer = asset.start_write (dir / "atmos.mxf");
+	vector<uint8_t> data (4096);
+	for (int i = 0; i < 48; ++i) {
+		for (size_t j = 0; j < data.size(); ++j) {
+			data[j] = (i + j) & 0xff;
+		}
+		writer->write (&data[0], data.size());
+	}
+	writer->finalize ();
+
+	BOOST_CHECK_EQUAL (asset.hash(), dcp::make_digest (dir / "atmos.mxf", 0));
+}
@@ -37,7 +37,9 @@
 #include "version.h"
 #include "j2k.h"
 #include "openjpeg_image.h"
+#include <boost/thread.hpp>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <iostream>
 #include <cstdio>
 
@@ -76,7 +78,7 @@ private:
 	struct timeval _start;
 };
 
-/** Run some basic benchmarks of JPEG2000 encoding / decoding */
+/** Run some basic benchmarks of JPEG2000 encoding / decoding with different numbers of threads */
 int
 main (int argc, char* argv[])
 {
@@ -90,24 +92,36 @@ main (int argc, char* argv[])
 
 	dcp::Data j2k (boost::filesystem::path (argv[1]) / "thx.j2c");
 
-	Timer decompress;
-	Timer compress;
+	int const max_threads = std::max (1U, boost::thread::hardware_concurrency ());
 
 	dcp::Data recomp;
-	for (int i = 0; i < count; ++i) {
-		decompress.start ();
-		shared_ptr<dcp::OpenJPEGImage> xyz = dcp::decompress_j2k (j2k, 0);
-		decompress.stop ();
-		compress.start ();
-		recomp = dcp::compress_j2k (xyz, j2k_bandwidth, 24, false, false);
-		compress.stop ();
-		cout << (i + 1) << " ";
-		cout.flush ();
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		dcp::J2KOptions options;
+		options.threads = threads;
+
+		Timer decompress;
+		Timer compress;
+
+		cout << threads << " thread(s): ";
+		for (int i = 0; i < count; ++i) {
+			decompress.start ();
+			shared_ptr<dcp::OpenJPEGImage> xyz = dcp::decompress_j2k (j2k, options);
+			decompress.stop ();
+			compress.start ();
+			recomp = dcp::compress_j2k (xyz, j2k_bandwidth, 24, false, false, options);
+			compress.stop ();
+			cout << (i + 1) << " ";
+			cout.flush ();
+		}
+		cout << "\n";
+
+		cout << "Decompress: " << count / decompress.get() << " fps.\n";
+		cout << "Compress:   " << count / compress.get() << " fps.\n";
 	}
-	cout << "\n";
 
-	cout << "Decompress: " << count / decompress.get() << " fps.\n";
-	cout << "Compress:   " << count / compress.get() << " fps.\n";
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	cout << "Peak RSS: " << usage.ru_maxrss << "kB, minor page faults: " << usage.ru_minflt << ".\n";
 
 	FILE* f = fopen ("check.j2c", "wb");
 	fwrite (recomp.data().get(), 1, recomp.size(), f);
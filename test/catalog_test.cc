@@ -0,0 +1,161 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "catalog.h"
+#include "compose.hpp"
+#include "util.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#ifdef LIBDCP_POSIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+using std::list;
+using std::string;
+using boost::optional;
+
+static void
+copy_dcp (boost::filesystem::path from, boost::filesystem::path to)
+{
+	boost::filesystem::create_directories (to);
+	for (boost::filesystem::directory_iterator i(from); i != boost::filesystem::directory_iterator(); ++i) {
+		boost::filesystem::copy_file (i->path(), to / i->path().filename());
+	}
+}
+
+#ifdef LIBDCP_POSIX
+static void
+set_mtime (boost::filesystem::path file, time_t seconds, long nanoseconds)
+{
+	struct timespec times[2];
+	times[0].tv_sec = times[1].tv_sec = seconds;
+	times[0].tv_nsec = times[1].tv_nsec = nanoseconds;
+	BOOST_REQUIRE_EQUAL (utimensat (AT_FDCWD, file.string().c_str(), times, 0), 0);
+}
+#endif
+
+/** Scan a small library into a Catalog, look things up in it, write it, read it back and
+ *  check that rescans only read packages which have changed.
+ */
+BOOST_AUTO_TEST_CASE (catalog_test)
+{
+	boost::filesystem::path const dir = "build/test/catalog_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::path const library = dir / "library";
+	copy_dcp ("test/ref/DCP/dcp_test1", library / "a");
+	copy_dcp ("test/ref/DCP/dcp_test1", library / "nested" / "b");
+	boost::filesystem::create_directories (library / "empty");
+
+	string const cpl_id = "81fb54df-e1bf-4647-8788-ea7ba154375b";
+	string const picture_id = "1fab8bb0-cfaf-4225-ad6d-01768bc10470";
+
+	{
+		dcp::Catalog catalog (dir / "catalog.xml");
+		BOOST_CHECK_EQUAL (catalog.scan (library), 2);
+		BOOST_CHECK_EQUAL (catalog.packages().size(), 2);
+		BOOST_CHECK_EQUAL (catalog.packages_with_cpl(cpl_id).size(), 2);
+		BOOST_CHECK_EQUAL (catalog.packages_with_asset(picture_id).size(), 2);
+		BOOST_CHECK (catalog.packages_with_key("ffffffff-ffff-ffff-ffff-ffffffffffff").empty());
+
+		optional<dcp::CatalogCPL> cpl = catalog.cpl ("81FB54DF-E1BF-4647-8788-EA7BA154375B");
+		BOOST_REQUIRE (cpl);
+		BOOST_CHECK_EQUAL (cpl->content_title_text, "A Test DCP");
+		BOOST_CHECK_EQUAL (cpl->duration, 24);
+		BOOST_REQUIRE (cpl->edit_rate);
+		BOOST_CHECK (*cpl->edit_rate == dcp::Fraction (24, 1));
+		BOOST_CHECK (!cpl->encrypted);
+		BOOST_CHECK_EQUAL (cpl->asset_ids.size(), 2);
+
+		optional<dcp::CatalogPackage> a = catalog.package (library / "a");
+		BOOST_REQUIRE (a);
+		BOOST_CHECK (!a->error);
+		BOOST_CHECK_EQUAL (a->assets.size(), 3);
+
+		/* Nothing has changed, so nothing should be read again */
+		BOOST_CHECK_EQUAL (catalog.scan (library), 0);
+
+		catalog.write ();
+	}
+
+	dcp::Catalog catalog (dir / "catalog.xml");
+	BOOST_CHECK_EQUAL (catalog.packages().size(), 2);
+	BOOST_CHECK_EQUAL (catalog.packages_with_cpl(cpl_id).size(), 2);
+	optional<dcp::CatalogCPL> cpl = catalog.cpl (cpl_id);
+	BOOST_REQUIRE (cpl);
+	BOOST_CHECK_EQUAL (cpl->duration, 24);
+	BOOST_CHECK_EQUAL (catalog.scan (library), 0);
+
+	/* Touching a CPL means that its package is read again */
+	boost::filesystem::path const b_cpl = library / "nested" / "b" / dcp::String::compose("cpl_%1.xml", cpl_id);
+	boost::filesystem::last_write_time (b_cpl, boost::filesystem::last_write_time (b_cpl) + 10);
+	BOOST_CHECK_EQUAL (catalog.scan (library), 1);
+
+#ifdef LIBDCP_POSIX
+	/* Rewriting a CPL in place within the same second, without changing its size, means
+	   that its package is read again.
+	*/
+	time_t const second = boost::filesystem::last_write_time (b_cpl);
+	set_mtime (b_cpl, second, 100000000);
+	BOOST_CHECK_EQUAL (catalog.scan (library), 1);
+
+	string xml = dcp::file_to_string (b_cpl);
+	boost::algorithm::replace_first (xml, "A Test DCP", "A Test DCQ");
+	FILE* f = dcp::fopen_boost (b_cpl, "w");
+	BOOST_REQUIRE (f);
+	fwrite (xml.c_str(), 1, xml.length(), f);
+	fclose (f);
+	set_mtime (b_cpl, second, 600000000);
+
+	BOOST_CHECK_EQUAL (catalog.scan (library), 1);
+	optional<dcp::CatalogPackage> b = catalog.package (library / "nested" / "b");
+	BOOST_REQUIRE (b);
+	BOOST_REQUIRE_EQUAL (b->cpls.size(), 1);
+	BOOST_CHECK_EQUAL (b->cpls.front().content_title_text, "A Test DCQ");
+#endif
+
+	/* A package which cannot be read is remembered with its error */
+	boost::filesystem::remove (library / "a" / dcp::String::compose("pkl_%1.xml", "ae8a9818-872a-4f86-8493-11dfdea03e09"));
+	BOOST_CHECK_EQUAL (catalog.scan (library), 1);
+	optional<dcp::CatalogPackage> a = catalog.package (library / "a");
+	BOOST_REQUIRE (a);
+	BOOST_CHECK (a->error);
+	BOOST_CHECK_EQUAL (catalog.packages_with_cpl(cpl_id).size(), 1);
+
+	/* A package which has gone is forgotten */
+	boost::filesystem::remove_all (library / "nested");
+	BOOST_CHECK_EQUAL (catalog.scan (library), 0);
+	BOOST_CHECK_EQUAL (catalog.packages().size(), 1);
+	BOOST_CHECK (catalog.packages_with_cpl(cpl_id).empty());
+}
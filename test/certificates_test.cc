@@ -37,6 +37,8 @@
 #include "exceptions.h"
 #include "test.h"
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 
 using std::list;
@@ -232,6 +234,53 @@ BOOST_AUTO_TEST_CASE (certificates_validation10)
 	BOOST_CHECK_NO_THROW (good.root_to_leaf());
 }
 
+/** Check that we can create a valid chain without running openssl */
+BOOST_AUTO_TEST_CASE (certificates_validation11)
+{
+	dcp::CertificateChain good = dcp::CertificateChain::generate (
+		"dcpomatic.com",
+		"dcpomatic.com",
+		".dcpomatic.smpte-430-2.ROOT",
+		".dcpomatic.smpte-430-2.INTERMEDIATE",
+		"CS.dcpomatic.smpte-430-2.LEAF"
+		);
+
+	BOOST_CHECK_NO_THROW (good.root_to_leaf());
+	BOOST_CHECK (good.valid());
+	BOOST_CHECK_EQUAL (good.leaf().subject_common_name(), "CS.dcpomatic.smpte-430-2.LEAF");
+	BOOST_CHECK_EQUAL (good.leaf().subject_organization_name(), "dcpomatic.com");
+	BOOST_CHECK (!good.leaf().has_utf8_strings());
+
+	/* The chain should be usable for signing */
+	dcp::CertificateChain copy (good.chain());
+	copy.set_key (good.key().get());
+	BOOST_CHECK (copy.valid());
+}
+
+static void
+make_chain (dcp::CertificateChain* chain)
+{
+	*chain = dcp::CertificateChain::generate ();
+}
+
+/** Check that chains can be made in several threads at once */
+BOOST_AUTO_TEST_CASE (certificates_validation12)
+{
+	dcp::CertificateChain chains[4];
+	boost::thread_group group;
+	for (int i = 0; i < 4; ++i) {
+		group.create_thread (boost::bind (&make_chain, &chains[i]));
+	}
+	group.join_all ();
+
+	for (int i = 0; i < 4; ++i) {
+		BOOST_CHECK (chains[i].valid());
+		for (int j = 0; j < i; ++j) {
+			BOOST_CHECK (chains[i].key() != chains[j].key());
+		}
+	}
+}
+
 /** Check that dcp::Signer::valid() basically works */
 BOOST_AUTO_TEST_CASE (signer_validation)
 {
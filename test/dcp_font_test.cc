@@ -40,9 +40,11 @@
 #include "util.h"
 #include "reel_subtitle_asset.h"
 #include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
 #include <cstdio>
 
 using std::list;
+using std::map;
 using std::string;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
@@ -86,6 +88,58 @@ BOOST_AUTO_TEST_CASE (interop_dcp_font_test)
 	BOOST_CHECK_EQUAL (memcmp (subs2->_fonts.front().data.data().get(), ref.get(), size), 0);
 }
 
+/** Create an Interop DCP whose subtitles use two fonts, read it back and check that
+ *  DCP::resolve_refs gives each LoadFont its own font file, and that resolving again
+ *  does not add the fonts a second time.
+ */
+BOOST_AUTO_TEST_CASE (interop_dcp_font_resolve_test)
+{
+	boost::filesystem::path directory = "build/test/interop_dcp_font_resolve_test";
+	boost::filesystem::path fonts = "build/test/interop_dcp_font_resolve_test_fonts";
+	boost::filesystem::remove_all (directory);
+	boost::filesystem::remove_all (fonts);
+	boost::filesystem::create_directories (directory);
+	boost::filesystem::create_directories (fonts);
+	boost::filesystem::copy_file ("test/data/dummy.ttf", fonts / "other.ttf");
+
+	dcp::DCP dcp (directory);
+
+	shared_ptr<dcp::InteropSubtitleAsset> subs (new dcp::InteropSubtitleAsset ());
+	subs->add_font ("theFontId", "test/data/dummy.ttf");
+	subs->add_font ("otherFontId", fonts / "other.ttf");
+	subs->write (directory / "frobozz.xml");
+
+	shared_ptr<dcp::Reel> reel (new dcp::Reel ());
+	reel->add (shared_ptr<dcp::ReelAsset> (new dcp::ReelSubtitleAsset (subs, dcp::Fraction (24, 1), 24, 0)));
+
+	shared_ptr<dcp::CPL> cpl (new dcp::CPL ("", dcp::TRAILER));
+	cpl->add (reel);
+
+	dcp.add (cpl);
+	dcp.write_xml (dcp::INTEROP);
+
+	dcp::DCP dcp2 (directory);
+	dcp2.read ();
+	shared_ptr<dcp::InteropSubtitleAsset> subs2 = dynamic_pointer_cast<dcp::InteropSubtitleAsset> (
+		dcp2.cpls().front()->reels().front()->main_subtitle()->asset_ref().asset()
+		);
+	BOOST_REQUIRE (subs2);
+
+	for (int i = 0; i < 2; ++i) {
+		BOOST_REQUIRE_EQUAL (subs2->_fonts.size(), 2);
+		map<string, string> files;
+		BOOST_FOREACH (dcp::SubtitleAsset::Font const & j, subs2->_fonts) {
+			BOOST_REQUIRE (j.file);
+			files[j.load_id] = j.file->leaf().string();
+		}
+		BOOST_CHECK_EQUAL (files["theFontId"], "dummy.ttf");
+		BOOST_CHECK_EQUAL (files["otherFontId"], "other.ttf");
+
+		/* Resolving again should find that both LoadFonts already have their fonts */
+		dcp2.resolve_refs (dcp2.assets ());
+	}
+}
+
 /** Create a DCP with SMPTE subtitles and check that the font is written and read back correctly */
 BOOST_AUTO_TEST_CASE (smpte_dcp_font_test)
 {
@@ -44,11 +44,21 @@
 #include "openjpeg_image.h"
 #include "rgb_xyz.h"
 #include "colour_conversion.h"
+#include "atmos_asset.h"
+#include "atmos_asset_reader.h"
+#include "atmos_asset_writer.h"
+#include "atmos_frame.h"
+#include "certificate_chain.h"
+#include "key.h"
+#include "util.h"
+#include "compose.hpp"
 #include <boost/test/unit_test.hpp>
 #include <boost/scoped_array.hpp>
 
 using std::pair;
 using std::make_pair;
+using std::string;
+using std::vector;
 using boost::dynamic_pointer_cast;
 using boost::shared_ptr;
 using boost::scoped_array;
@@ -114,6 +124,44 @@ BOOST_AUTO_TEST_CASE (decryption_test)
 	delete[] encrypted_frame.first;
 }
 
+/** Check that decrypting with several read-ahead threads gives the same frames as
+ *  decrypting one frame at a time.
+ */
+BOOST_AUTO_TEST_CASE (decryption_read_ahead_test)
+{
+	boost::filesystem::path encrypted_path = private_test;
+	encrypted_path /= "TONEPLATES-SMPTE-ENCRYPTED_TST_F_XX-XX_ITL-TD_51-XX_2K_WOE_20111001_WOE_OV";
+	dcp::DCP encrypted (encrypted_path.string ());
+	encrypted.read ();
+
+	dcp::DecryptedKDM kdm (
+		dcp::EncryptedKDM (
+			dcp::file_to_string ("test/data/kdm_TONEPLATES-SMPTE-ENC_.smpte-430-2.ROOT.NOT_FOR_PRODUCTION_20130706_20230702_CAR_OV_t1_8971c838.xml")
+			),
+		dcp::file_to_string ("test/data/private.key")
+		);
+
+	encrypted.add (kdm);
+
+	shared_ptr<const dcp::MonoPictureAsset> picture = dynamic_pointer_cast<const dcp::MonoPictureAsset> (
+		encrypted.cpls().front()->reels().front()->main_picture()->asset()
+		);
+	BOOST_REQUIRE (picture);
+
+	shared_ptr<const dcp::MonoPictureAssetReader> reader = picture->start_read ();
+	int const frames = picture->intrinsic_duration ();
+
+	shared_ptr<dcp::FrameReadAhead<dcp::MonoPictureFrame> > read_ahead = reader->read_ahead (0, frames, 8, 4);
+	for (int i = 0; i < frames; ++i) {
+		shared_ptr<const dcp::MonoPictureFrame> threaded = read_ahead->next ();
+		BOOST_REQUIRE (threaded);
+		shared_ptr<const dcp::MonoPictureFrame> serial = reader->get_frame (i);
+		BOOST_REQUIRE_EQUAL (threaded->j2k_size(), serial->j2k_size());
+		BOOST_REQUIRE_EQUAL (memcmp (threaded->j2k_data(), serial->j2k_data(), serial->j2k_size()), 0);
+	}
+	BOOST_CHECK (!read_ahead->next ());
+}
+
 /** Load in a KDM that didn't work at first */
 BOOST_AUTO_TEST_CASE (failing_kdm_test)
 {
@@ -122,3 +170,68 @@ BOOST_AUTO_TEST_CASE (failing_kdm_test)
 		dcp::file_to_string ("test/data/private.key")
 		);
 }
+
+/** Write an encrypted Atmos MXF, decrypt it with dcpdecryptmxf using 1 and 4 reader
+ *  threads and check that both outputs are the same as the plaintext.
+ */
+BOOST_AUTO_TEST_CASE (dcpdecryptmxf_atmos_test)
+{
+	boost::filesystem::path const dir = "build/test/dcpdecryptmxf_atmos_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	int const frames = 48;
+	vector<vector<uint8_t> > plaintext;
+	for (int i = 0; i < frames; ++i) {
+		vector<uint8_t> data (1024 + i * 7);
+		for (size_t j = 0; j < data.size(); ++j) {
+			data[j] = (i * 31 + j) & 0xff;
+		}
+		plaintext.push_back (data);
+	}
+
+	dcp::Key key;
+	dcp::AtmosAsset encrypted (dcp::Fraction (24, 1), 0, 10, 118, 1);
+	encrypted.set_key (key);
+	shared_ptr<dcp::AtmosAssetWriter> writer = encrypted.start_write (dir / "encrypted.mxf");
+	for (int i = 0; i < frames; ++i) {
+		writer->write (&plaintext[i][0], plaintext[i].size());
+	}
+	writer->finalize ();
+
+	shared_ptr<dcp::CertificateChain> signer (new dcp::CertificateChain (dcp::CertificateChain::generate ()));
+
+	dcp::LocalTime start;
+	start.set_year (start.year() - 1);
+	dcp::LocalTime end;
+	end.set_year (end.year() + 1);
+	dcp::DecryptedKDM kdm (start, end, "libdcp", "test", "2012-07-17T04:45:18+00:00");
+	kdm.add_key (string ("MDEK"), encrypted.key_id().get(), key, dcp::make_uuid (), dcp::SMPTE);
+	kdm.encrypt(signer, signer->leaf(), vector<string>(), dcp::MODIFIED_TRANSITIONAL_1, true, 0).as_xml (dir / "kdm.xml");
+
+	string const private_key = signer->key().get ();
+	FILE* f = dcp::fopen_boost (dir / "private.key", "w");
+	BOOST_REQUIRE (f);
+	fwrite (private_key.c_str(), 1, private_key.length(), f);
+	fclose (f);
+
+	int const threads[] = { 1, 4 };
+	for (int i = 0; i < 2; ++i) {
+		boost::filesystem::path const output = dir / dcp::String::compose ("decrypted_%1.mxf", threads[i]);
+		string const command = dcp::String::compose (
+			"build/tools/dcpdecryptmxf -j %1 -k %2 -p %3 -o %4 %5",
+			threads[i], (dir / "kdm.xml").string(), (dir / "private.key").string(), output.string(), (dir / "encrypted.mxf").string()
+			);
+		BOOST_REQUIRE_EQUAL (system (command.c_str ()), 0);
+
+		dcp::AtmosAsset decrypted (output);
+		BOOST_CHECK (!decrypted.key_id ());
+		BOOST_REQUIRE_EQUAL (decrypted.intrinsic_duration(), frames);
+		shared_ptr<dcp::AtmosAssetReader> reader = decrypted.start_read ();
+		for (int j = 0; j < frames; ++j) {
+			shared_ptr<const dcp::AtmosFrame> frame = reader->get_frame (j);
+			BOOST_REQUIRE_EQUAL (frame->size(), static_cast<int> (plaintext[j].size()));
+			BOOST_CHECK_EQUAL (memcmp (frame->data(), &plaintext[j][0], frame->size()), 0);
+		}
+	}
+}
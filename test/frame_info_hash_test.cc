@@ -35,9 +35,13 @@
 #include "mono_picture_asset_writer.h"
 #include "j2k.h"
 #include "openjpeg_image.h"
+#include "exceptions.h"
+#include "file.h"
 #include <boost/test/unit_test.hpp>
+#include <vector>
 
 using std::string;
+using std::vector;
 using boost::shared_ptr;
 
 static void
@@ -69,3 +73,56 @@ BOOST_AUTO_TEST_CASE (frame_info_hash_test)
 	check (&seed, writer, "d9e694cfe84544c54a869c128ba39343");
 	check (&seed, writer, "fafb05a0039cb9fc604279c90a13cb87");
 }
+
+/** As frame_info_hash_test but writing in the background with write_async() */
+BOOST_AUTO_TEST_CASE (frame_info_hash_async_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/frame_info_hash_async_test.mxf", false);
+
+	unsigned int seed = 42;
+
+	vector<boost::shared_future<dcp::FrameInfo> > info;
+	for (int i = 0; i < 3; ++i) {
+		shared_ptr<dcp::OpenJPEGImage> xyz (new dcp::OpenJPEGImage (dcp::Size (1998, 1080)));
+		for (int c = 0; c < 3; ++c) {
+			for (int p = 0; p < (1998 * 1080); ++p) {
+				xyz->data(c)[p] = rand_r (&seed) & 0xfff;
+			}
+		}
+
+		dcp::Data data = dcp::compress_j2k (xyz, 100000000, 24, false, false);
+		info.push_back (writer->write_async (data.data().get(), data.size()));
+	}
+
+	/* This must be written after the frames above */
+	writer->fake_write (info.back().get().size);
+	writer->finalize ();
+
+	BOOST_CHECK_EQUAL (info[0].get().hash, "c039c5a0e5d20bc646f7e9c10e2d5874");
+	BOOST_CHECK_EQUAL (info[1].get().hash, "d9e694cfe84544c54a869c128ba39343");
+	BOOST_CHECK_EQUAL (info[2].get().hash, "fafb05a0039cb9fc604279c90a13cb87");
+	BOOST_CHECK_EQUAL (info[1].get().offset, info[0].get().offset + info[0].get().size);
+	BOOST_CHECK_EQUAL (info[2].get().offset, info[1].get().offset + info[1].get().size);
+	BOOST_CHECK_EQUAL (mp->intrinsic_duration(), 4);
+}
+
+/** Check that something which is obviously not JPEG2000 is not written, even though
+ *  only the first frame is fully parsed.
+ */
+BOOST_AUTO_TEST_CASE (frame_info_bad_frame_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/frame_info_bad_frame_test.mxf", false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	writer->write (j2c.data(), j2c.size());
+
+	uint8_t junk[64];
+	memset (junk, 0, sizeof (junk));
+	BOOST_CHECK_THROW (writer->write (junk, sizeof (junk)), dcp::MiscError);
+
+	writer->write (j2c.data(), j2c.size());
+	writer->finalize ();
+	BOOST_CHECK_EQUAL (mp->intrinsic_duration(), 2);
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "j2k.h"
+#include "openjpeg_image.h"
+#include "data.h"
+#include <boost/test/unit_test.hpp>
+
+using boost::shared_ptr;
+
+/** Check that a J2KDecoder can decode several frames into the same OpenJPEGImage, and that
+ *  it gives the same results as decompress_j2k.
+ */
+BOOST_AUTO_TEST_CASE (j2k_decoder_test)
+{
+	dcp::Data j2k ("test/data/32x32_red_square.j2c");
+	shared_ptr<dcp::OpenJPEGImage> ref = dcp::decompress_j2k (j2k, 0);
+	BOOST_REQUIRE_EQUAL (ref->size(), dcp::Size (32, 32));
+
+	dcp::J2KDecoder decoder;
+	shared_ptr<dcp::OpenJPEGImage> image (new dcp::OpenJPEGImage (dcp::Size (4, 4)));
+	for (int i = 0; i < 4; ++i) {
+		decoder.decompress (j2k.data().get(), j2k.size(), 0, *image);
+		BOOST_REQUIRE_EQUAL (image->size(), ref->size());
+		for (int c = 0; c < 3; ++c) {
+			BOOST_REQUIRE (memcmp (image->data(c), ref->data(c), 32 * 32 * sizeof (int)) == 0);
+		}
+	}
+
+	shared_ptr<dcp::OpenJPEGImage> half = decoder.decompress (j2k.data().get(), j2k.size(), 1);
+	BOOST_CHECK_EQUAL (half->size(), dcp::Size (16, 16));
+}
+
+/** Check that decoding with several threads gives the same result as with one */
+BOOST_AUTO_TEST_CASE (j2k_threads_test)
+{
+	dcp::Data j2k ("test/data/32x32_red_square.j2c");
+	shared_ptr<dcp::OpenJPEGImage> ref = dcp::decompress_j2k (j2k, 0);
+
+	dcp::J2KOptions options;
+	options.threads = 4;
+	shared_ptr<dcp::OpenJPEGImage> image = dcp::decompress_j2k (j2k, options);
+	BOOST_REQUIRE_EQUAL (image->size(), ref->size());
+	for (int c = 0; c < 3; ++c) {
+		BOOST_REQUIRE (memcmp (image->data(c), ref->data(c), 32 * 32 * sizeof (int)) == 0);
+	}
+
+	shared_ptr<dcp::OpenJPEGImage> recompressed = dcp::decompress_j2k (dcp::compress_j2k (image, 100000000, 24, false, false, options), 0);
+	BOOST_CHECK_EQUAL (recompressed->size(), ref->size());
+}
+
+static shared_ptr<dcp::OpenJPEGImage>
+random_image (unsigned int* seed)
+{
+	shared_ptr<dcp::OpenJPEGImage> xyz (new dcp::OpenJPEGImage (dcp::Size (1998, 1080)));
+	for (int c = 0; c < 3; ++c) {
+		for (int p = 0; p < (1998 * 1080); ++p) {
+			xyz->data(c)[p] = rand_r (seed) & 0xfff;
+		}
+	}
+	return xyz;
+}
+
+/** Check that the buffers which compress_j2k re-uses are not handed out again while
+ *  they are still in use.
+ */
+BOOST_AUTO_TEST_CASE (j2k_compress_buffer_reuse_test)
+{
+	unsigned int seed = 42;
+
+	dcp::Data a = dcp::compress_j2k (random_image (&seed), 100000000, 24, false, false);
+	dcp::Data const a_copy (a.data().get(), a.size());
+
+	dcp::Data b = dcp::compress_j2k (random_image (&seed), 100000000, 24, false, false);
+	dcp::Data const b_copy (b.data().get(), b.size());
+	BOOST_CHECK (a.data().get() != b.data().get());
+	BOOST_CHECK (a == a_copy);
+
+	/* Drop a so that its buffer can go back to the pool and be used again */
+	a = dcp::Data ();
+	for (int i = 0; i < 4; ++i) {
+		dcp::Data c = dcp::compress_j2k (random_image (&seed), 100000000, 24, false, false);
+		BOOST_CHECK (b == b_copy);
+		BOOST_CHECK_EQUAL (dcp::decompress_j2k (c, 0)->size(), dcp::Size (1998, 1080));
+	}
+}
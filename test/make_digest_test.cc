@@ -33,9 +33,14 @@
 
 #include "data.h"
 #include "util.h"
+#include "exceptions.h"
+#include "digest_cache.h"
 #include <boost/bind.hpp>
 #include <boost/test/unit_test.hpp>
 #include <sys/time.h>
+#include <fstream>
+#include <string>
+#include <vector>
 
 void progress (float)
 {
@@ -58,3 +63,96 @@ BOOST_AUTO_TEST_CASE (make_digest_test)
 	/* Hash it */
 	BOOST_CHECK_EQUAL (dcp::make_digest ("build/test/random", boost::bind (&progress, _1)), "GKbk/V3fcRtP5MaPdSmAGNbKkaU=");
 }
+
+/** Check that hashing several files at once gives the same digests as hashing them one at a time */
+BOOST_AUTO_TEST_CASE (make_digests_test)
+{
+	std::vector<boost::filesystem::path> files;
+	files.push_back ("test/ref/DCP/dcp_test1/video.mxf");
+	files.push_back ("test/ref/DCP/dcp_test1/audio.mxf");
+	files.push_back ("test/data/32x32_red_square.j2c");
+	files.push_back ("test/ref/DCP/dcp_test1/ASSETMAP.xml");
+
+	/* Make sure that at least one file spans several of make_digest's read blocks */
+	srand (2);
+	int const N = 9 * 1024 * 1024 + 17;
+	dcp::Data data (N);
+	uint8_t* p = data.data().get();
+	for (int i = 0; i < N; ++i) {
+		*p++ = rand() & 0xff;
+	}
+	data.write ("build/test/random2");
+	files.push_back ("build/test/random2");
+
+	std::vector<std::string> parallel = dcp::make_digests (files, 3, boost::bind (&progress, _1));
+	BOOST_REQUIRE_EQUAL (parallel.size(), files.size());
+	for (size_t i = 0; i < files.size(); ++i) {
+		BOOST_CHECK_EQUAL (parallel[i], dcp::make_digest (files[i], 0));
+		BOOST_CHECK_EQUAL (parallel[i], dcp::make_digest (dcp::Data (files[i])));
+	}
+
+	files.push_back ("test/data/does-not-exist");
+	BOOST_CHECK_THROW (dcp::make_digests (files, 3), dcp::FileError);
+}
+
+/** Check that make_digest uses a DigestCache, and that the cache survives being written and read back */
+BOOST_AUTO_TEST_CASE (make_digest_cache_test)
+{
+	boost::filesystem::path const cache_file = "build/test/digest_cache";
+	boost::filesystem::remove (cache_file);
+	boost::filesystem::path const file = "build/test/digest_cache_data";
+
+	dcp::Data data (4096);
+	memset (data.data().get(), 42, data.size());
+	data.write (file);
+	std::string const real = dcp::make_digest (dcp::Data (file));
+
+	boost::shared_ptr<dcp::DigestCache> cache (new dcp::DigestCache (cache_file));
+	dcp::set_digest_cache (cache);
+
+	/* A digest that make_digest calculates goes into the cache */
+	BOOST_CHECK_EQUAL (dcp::make_digest (file, 0), real);
+	BOOST_REQUIRE (cache->get (file));
+	BOOST_CHECK_EQUAL (*cache->get (file), real);
+
+	/* Then make_digest believes the cache, unless told not to */
+	cache->add (file, "not-a-real-digest");
+	BOOST_CHECK_EQUAL (dcp::make_digest (file, 0), "not-a-real-digest");
+	BOOST_CHECK_EQUAL (dcp::make_digest (file, 0, boost::function<void (uint8_t const *, int)> (), false), real);
+
+	cache->add (file, "not-a-real-digest");
+	cache->write ();
+	dcp::set_digest_cache (boost::shared_ptr<dcp::DigestCache> ());
+
+	boost::shared_ptr<dcp::DigestCache> reread (new dcp::DigestCache (cache_file));
+	BOOST_REQUIRE (reread->get (file));
+	BOOST_CHECK_EQUAL (*reread->get (file), "not-a-real-digest");
+
+	/* Changing the file's size means that the cached digest no longer applies */
+	dcp::Data bigger (8192);
+	memset (bigger.data().get(), 42, bigger.size());
+	bigger.write (file);
+	BOOST_CHECK (!reread->get (file));
+
+	/* Taking the digest of the changed file replaces the old entry rather than adding another */
+	dcp::set_digest_cache (reread);
+	std::string const bigger_digest = dcp::make_digest (file, 0);
+	reread->write ();
+	dcp::set_digest_cache (boost::shared_ptr<dcp::DigestCache> ());
+	std::ifstream cache_in (cache_file.string().c_str());
+	int lines = 0;
+	std::string line;
+	while (getline (cache_in, line)) {
+		++lines;
+	}
+	BOOST_CHECK_EQUAL (lines, 1);
+
+	/* A picture frame size can be kept with the digest, and is not lost when the digest is added again */
+	boost::optional<dcp::DigestCache::Key> key = dcp::DigestCache::key (file);
+	BOOST_REQUIRE (key);
+	reread->add (*key, bigger_digest, 4242);
+	reread->add (*key, bigger_digest);
+	BOOST_REQUIRE (reread->get (*key));
+	BOOST_CHECK_EQUAL (reread->get(*key)->digest, bigger_digest);
+	BOOST_CHECK_EQUAL (reread->get(*key)->biggest_picture_frame.get_value_or(0), 4242);
+}
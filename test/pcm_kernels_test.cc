@@ -0,0 +1,194 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "pcm_kernels.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/scoped_array.hpp>
+#include <vector>
+
+using std::vector;
+using boost::scoped_array;
+
+/** Make some interleaved 24-bit samples, including some at the ends of the range */
+static void
+make_samples (uint8_t* p, int n)
+{
+	for (int i = 0; i < n; ++i) {
+		int32_t s;
+		switch (rand() % 8) {
+		case 0:
+			s = (1 << 23) - 1;
+			break;
+		case 1:
+			s = -(1 << 23);
+			break;
+		default:
+			s = (rand() & 0xffffff) - (1 << 23);
+			break;
+		}
+		p[i * 3 + 0] = s & 0xff;
+		p[i * 3 + 1] = (s >> 8) & 0xff;
+		p[i * 3 + 2] = (s >> 16) & 0xff;
+	}
+}
+
+static void
+check_compare_pcm_24_kernel (dcp::ComparePCM24Kernel kernel)
+{
+	srand (1);
+
+	/* Odd numbers of samples leave leftovers for the scalar code at the end; 36 channels is
+	   more than the SIMD kernels handle themselves.
+	*/
+	int const channel_counts[] = { 1, 2, 3, 5, 6, 8, 12, 14, 16, 36 };
+	int const sample_counts[] = { 0, 1, 3, 7, 1001, 2002 };
+
+	for (size_t i = 0; i < sizeof (channel_counts) / sizeof (int); ++i) {
+		for (size_t j = 0; j < sizeof (sample_counts) / sizeof (int); ++j) {
+			int const channels = channel_counts[i];
+			int const samples = sample_counts[j];
+			int const n = channels * samples;
+
+			scoped_array<uint8_t> a (new uint8_t[n * 3]);
+			scoped_array<uint8_t> b (new uint8_t[n * 3]);
+			make_samples (a.get(), n);
+			make_samples (b.get(), n);
+
+			vector<int32_t> ref_max (channels);
+			vector<int64_t> ref_sum (channels);
+			dcp::compare_pcm_24_scalar (a.get(), b.get(), samples, channels, &ref_max[0], &ref_sum[0]);
+
+			/* Start with rubbish to check that the kernel clears it */
+			vector<int32_t> max (channels, 42);
+			vector<int64_t> sum (channels, 42);
+			kernel (a.get(), b.get(), samples, channels, &max[0], &sum[0]);
+
+			BOOST_CHECK (max == ref_max);
+			BOOST_CHECK (sum == ref_sum);
+		}
+	}
+}
+
+/** Check that the compare_pcm_24 kernels give exactly the same results as the scalar one */
+BOOST_AUTO_TEST_CASE (compare_pcm_24_test)
+{
+	check_compare_pcm_24_kernel (dcp::compare_pcm_24_kernel ());
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("sse4.1")) {
+		check_compare_pcm_24_kernel (&dcp::compare_pcm_24_sse41);
+	}
+	if (__builtin_cpu_supports ("avx2")) {
+		check_compare_pcm_24_kernel (&dcp::compare_pcm_24_avx2);
+	}
+#endif
+}
+
+static void
+check_pack_float_24_kernel (dcp::PackFloat24Kernel kernel)
+{
+	srand (1);
+
+	/* Odd numbers of samples and channels leave leftovers for the scalar code */
+	int const channel_counts[] = { 1, 2, 3, 4, 5, 6, 8, 14, 16, 17 };
+	int const sample_counts[] = { 0, 1, 3, 7, 8, 9, 1001, 2000 };
+
+	for (size_t i = 0; i < sizeof (channel_counts) / sizeof (int); ++i) {
+		for (size_t j = 0; j < sizeof (sample_counts) / sizeof (int); ++j) {
+			int const channels = channel_counts[i];
+			int const samples = sample_counts[j];
+
+			vector<vector<float> > data (channels, vector<float> (samples + 1));
+			vector<float const *> in (channels);
+			for (int c = 0; c < channels; ++c) {
+				for (int s = 0; s < samples; ++s) {
+					switch (rand() % 8) {
+					case 0:
+						/* Out of range */
+						data[c][s] = (rand() % 2) ? 1.5 : -1.5;
+						break;
+					case 1:
+						data[c][s] = (rand() % 2) ? 1 : -1;
+						break;
+					case 2:
+						data[c][s] = (rand() % 2) ? 0.0f : -0.0f;
+						break;
+					default:
+						data[c][s] = (float (rand()) / RAND_MAX) * 2 - 1;
+						break;
+					}
+				}
+				/* Sometimes use a null pointer to ask for silence */
+				in[c] = (channels > 1 && c == channels / 2) ? 0 : &data[c][0];
+			}
+
+			int const size = samples * channels * 3;
+			vector<uint8_t> ref (size + 1, 42);
+			vector<uint8_t> out (size + 1, 42);
+			dcp::pack_float_24_scalar (&in[0], channels, samples, &ref[0]);
+			kernel (&in[0], channels, samples, &out[0]);
+
+			BOOST_CHECK (out == ref);
+			/* Check that nothing was written past the end */
+			BOOST_CHECK_EQUAL (out[size], 42);
+		}
+	}
+}
+
+/** Check that the pack_float_24 kernels give exactly the same results as the scalar one */
+BOOST_AUTO_TEST_CASE (pack_float_24_test)
+{
+	float const in[] = { 0, 0.5, -0.5, 1, -1, 2, -2 };
+	float const * channels[] = { in };
+	uint8_t out[7 * 3];
+	dcp::pack_float_24_scalar (channels, 1, 7, out);
+	uint8_t const expected[] = {
+		0x00, 0x00, 0x00,
+		0x00, 0x00, 0x40,
+		0x00, 0x00, 0xc0,
+		0xff, 0xff, 0x7f,
+		0x01, 0x00, 0x80,
+		0xff, 0xff, 0x7f,
+		0x01, 0x00, 0x80
+	};
+	BOOST_CHECK_EQUAL_COLLECTIONS (out, out + sizeof (out), expected, expected + sizeof (expected));
+
+	check_pack_float_24_kernel (dcp::pack_float_24_kernel ());
+#ifdef LIBDCP_X86_SIMD
+	if (__builtin_cpu_supports ("sse4.1")) {
+		check_pack_float_24_kernel (&dcp::pack_float_24_sse41);
+	}
+	if (__builtin_cpu_supports ("avx2")) {
+		check_pack_float_24_kernel (&dcp::pack_float_24_avx2);
+	}
+#endif
+}
@@ -0,0 +1,188 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "mono_picture_asset.h"
+#include "stereo_picture_asset.h"
+#include "picture_asset_writer.h"
+#include "openjpeg_image.h"
+#include "j2k.h"
+#include "data.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <list>
+#include <string>
+
+using std::list;
+using std::pair;
+using std::string;
+using std::make_pair;
+using boost::shared_ptr;
+
+static void
+store_note (list<pair<dcp::NoteType, string> >& notes, dcp::NoteType type, string note)
+{
+	notes.push_back (make_pair (type, note));
+}
+
+static void
+check_parallel_equals (shared_ptr<dcp::Asset> A, shared_ptr<dcp::Asset> B)
+{
+	dcp::EqualityOptions opt;
+
+	list<pair<dcp::NoteType, string> > serial_notes;
+	bool const serial = A->equals (B, opt, boost::bind (&store_note, boost::ref (serial_notes), _1, _2));
+
+	opt.threads = 4;
+	list<pair<dcp::NoteType, string> > parallel_notes;
+	bool const parallel = A->equals (B, opt, boost::bind (&store_note, boost::ref (parallel_notes), _1, _2));
+
+	BOOST_CHECK (serial);
+	BOOST_CHECK (parallel);
+	BOOST_REQUIRE (!serial_notes.empty ());
+	BOOST_CHECK (serial_notes == parallel_notes);
+}
+
+/** Check that comparing a MonoPictureAsset using several threads gives the same
+ *  result and notes, in the same order, as comparing it using one.
+ */
+BOOST_AUTO_TEST_CASE (mono_picture_asset_parallel_equals_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> A (new dcp::MonoPictureAsset ("test/ref/DCP/dcp_test1/video.mxf"));
+	shared_ptr<dcp::MonoPictureAsset> B (new dcp::MonoPictureAsset ("test/ref/DCP/dcp_test1/video.mxf"));
+	check_parallel_equals (A, B);
+}
+
+/** As mono_picture_asset_parallel_equals_test but for a StereoPictureAsset */
+BOOST_AUTO_TEST_CASE (stereo_picture_asset_parallel_equals_test)
+{
+	shared_ptr<dcp::StereoPictureAsset> A (new dcp::StereoPictureAsset ("test/ref/DCP/dcp_test2/video.mxf"));
+	shared_ptr<dcp::StereoPictureAsset> B (new dcp::StereoPictureAsset ("test/ref/DCP/dcp_test2/video.mxf"));
+	check_parallel_equals (A, B);
+}
+
+/** @return J2K data for a 64x64 image whose pixels all have a given value */
+static dcp::Data
+flat_frame (int value)
+{
+	shared_ptr<dcp::OpenJPEGImage> xyz (new dcp::OpenJPEGImage (dcp::Size (64, 64)));
+	for (int c = 0; c < 3; ++c) {
+		for (int p = 0; p < 64 * 64; ++p) {
+			xyz->data(c)[p] = value;
+		}
+	}
+	return dcp::compress_j2k (xyz, 100000000, 24, false, false);
+}
+
+/** Write a 24-frame mono picture asset whose frames are all the same, except
+ *  for frames 10 and 17 if changed is true.
+ */
+static shared_ptr<dcp::MonoPictureAsset>
+write_picture_asset (boost::filesystem::path file, bool changed)
+{
+	dcp::Data const normal = flat_frame (2048);
+	dcp::Data const different = flat_frame (1024);
+
+	shared_ptr<dcp::MonoPictureAsset> asset (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = asset->start_write (file, false);
+	for (int i = 0; i < 24; ++i) {
+		dcp::Data const & frame = (changed && (i == 10 || i == 17)) ? different : normal;
+		writer->write (frame.data().get(), frame.size());
+	}
+	writer->finalize ();
+	return asset;
+}
+
+static bool
+equals (shared_ptr<dcp::Asset> A, shared_ptr<dcp::Asset> B, dcp::EqualityOptions opt, list<pair<dcp::NoteType, string> >& notes)
+{
+	notes.clear ();
+	return A->equals (B, opt, boost::bind (&store_note, boost::ref (notes), _1, _2));
+}
+
+static list<string>
+errors (list<pair<dcp::NoteType, string> > const & notes)
+{
+	list<string> e;
+	for (list<pair<dcp::NoteType, string> >::const_iterator i = notes.begin(); i != notes.end(); ++i) {
+		if (i->first == dcp::DCP_ERROR) {
+			e.push_back (i->second);
+		}
+	}
+	return e;
+}
+
+/** Check the results of comparing picture assets which differ, with and without threads */
+BOOST_AUTO_TEST_CASE (picture_asset_equals_test)
+{
+	boost::filesystem::path dir = "build/test/picture_asset_equals_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	shared_ptr<dcp::MonoPictureAsset> A = write_picture_asset (dir / "A.mxf", false);
+	shared_ptr<dcp::MonoPictureAsset> B = write_picture_asset (dir / "B.mxf", true);
+
+	dcp::EqualityOptions opt;
+	list<pair<dcp::NoteType, string> > notes;
+
+	BOOST_CHECK (equals (A, A, opt, notes));
+	BOOST_CHECK (errors(notes).empty ());
+
+	/* Without keep_going the comparison stops at frame 10 */
+	BOOST_CHECK (!equals (A, B, opt, notes));
+	list<string> e = errors (notes);
+	BOOST_REQUIRE_EQUAL (e.size(), 1);
+	BOOST_CHECK (e.front().find ("in frame 10") != string::npos);
+	BOOST_REQUIRE (!notes.empty ());
+	BOOST_CHECK_EQUAL (notes.back().first, dcp::DCP_ERROR);
+	BOOST_CHECK_EQUAL (notes.front().second, "Compared video frame 0 of 24");
+
+	list<pair<dcp::NoteType, string> > serial_notes = notes;
+	opt.threads = 4;
+	BOOST_CHECK (!equals (A, B, opt, notes));
+	BOOST_CHECK (notes == serial_notes);
+
+	/* With keep_going both frames are reported, in order */
+	opt.keep_going = true;
+	BOOST_CHECK (!equals (A, B, opt, notes));
+	e = errors (notes);
+	BOOST_REQUIRE_EQUAL (e.size(), 2);
+	BOOST_CHECK (e.front().find ("in frame 10") != string::npos);
+	BOOST_CHECK (e.back().find ("in frame 17") != string::npos);
+	BOOST_CHECK_EQUAL (notes.back().second, "J2K identical");
+
+	serial_notes = notes;
+	opt.threads = 1;
+	BOOST_CHECK (!equals (A, B, opt, notes));
+	BOOST_CHECK (notes == serial_notes);
+}
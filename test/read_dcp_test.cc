@@ -35,6 +35,13 @@
 #include <boost/optional/optional_io.hpp>
 #include "dcp.h"
 #include "cpl.h"
+#include "reel.h"
+#include "reel_mono_picture_asset.h"
+#include "reel_sound_asset.h"
+#include "sound_asset.h"
+#include "exceptions.h"
+#include <boost/filesystem.hpp>
+#include <cstdio>
 
 using std::list;
 using boost::shared_ptr;
@@ -68,3 +75,41 @@ BOOST_AUTO_TEST_CASE (read_dcp_test2)
 	BOOST_REQUIRE (d.standard());
 	BOOST_CHECK_EQUAL (d.standard(), dcp::INTEROP);
 }
+
+/** Check that a lazy read does not open MXFs until their assets are asked for */
+BOOST_AUTO_TEST_CASE (read_dcp_lazy_test)
+{
+	boost::filesystem::path const dir = "build/test/read_dcp_lazy_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+	for (boost::filesystem::directory_iterator i("test/ref/DCP/dcp_test1"); i != boost::filesystem::directory_iterator(); ++i) {
+		boost::filesystem::copy_file (i->path(), dir / i->path().filename());
+	}
+
+	/* Break the picture MXF */
+	FILE* f = fopen ((dir / "video.mxf").string().c_str(), "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "not an MXF");
+	fclose (f);
+
+	dcp::DCP normal (dir);
+	BOOST_CHECK_THROW (normal.read(), dcp::ReadError);
+
+	dcp::DCP lazy (dir);
+	lazy.read (0, false, true);
+
+	list<shared_ptr<dcp::CPL> > cpls = lazy.cpls ();
+	BOOST_REQUIRE_EQUAL (cpls.size(), 1);
+	BOOST_CHECK_EQUAL (cpls.front()->annotation_text(), "A Test DCP");
+
+	shared_ptr<dcp::Reel> reel = cpls.front()->reels().front();
+	BOOST_REQUIRE (reel->main_picture()->asset_ref().resolved());
+	BOOST_CHECK_THROW (reel->main_picture()->asset_ref().asset(), dcp::ReadError);
+
+	/* The sound MXF is fine, so it should open when it is asked for */
+	BOOST_REQUIRE (reel->main_sound()->asset_ref().resolved());
+	shared_ptr<dcp::SoundAsset> sound = reel->main_sound()->asset();
+	BOOST_REQUIRE (sound);
+	BOOST_CHECK_EQUAL (sound->id(), reel->main_sound()->asset_ref().id());
+	BOOST_CHECK (sound == reel->main_sound()->asset());
+}
@@ -34,10 +34,13 @@
 #include "rgb_xyz.h"
 #include "openjpeg_image.h"
 #include "colour_conversion.h"
+#include "transfer_function.h"
+#include "compose.hpp"
 #include <boost/test/unit_test.hpp>
 #include <boost/bind.hpp>
 #include <boost/scoped_array.hpp>
 
+using std::min;
 using std::max;
 using std::list;
 using std::string;
@@ -177,6 +180,81 @@ BOOST_AUTO_TEST_CASE (xyz_rgb_range_test)
 	BOOST_REQUIRE_EQUAL (buffer[1 * 3 + 2], buffer[3 * 3 + 2]);
 }
 
+/** Straightforward per-pixel version of xyz_to_rgb to check the optimised one against */
+static void
+simple_xyz_to_rgb (shared_ptr<const dcp::OpenJPEGImage> xyz, dcp::ColourConversion const & conversion, uint8_t* rgb, int stride, list<string>& notes)
+{
+	double const * lut_in = conversion.out()->lut (12, false);
+	double const * lut_out = conversion.in()->lut (16, true);
+	boost::numeric::ublas::matrix<double> const matrix = conversion.xyz_to_rgb ();
+
+	int* xyz_x = xyz->data (0);
+	int* xyz_y = xyz->data (1);
+	int* xyz_z = xyz->data (2);
+	for (int y = 0; y < xyz->size().height; ++y) {
+		uint16_t* p = reinterpret_cast<uint16_t*> (rgb + y * stride);
+		for (int x = 0; x < xyz->size().width; ++x) {
+			int c[3] = { *xyz_x++, *xyz_y++, *xyz_z++ };
+			double s[3];
+			for (int i = 0; i < 3; ++i) {
+				if (c[i] < 0 || c[i] > 4095) {
+					notes.push_back (dcp::String::compose ("XYZ value %1 out of range", c[i]));
+					c[i] = max (min (c[i], 4095), 0);
+				}
+				s[i] = lut_in[c[i]] / (48.0 / 52.37);
+			}
+			for (int i = 0; i < 3; ++i) {
+				double const d = min (1.0, max (0.0, s[0] * matrix(i, 0) + s[1] * matrix(i, 1) + s[2] * matrix(i, 2)));
+				*p++ = lrint (lut_out[lrint(d * 65535)] * 65535);
+			}
+		}
+	}
+}
+
+/** Check that xyz_to_rgb gives exactly the same results and notes as a simple per-pixel
+ *  implementation, however many threads it uses.
+ */
+BOOST_AUTO_TEST_CASE (xyz_rgb_threads_test)
+{
+	srand (0);
+	/* An odd width so that the SIMD kernels have some pixels left over on each row */
+	dcp::Size const size (643, 97);
+
+	shared_ptr<dcp::OpenJPEGImage> xyz (new dcp::OpenJPEGImage (size));
+	for (int c = 0; c < 3; ++c) {
+		for (int i = 0; i < size.width * size.height; ++i) {
+			/* Mostly in range, with the odd value that needs clamping */
+			xyz->data(c)[i] = (rand () % 4200) - 50;
+		}
+	}
+
+	dcp::ColourConversion conversions[] = {
+		dcp::ColourConversion::srgb_to_xyz (),
+		dcp::ColourConversion::rec709_to_xyz (),
+		dcp::ColourConversion::p3_to_xyz (),
+		dcp::ColourConversion::rec2020_to_xyz ()
+	};
+
+	int const stride = size.width * 6;
+	scoped_array<uint8_t> ref (new uint8_t[stride * size.height]);
+	scoped_array<uint8_t> rgb (new uint8_t[stride * size.height]);
+
+	for (int i = 0; i < 4; ++i) {
+		list<string> ref_notes;
+		simple_xyz_to_rgb (xyz, conversions[i], ref.get(), stride, ref_notes);
+		BOOST_REQUIRE (!ref_notes.empty ());
+
+		for (int threads = 1; threads <= 4; ++threads) {
+			notes.clear ();
+			dcp::xyz_to_rgb (
+				xyz, conversions[i], rgb.get(), stride, threads, boost::optional<dcp::NoteHandler> (boost::bind (&note_handler, _1, _2))
+				);
+			BOOST_REQUIRE (memcmp (ref.get(), rgb.get(), stride * size.height) == 0);
+			BOOST_REQUIRE (notes == ref_notes);
+		}
+	}
+}
+
 /** Convert an image from RGB to XYZ and back again */
 BOOST_AUTO_TEST_CASE (rgb_xyz_round_trip_test)
 {
@@ -208,3 +286,68 @@ BOOST_AUTO_TEST_CASE (rgb_xyz_round_trip_test)
 	}
 #endif
 }
+
+/** Straightforward per-pixel version of rgb_to_xyz to check the optimised one against */
+static shared_ptr<dcp::OpenJPEGImage>
+simple_rgb_to_xyz (uint8_t const * rgb, dcp::Size size, int stride, dcp::ColourConversion const & conversion)
+{
+	shared_ptr<dcp::OpenJPEGImage> xyz (new dcp::OpenJPEGImage (size));
+
+	double const * lut_in = conversion.in()->lut (12, false);
+	double const * lut_out = conversion.out()->lut (16, true);
+	double matrix[9];
+	dcp::combined_rgb_to_xyz (conversion, matrix);
+
+	int* xyz_x = xyz->data (0);
+	int* xyz_y = xyz->data (1);
+	int* xyz_z = xyz->data (2);
+	for (int y = 0; y < size.height; ++y) {
+		uint16_t const * p = reinterpret_cast<uint16_t const *> (rgb + y * stride);
+		for (int x = 0; x < size.width; ++x) {
+			double const r = lut_in[*p++ >> 4];
+			double const g = lut_in[*p++ >> 4];
+			double const b = lut_in[*p++ >> 4];
+			double const dx = min (65535.0, max (0.0, r * matrix[0] + g * matrix[1] + b * matrix[2]));
+			double const dy = min (65535.0, max (0.0, r * matrix[3] + g * matrix[4] + b * matrix[5]));
+			double const dz = min (65535.0, max (0.0, r * matrix[6] + g * matrix[7] + b * matrix[8]));
+			*xyz_x++ = lrint (lut_out[lrint(dx)] * 4095);
+			*xyz_y++ = lrint (lut_out[lrint(dy)] * 4095);
+			*xyz_z++ = lrint (lut_out[lrint(dz)] * 4095);
+		}
+	}
+
+	return xyz;
+}
+
+/** Check that rgb_to_xyz gives exactly the same results as a simple per-pixel
+ *  implementation, however many threads it uses.
+ */
+BOOST_AUTO_TEST_CASE (rgb_xyz_threads_test)
+{
+	srand (0);
+	/* An odd width so that the SIMD kernels have some pixels left over on each row */
+	dcp::Size const size (643, 97);
+
+	scoped_array<uint8_t> rgb (new uint8_t[size.width * size.height * 6]);
+	uint16_t* p = reinterpret_cast<uint16_t*> (rgb.get());
+	for (int i = 0; i < size.width * size.height * 3; ++i) {
+		*p++ = rand () & 0xffff;
+	}
+
+	dcp::ColourConversion conversions[] = {
+		dcp::ColourConversion::srgb_to_xyz (),
+		dcp::ColourConversion::rec709_to_xyz (),
+		dcp::ColourConversion::p3_to_xyz (),
+		dcp::ColourConversion::rec2020_to_xyz ()
+	};
+
+	for (int i = 0; i < 4; ++i) {
+		shared_ptr<dcp::OpenJPEGImage> ref = simple_rgb_to_xyz (rgb.get(), size, size.width * 6, conversions[i]);
+		for (int threads = 1; threads <= 4; ++threads) {
+			shared_ptr<dcp::OpenJPEGImage> xyz = dcp::rgb_to_xyz (rgb.get(), size, size.width * 6, conversions[i], threads);
+			for (int c = 0; c < 3; ++c) {
+				BOOST_REQUIRE (memcmp (ref->data(c), xyz->data(c), size.width * size.height * sizeof(int)) == 0);
+			}
+		}
+	}
+}
@@ -0,0 +1,127 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "sound_asset.h"
+#include "sound_asset_writer.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <list>
+#include <string>
+
+using std::list;
+using std::pair;
+using std::string;
+using std::make_pair;
+using boost::shared_ptr;
+
+static void
+store_note (list<pair<dcp::NoteType, string> >& notes, dcp::NoteType type, string note)
+{
+	notes.push_back (make_pair (type, note));
+}
+
+/** Write a 3-channel, 48-frame sound asset whose samples are exact 24-bit values,
+ *  optionally changing one sample of channel 2 in frame 30 by a given amount.
+ */
+static shared_ptr<dcp::SoundAsset>
+write_sound_asset (boost::filesystem::path file, int change)
+{
+	shared_ptr<dcp::SoundAsset> asset (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, 3, dcp::SMPTE));
+	shared_ptr<dcp::SoundAssetWriter> writer = asset->start_write (file);
+
+	int const frame_length = 2000;
+	float buffer[3][frame_length];
+	float* channels[3] = { buffer[0], buffer[1], buffer[2] };
+
+	for (int i = 0; i < 48; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			for (int k = 0; k < frame_length; ++k) {
+				buffer[j][k] = ((k * (j + 1)) % 4096 - 2048) / 8388608.0f;
+			}
+		}
+		if (i == 30) {
+			buffer[1][42] += change / 8388608.0f;
+		}
+		writer->write (channels, frame_length);
+	}
+
+	writer->finalize ();
+	return asset;
+}
+
+static bool
+equals (shared_ptr<dcp::SoundAsset> A, shared_ptr<dcp::SoundAsset> B, dcp::EqualityOptions opt, list<pair<dcp::NoteType, string> >& notes)
+{
+	notes.clear ();
+	return A->equals (B, opt, boost::bind (&store_note, boost::ref (notes), _1, _2));
+}
+
+/** Check the results of comparing sound assets, with and without threads */
+BOOST_AUTO_TEST_CASE (sound_asset_equals_test)
+{
+	boost::filesystem::path dir = "build/test/sound_asset_equals_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	shared_ptr<dcp::SoundAsset> A = write_sound_asset (dir / "A.mxf", 0);
+	shared_ptr<dcp::SoundAsset> B = write_sound_asset (dir / "B.mxf", 100);
+
+	dcp::EqualityOptions opt;
+	list<pair<dcp::NoteType, string> > notes;
+
+	BOOST_CHECK (equals (A, A, opt, notes));
+	BOOST_CHECK (notes.empty ());
+
+	BOOST_CHECK (!equals (A, B, opt, notes));
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().first, dcp::DCP_ERROR);
+	BOOST_CHECK_EQUAL (notes.front().second, "PCM data difference of 100 in channel 2 of frame 30");
+
+	list<pair<dcp::NoteType, string> > serial_notes = notes;
+	opt.threads = 4;
+	BOOST_CHECK (!equals (A, B, opt, notes));
+	BOOST_CHECK (notes == serial_notes);
+
+	opt.max_audio_sample_error = 100;
+	opt.keep_going = true;
+	BOOST_CHECK (equals (A, B, opt, notes));
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().first, dcp::DCP_NOTE);
+	BOOST_CHECK_EQUAL (notes.front().second.find ("audio channel 2: maximum sample difference 100, RMS difference "), 0);
+
+	serial_notes = notes;
+	opt.threads = 1;
+	BOOST_CHECK (equals (A, B, opt, notes));
+	BOOST_CHECK (notes == serial_notes);
+}
@@ -0,0 +1,114 @@
+/*
+    Copyright (C) 2020 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "sound_asset.h"
+#include "sound_asset_writer.h"
+#include "sound_asset_reader.h"
+#include "sound_frame.h"
+#include "util.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <vector>
+
+using std::vector;
+using boost::shared_ptr;
+
+/** Write the same samples as floats, as interleaved integers and as floats in the background,
+ *  in odd-sized blocks, and check that the PCM data in the three assets is the same.
+ */
+BOOST_AUTO_TEST_CASE (sound_asset_writer_test)
+{
+	boost::filesystem::path dir = "build/test/sound_asset_writer_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+
+	int const channels = 6;
+	int const length = 48000 * 2 + 123;
+
+	vector<vector<float> > floats (channels, vector<float> (length));
+	vector<int32_t> ints (channels * length);
+	for (int i = 0; i < length; ++i) {
+		for (int j = 0; j < channels; ++j) {
+			int32_t const s = ((i * (j + 3)) % 16384 - 8192) * 64;
+			floats[j][i] = s / 8388608.0f;
+			ints[i * channels + j] = s;
+		}
+	}
+
+	char const * names[3] = { "float.mxf", "int.mxf", "background.mxf" };
+	shared_ptr<dcp::SoundAsset> assets[3];
+	for (int i = 0; i < 3; ++i) {
+		assets[i].reset (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, channels, dcp::SMPTE));
+		shared_ptr<dcp::SoundAssetWriter> writer = assets[i]->start_write (dir / names[i], false, i == 2);
+		int const block = 1777;
+		for (int j = 0; j < length; j += block) {
+			int const n = std::min (block, length - j);
+			if (i == 1) {
+				writer->write (&ints[j * channels], n);
+			} else {
+				float* data[channels];
+				for (int k = 0; k < channels; ++k) {
+					data[k] = &floats[k][j];
+				}
+				writer->write (data, n);
+			}
+		}
+		writer->finalize ();
+		/* The writer should have taken the digest of the finished file */
+		BOOST_CHECK_EQUAL (assets[i]->hash(), dcp::make_digest (dir / names[i], 0));
+	}
+
+	BOOST_REQUIRE_EQUAL (assets[0]->intrinsic_duration(), 49);
+
+	shared_ptr<dcp::SoundAssetReader> readers[3];
+	for (int i = 0; i < 3; ++i) {
+		BOOST_REQUIRE_EQUAL (assets[i]->intrinsic_duration(), assets[0]->intrinsic_duration());
+		readers[i] = assets[i]->start_read ();
+	}
+
+	for (int i = 0; i < assets[0]->intrinsic_duration(); ++i) {
+		shared_ptr<const dcp::SoundFrame> frame = readers[0]->get_frame (i);
+		for (int j = 0; j < frame->samples(); ++j) {
+			int const sample = i * 2000 + j;
+			for (int k = 0; k < channels; ++k) {
+				int32_t const ref = sample < length ? (ints[sample * channels + k] & 0xffffff) : 0;
+				BOOST_REQUIRE_EQUAL (frame->get (k, j), ref);
+			}
+		}
+		for (int j = 1; j < 3; ++j) {
+			shared_ptr<const dcp::SoundFrame> other = readers[j]->get_frame (i);
+			BOOST_REQUIRE_EQUAL (other->size(), frame->size());
+			BOOST_REQUIRE (memcmp (other->data(), frame->data(), frame->size()) == 0);
+		}
+	}
+}
@@ -38,6 +38,7 @@
 #include "sound_asset_reader.h"
 #include "exceptions.h"
 #include <sndfile.h>
+#include <vector>
 
 using boost::shared_ptr;
 
@@ -87,3 +88,78 @@ BOOST_AUTO_TEST_CASE (sound_frame_test2)
 
 	BOOST_CHECK_THROW (asset.start_read()->get_frame (99999999), dcp::ReadError);
 }
+
+/** Check that frames whose buffers come from the reader's pool, and frames read
+ *  into a caller-owned buffer, give the same data.
+ */
+BOOST_AUTO_TEST_CASE (sound_frame_buffer_test)
+{
+	dcp::SoundAsset asset (
+		private_test /
+		"TONEPLATES-SMPTE-PLAINTEXT_TST_F_XX-XX_ITL-TD_51-XX_2K_WOE_20111001_WOE_OV/pcm_95734608-5d47-4d3f-bf5f-9e9186b66afa_.mxf"
+		);
+
+	shared_ptr<dcp::SoundAssetReader> reader = asset.start_read ();
+
+	/* Hold on to some frames while more are read so that buffers must be both
+	   re-used and newly allocated.
+	*/
+	std::vector<shared_ptr<const dcp::SoundFrame> > held;
+	for (int i = 0; i < 48; ++i) {
+		shared_ptr<const dcp::SoundFrame> frame = reader->get_frame (i);
+		if ((i % 3) == 0) {
+			held.push_back (frame);
+		}
+	}
+
+	shared_ptr<ASDCP::PCM::FrameBuffer> buffer = reader->make_buffer ();
+	for (int i = 0; i < 48; i += 3) {
+		reader->get_frame (i, *buffer);
+		shared_ptr<const dcp::SoundFrame> frame = held[i / 3];
+		BOOST_REQUIRE_EQUAL (frame->size(), static_cast<int> (buffer->Size()));
+		BOOST_REQUIRE_EQUAL (memcmp (frame->data(), buffer->RoData(), frame->size()), 0);
+	}
+
+	/* Frames must stay valid after their reader has gone */
+	shared_ptr<const dcp::SoundFrame> frame = reader->get_frame (42);
+	reader.reset ();
+	BOOST_CHECK_EQUAL (frame->size(), 6 * 2000 * 3);
+}
+
+/** Check that frames from a FrameReadAhead are the same as those read directly */
+BOOST_AUTO_TEST_CASE (sound_frame_read_ahead_test)
+{
+	dcp::SoundAsset asset (
+		private_test /
+		"TONEPLATES-SMPTE-PLAINTEXT_TST_F_XX-XX_ITL-TD_51-XX_2K_WOE_20111001_WOE_OV/pcm_95734608-5d47-4d3f-bf5f-9e9186b66afa_.mxf"
+		);
+
+	shared_ptr<dcp::SoundAssetReader> reader = asset.start_read ();
+	shared_ptr<ASDCP::PCM::FrameBuffer> buffer = reader->make_buffer ();
+
+	{
+		shared_ptr<dcp::FrameReadAhead<dcp::SoundFrame> > frames = reader->read_ahead (10, 74, 4);
+		for (int i = 10; i < 74; ++i) {
+			BOOST_CHECK_EQUAL (frames->position(), i);
+			shared_ptr<const dcp::SoundFrame> frame = frames->next ();
+			BOOST_REQUIRE (frame);
+			/* Reading directly at the same time as the read-ahead thread must be safe */
+			reader->get_frame (i, *buffer);
+			BOOST_REQUIRE_EQUAL (frame->size(), static_cast<int> (buffer->Size()));
+			BOOST_REQUIRE_EQUAL (memcmp (frame->data(), buffer->RoData(), frame->size()), 0);
+		}
+		BOOST_CHECK (!frames->next ());
+	}
+
+	/* Stopping early must not hang */
+	{
+		shared_ptr<dcp::FrameReadAhead<dcp::SoundFrame> > frames = reader->read_ahead (0, asset.intrinsic_duration(), 2);
+		BOOST_CHECK (frames->next ());
+	}
+
+	/* Errors must come back to the caller */
+	{
+		shared_ptr<dcp::FrameReadAhead<dcp::SoundFrame> > frames = reader->read_ahead (99999990, 99999999);
+		BOOST_CHECK_THROW (frames->next (), dcp::ReadError);
+	}
+}
@@ -49,6 +49,8 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <cstdio>
 #include <iostream>
 
@@ -153,11 +155,7 @@ BOOST_AUTO_TEST_CASE (verify_test1)
 	BOOST_CHECK_EQUAL (st->first, "Checking reel");
 	BOOST_REQUIRE (!st->second);
 	++st;
-	BOOST_CHECK_EQUAL (st->first, "Checking picture asset hash");
-	BOOST_REQUIRE (st->second);
-	BOOST_CHECK_EQUAL (st->second.get(), boost::filesystem::canonical("build/test/verify_test1/video.mxf"));
-	++st;
-	BOOST_CHECK_EQUAL (st->first, "Checking picture frame sizes");
+	BOOST_CHECK_EQUAL (st->first, "Checking picture asset hash and frame sizes");
 	BOOST_REQUIRE (st->second);
 	BOOST_CHECK_EQUAL (st->second.get(), boost::filesystem::canonical("build/test/verify_test1/video.mxf"));
 	++st;
@@ -466,11 +464,7 @@ BOOST_AUTO_TEST_CASE (verify_test13)
 	BOOST_CHECK_EQUAL (st->first, "Checking reel");
 	BOOST_REQUIRE (!st->second);
 	++st;
-	BOOST_CHECK_EQUAL (st->first, "Checking picture asset hash");
-	BOOST_REQUIRE (st->second);
-	BOOST_CHECK_EQUAL (st->second.get(), boost::filesystem::canonical("build/test/verify_test13/j2c_c6035f97-b07d-4e1c-944d-603fc2ddc242.mxf"));
-	++st;
-	BOOST_CHECK_EQUAL (st->first, "Checking picture frame sizes");
+	BOOST_CHECK_EQUAL (st->first, "Checking picture asset hash and frame sizes");
 	BOOST_REQUIRE (st->second);
 	BOOST_CHECK_EQUAL (st->second.get(), boost::filesystem::canonical("build/test/verify_test13/j2c_c6035f97-b07d-4e1c-944d-603fc2ddc242.mxf"));
 	++st;
@@ -767,3 +761,69 @@ BOOST_AUTO_TEST_CASE (verify_test22)
 }
 
 
+
+/* Check that checking assets in parallel gives the same notes, in the same order, as doing it one at a time */
+BOOST_AUTO_TEST_CASE (verify_test23)
+{
+	vector<boost::filesystem::path> directories = setup (1, 23);
+
+	{
+		Editor e ("build/test/verify_test23/pkl_ae8a9818-872a-4f86-8493-11dfdea03e09.xml");
+		e.replace ("<Hash>", "<Hash>x");
+	}
+
+	FILE* mod = fopen("build/test/verify_test23/audio.mxf", "r+b");
+	BOOST_REQUIRE (mod);
+	fseek (mod, 4096, SEEK_SET);
+	int x = 42;
+	BOOST_REQUIRE (fwrite (&x, sizeof(x), 1, mod) == 1);
+	fclose (mod);
+
+	list<dcp::VerificationNote> serial = dcp::verify (directories, &stage, &progress, xsd_test, 1);
+	list<dcp::VerificationNote> parallel = dcp::verify (directories, &stage, &progress, xsd_test, 4);
+
+	BOOST_REQUIRE_EQUAL (serial.size(), parallel.size());
+	BOOST_REQUIRE (serial.size() > 2);
+	list<dcp::VerificationNote>::const_iterator j = parallel.begin();
+	BOOST_FOREACH (dcp::VerificationNote i, serial) {
+		BOOST_CHECK_EQUAL (i.type(), j->type());
+		BOOST_CHECK_EQUAL (i.code(), j->code());
+		BOOST_CHECK_EQUAL (dcp::note_to_string(i), dcp::note_to_string(*j));
+		++j;
+	}
+}
+
+static void
+validate_cpl (boost::filesystem::path xml, list<dcp::VerificationNote>* notes)
+{
+	dcp::validate_xml (xml, xsd_test, *notes);
+}
+
+/* Check validate_xml on its own, including from several threads at once */
+BOOST_AUTO_TEST_CASE (verify_test24)
+{
+	setup (1, 24);
+
+	list<dcp::VerificationNote> notes;
+	dcp::validate_xml (cpl(24), xsd_test, notes);
+	BOOST_CHECK (notes.empty());
+
+	vector<list<dcp::VerificationNote> > thread_notes (4);
+	boost::thread_group group;
+	for (int i = 0; i < 4; ++i) {
+		group.create_thread (boost::bind(&validate_cpl, cpl(24), &thread_notes[i]));
+	}
+	group.join_all ();
+	BOOST_FOREACH (list<dcp::VerificationNote> const& i, thread_notes) {
+		BOOST_CHECK (i.empty());
+	}
+
+	{
+		Editor e (cpl(24));
+		e.replace ("<ContentKind>feature</ContentKind>", "<Foo>feature</Foo>");
+	}
+
+	dcp::validate_xml (cpl(24), xsd_test, notes);
+	BOOST_REQUIRE (!notes.empty());
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::XML_VALIDATION_ERROR);
+}
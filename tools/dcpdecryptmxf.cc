@@ -60,7 +60,8 @@ help (string n)
 	     << "  -h, --help         show this help\n"
 	     << "  -o, --output       output filename\n"
 	     << "  -k, --kdm          KDM file\n"
-	     << "  -p, --private-key  private key file\n";
+	     << "  -p, --private-key  private key file\n"
+	     << "  -j, --threads      number of threads to use when decrypting\n";
 }
 
 int
@@ -69,6 +70,7 @@ main (int argc, char* argv[])
 	optional<boost::filesystem::path> output_file;
 	optional<boost::filesystem::path> kdm_file;
 	optional<boost::filesystem::path> private_key_file;
+	int threads = 1;
 
 	int option_index = 0;
 	while (true) {
@@ -78,10 +80,11 @@ main (int argc, char* argv[])
 			{ "output", required_argument, 0, 'o'},
 			{ "kdm", required_argument, 0, 'k'},
 			{ "private-key", required_argument, 0, 'p'},
+			{ "threads", required_argument, 0, 'j'},
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "vho:k:p:", long_options, &option_index);
+		int c = getopt_long (argc, argv, "vho:k:p:j:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -103,6 +106,9 @@ main (int argc, char* argv[])
 		case 'p':
 			private_key_file = optarg;
 			break;
+		case 'j':
+			threads = atoi (optarg);
+			break;
 		}
 	}
 
@@ -135,6 +141,21 @@ main (int argc, char* argv[])
 
 	try {
 		dcp::AtmosAsset in (input_file);
+
+		optional<dcp::Key> key;
+		BOOST_FOREACH (dcp::DecryptedKDMKey const & i, decrypted_kdm.keys ()) {
+			if (in.key_id() && i.id() == in.key_id().get()) {
+				key = i.key ();
+			}
+		}
+
+		if (!key) {
+			cerr << "KDM has no key for " << input_file.string() << "\n";
+			exit (EXIT_FAILURE);
+		}
+
+		in.set_key (key.get ());
+
 		shared_ptr<dcp::AtmosAssetReader> reader = in.start_read ();
 		dcp::AtmosAsset out (
 			in.edit_rate(),
@@ -144,8 +165,11 @@ main (int argc, char* argv[])
 			in.atmos_version()
 			);
 		shared_ptr<dcp::AtmosAssetWriter> writer = out.start_write (output_file.get());
+		/* Nothing here needs the digest of the output */
+		writer->set_hash_on_finalize (false);
+		shared_ptr<dcp::FrameReadAhead<dcp::AtmosFrame> > frames = reader->read_ahead (0, in.intrinsic_duration(), 8, threads);
 		for (int64_t i = 0; i < in.intrinsic_duration(); ++i) {
-			shared_ptr<const dcp::AtmosFrame> f = reader->get_frame (i);
+			shared_ptr<const dcp::AtmosFrame> f = frames->next ();
 			writer->write (f->data(), f->size());
 		}
 	} catch (dcp::ReadError& e) {
@@ -40,6 +40,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 #include <iostream>
 #include <list>
 
@@ -69,6 +70,8 @@ help (string n)
 	     << "  -s, --std-dev-pixel          maximum allowed standard deviation of pixel error (default 5)\n"
 	     << "      --key                    hexadecimal key to use to decrypt MXFs\n"
 	     << "      --ignore-missing-assets  ignore missing asset files\n"
+	     << "  -j, --threads                number of threads to use when comparing frames\n"
+	     << "                               (default is the number of CPU cores)\n"
 	     << "\n"
 	     << "The <DCP>s are the DCP directories to compare.\n"
 	     << "Comparison is of metadata and content, ignoring timestamps\n"
@@ -124,6 +127,7 @@ main (int argc, char* argv[])
 	options.max_std_dev_pixel_error = 5;
 	options.reel_hashes_can_differ = true;
 	options.reel_annotation_texts_can_differ = false;
+	options.threads = std::max (1U, boost::thread::hardware_concurrency ());
 	bool ignore_missing_assets = false;
 	optional<string> key;
 
@@ -137,6 +141,7 @@ main (int argc, char* argv[])
 			{ "std-dev-pixel", required_argument, 0, 's'},
 			{ "annotation-texts", no_argument, 0, 'a'},
 			{ "issue-dates", no_argument, 0, 'd'},
+			{ "threads", required_argument, 0, 'j'},
 			/* From here we're using random capital letters for the short option */
 			{ "ignore-missing-assets", no_argument, 0, 'A'},
 			{ "cpl-annotation-texts", no_argument, 0, 'C'},
@@ -145,7 +150,7 @@ main (int argc, char* argv[])
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "Vhvm:s:adACD:E", long_options, &option_index);
+		int c = getopt_long (argc, argv, "Vhvm:s:adj:ACD:E", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -173,6 +178,9 @@ main (int argc, char* argv[])
 		case 'd':
 			options.issue_dates_can_differ = true;
 			break;
+		case 'j':
+			options.threads = atoi (optarg);
+			break;
 		case 'A':
 			ignore_missing_assets = true;
 			break;
@@ -81,6 +81,7 @@ help (string n)
 	     << "  -s, --subtitles              list all subtitles\n"
 	     << "  -p, --picture                analyse picture\n"
 	     << "  -d, --decompress             decompress picture when analysing (this is slow)\n"
+	     << "  -j, --threads                number of threads to use when reading picture frames\n"
 	     << "  -o, --only                   only output certain pieces of information; see below.\n"
 	     << "      --kdm                    KDM to decrypt DCP\n"
 	     << "      --private-key            private key for the certificate that the KDM is targeted at\n"
@@ -128,7 +129,7 @@ maybe_output(vector<string> const& only, string t, string s)
 
 static
 dcp::Time
-main_picture (vector<string> const& only, shared_ptr<Reel> reel, bool analyse, bool decompress)
+main_picture (vector<string> const& only, shared_ptr<Reel> reel, bool analyse, bool decompress, int threads)
 {
 	shared_ptr<dcp::ReelPictureAsset> mp = reel->main_picture ();
 	if (!mp) {
@@ -159,8 +160,9 @@ main_picture (vector<string> const& only, shared_ptr<Reel> reel, bool analyse, b
 		if (analyse && ma) {
 			shared_ptr<MonoPictureAssetReader> reader = ma->start_read ();
 			pair<int, int> j2k_size_range (INT_MAX, 0);
+			shared_ptr<FrameReadAhead<MonoPictureFrame> > frames = reader->read_ahead (0, ma->intrinsic_duration(), 8, threads);
 			for (int64_t i = 0; i < ma->intrinsic_duration(); ++i) {
-				shared_ptr<const MonoPictureFrame> frame = reader->get_frame (i);
+				shared_ptr<const MonoPictureFrame> frame = frames->next ();
 				if (SHOULD_PICTURE) {
 					printf("Frame %" PRId64 " J2K size %7d", i, frame->j2k_size());
 				}
@@ -287,6 +289,7 @@ main (int argc, char* argv[])
 	bool picture = false;
 	bool decompress = false;
 	bool ignore_missing_assets = false;
+	int threads = 1;
 	optional<boost::filesystem::path> kdm;
 	optional<boost::filesystem::path> private_key;
 	optional<string> only_string;
@@ -299,6 +302,7 @@ main (int argc, char* argv[])
 			{ "subtitles", no_argument, 0, 's' },
 			{ "picture", no_argument, 0, 'p' },
 			{ "decompress", no_argument, 0, 'd' },
+			{ "threads", required_argument, 0, 'j' },
 			{ "only", required_argument, 0, 'o' },
 			{ "ignore-missing-assets", no_argument, 0, 'A' },
 			{ "kdm", required_argument, 0, 'B' },
@@ -306,7 +310,7 @@ main (int argc, char* argv[])
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "vhspdo:AB:C:", long_options, &option_index);
+		int c = getopt_long (argc, argv, "vhspdj:o:AB:C:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -328,6 +332,9 @@ main (int argc, char* argv[])
 		case 'd':
 			decompress = true;
 			break;
+		case 'j':
+			threads = atoi (optarg);
+			break;
 		case 'o':
 			only_string = optarg;
 			break;
@@ -404,7 +411,7 @@ main (int argc, char* argv[])
 			}
 
 			try {
-				total_time += main_picture(only, j, picture, decompress);
+				total_time += main_picture(only, j, picture, decompress, threads);
 			} catch (UnresolvedRefError& e) {
 				if (!ignore_missing_assets) {
 					cerr << e.what() << " (for main picture)\n";
@@ -36,6 +36,7 @@
 #include "exceptions.h"
 #include "asset_factory.h"
 #include "reel_asset.h"
+#include "digest_cache.h"
 #include <getopt.h>
 #include <libxml++/libxml++.h>
 #include <boost/filesystem.hpp>
@@ -53,8 +54,9 @@ static void
 help (string n)
 {
 	cerr << "Syntax: " << n << " [OPTION] <DCP>]\n"
-	     << "  -h, --help         show this help\n"
-	     << "  -o, --output       output DCP directory\n";
+	     << "  -h, --help           show this help\n"
+	     << "  -o, --output         output DCP directory\n"
+	     << "  -d, --digest-cache   file to keep asset digests in between runs\n";
 }
 
 void progress (float f)
@@ -67,14 +69,16 @@ main (int argc, char* argv[])
 {
 	int option_index = 0;
 	optional<boost::filesystem::path> output;
+	optional<boost::filesystem::path> digest_cache;
 	while (true) {
 		struct option long_options[] = {
 			{ "help", no_argument, 0, 'h' },
 			{ "output", required_argument, 0, 'o' },
+			{ "digest-cache", required_argument, 0, 'd' },
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "ho:", long_options, &option_index);
+		int c = getopt_long (argc, argv, "ho:d:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -87,6 +91,9 @@ main (int argc, char* argv[])
 		case 'o':
 			output = optarg;
 			break;
+		case 'd':
+			digest_cache = optarg;
+			break;
 		}
 	}
 
@@ -97,6 +104,12 @@ main (int argc, char* argv[])
 
 	boost::filesystem::path dcp_dir = argv[optind];
 
+	shared_ptr<dcp::DigestCache> cache;
+	if (digest_cache) {
+		cache.reset (new dcp::DigestCache (*digest_cache));
+		dcp::set_digest_cache (cache);
+	}
+
 	/* Try to read it and report errors */
 
 	dcp::DCP dcp (dcp_dir);
@@ -158,5 +171,9 @@ main (int argc, char* argv[])
 		cout << "Fixed XML files written to " << output->string() << "\n";
 	}
 
+	if (cache) {
+		cache->write ();
+	}
+
 	return 0;
 }
@@ -32,6 +32,7 @@
 */
 
 #include "verify.h"
+#include "digest_cache.h"
 #include "compose.hpp"
 #include <boost/bind.hpp>
 #include <boost/optional.hpp>
@@ -48,13 +49,17 @@ using std::vector;
 using std::list;
 using boost::bind;
 using boost::optional;
+using boost::shared_ptr;
 
 static void
 help (string n)
 {
 	cerr << "Syntax: " << n << " [OPTION] <DCP>\n"
-	     << "  -V, --version   show libdcp version\n"
-	     << "  -h, --help      show this help\n";
+	     << "  -V, --version        show libdcp version\n"
+	     << "  -h, --help           show this help\n"
+	     << "  -j, --threads        number of assets to check at the same time\n"
+	     << "  -d, --digest-cache   file to keep asset digests in between runs\n"
+	     << "  -s, --strict         read every asset to check its hash, even if its digest is in the cache\n";
 }
 
 void
@@ -76,15 +81,22 @@ progress ()
 int
 main (int argc, char* argv[])
 {
+	int threads = 1;
+	optional<boost::filesystem::path> digest_cache;
+	bool strict = false;
+
 	int option_index = 0;
 	while (true) {
 		static struct option long_options[] = {
 			{ "version", no_argument, 0, 'V'},
 			{ "help", no_argument, 0, 'h'},
+			{ "threads", required_argument, 0, 'j'},
+			{ "digest-cache", required_argument, 0, 'd'},
+			{ "strict", no_argument, 0, 's'},
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "Vh", long_options, &option_index);
+		int c = getopt_long (argc, argv, "Vhj:d:s", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -97,6 +109,15 @@ main (int argc, char* argv[])
 		case 'h':
 			help (argv[0]);
 			exit (EXIT_SUCCESS);
+		case 'j':
+			threads = atoi (optarg);
+			break;
+		case 'd':
+			digest_cache = optarg;
+			break;
+		case 's':
+			strict = true;
+			break;
 		}
 	}
 
@@ -110,10 +131,20 @@ main (int argc, char* argv[])
 		exit (EXIT_FAILURE);
 	}
 
+	shared_ptr<dcp::DigestCache> cache;
+	if (digest_cache) {
+		cache.reset (new dcp::DigestCache (*digest_cache));
+		dcp::set_digest_cache (cache);
+	}
+
 	vector<boost::filesystem::path> directories;
 	directories.push_back (argv[optind]);
 	/* XXX */
-	list<dcp::VerificationNote> notes = dcp::verify (directories, bind(&stage, _1, _2), bind(&progress), "xsd");
+	list<dcp::VerificationNote> notes = dcp::verify (directories, bind(&stage, _1, _2), bind(&progress), "xsd", threads, strict);
+
+	if (cache) {
+		cache->write ();
+	}
 
 	bool failed = false;
 	BOOST_FOREACH (dcp::VerificationNote i, notes) {